@@ -0,0 +1,23 @@
+PROJECT                 = qledmatrix_benchmarks
+TARGET                  = qledmatrix_benchmarks
+TEMPLATE                = app
+
+CONFIG                 += release
+
+CONFIG                 += qt
+CONFIG                 += warn_on
+greaterThan(QT_MAJOR_VERSION, 4) {
+    QT                 += widgets testlib
+} else {
+    CONFIG             += qtestlib
+}
+
+OBJECTS_DIR             = obj
+MOC_DIR                 = moc
+
+DEPENDPATH             += .
+INCLUDEPATH            += ../
+QMAKE_LIBDIR           += ../build
+
+SOURCES                += qledmatrix_benchmarks.cpp
+LIBS                   += -lqledmatrix
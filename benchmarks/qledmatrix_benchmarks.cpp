@@ -0,0 +1,297 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include <QApplication>
+#include <QImage>
+#include <QtTest>
+
+#include <qledmatrix.h>
+#include <qledmatrixrenderer.h>
+
+class QLedMatrixBenchmarks: public QObject
+{
+    Q_OBJECT
+
+    private:
+        void addSizes();
+        void resize(QLedMatrix& matrix);
+
+    private Q_SLOTS:
+        void setColorAt_data();
+        void setColorAt();
+        void colorAt_data();
+        void colorAt();
+        void clear_data();
+        void clear();
+        void setDarkLedColor_data();
+        void setDarkLedColor();
+        void grow_data();
+        void grow();
+        void paint_data();
+        void paint();
+        void blit_data();
+        void blit();
+        void renderer_data();
+        void renderer();
+};
+
+/**
+ * Adds the matrix sizes, from 8x8 to 1024x512 LEDs, to the test data.
+ */
+void QLedMatrixBenchmarks::addSizes()
+{
+    QTest::addColumn<int>("rows");
+    QTest::addColumn<int>("columns");
+
+    static const int sizes[][2] = {
+        {   8,    8 },
+        {  16,   32 },
+        {  32,   64 },
+        {  64,  128 },
+        { 128,  256 },
+        { 256,  512 },
+        { 512, 1024 }
+    };
+
+    for(unsigned i=0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        const QByteArray name = QByteArray::number(sizes[i][1]) + 'x' +
+                                QByteArray::number(sizes[i][0]);
+        QTest::newRow(name.constData()) << sizes[i][0] << sizes[i][1];
+    }
+}
+
+/**
+ * Sets the size of the matrix from the current test data.
+ */
+void QLedMatrixBenchmarks::resize(QLedMatrix& matrix)
+{
+    QFETCH(int, rows);
+    QFETCH(int, columns);
+    matrix.setRowCount(rows);
+    matrix.setColumnCount(columns);
+}
+
+void QLedMatrixBenchmarks::setColorAt_data()
+{
+    addSizes();
+}
+
+void QLedMatrixBenchmarks::setColorAt()
+{
+    QLedMatrix matrix;
+    resize(matrix);
+
+    QBENCHMARK
+    {
+        for(int row=0; row < matrix.rowCount(); ++row)
+        {
+            for(int col=0; col < matrix.columnCount(); ++col)
+            {
+                matrix.setColorAt(row, col, QLedMatrix::Red);
+            }
+        }
+    }
+}
+
+void QLedMatrixBenchmarks::colorAt_data()
+{
+    addSizes();
+}
+
+void QLedMatrixBenchmarks::colorAt()
+{
+    QLedMatrix matrix;
+    resize(matrix);
+
+    QRgb sum = 0;
+    QBENCHMARK
+    {
+        for(int row=0; row < matrix.rowCount(); ++row)
+        {
+            for(int col=0; col < matrix.columnCount(); ++col)
+            {
+                sum += matrix.colorAt(row, col);
+            }
+        }
+    }
+    Q_UNUSED(sum);
+}
+
+void QLedMatrixBenchmarks::clear_data()
+{
+    addSizes();
+}
+
+void QLedMatrixBenchmarks::clear()
+{
+    QLedMatrix matrix;
+    resize(matrix);
+
+    QBENCHMARK
+    {
+        matrix.clear();
+    }
+}
+
+void QLedMatrixBenchmarks::setDarkLedColor_data()
+{
+    addSizes();
+}
+
+void QLedMatrixBenchmarks::setDarkLedColor()
+{
+    QLedMatrix matrix;
+    resize(matrix);
+
+    bool toggle = false;
+    QBENCHMARK
+    {
+        matrix.setDarkLedColor(QColor(toggle ? QLedMatrix::NoColor : 0xFF111111));
+        toggle = !toggle;
+    }
+}
+
+void QLedMatrixBenchmarks::grow_data()
+{
+    addSizes();
+}
+
+void QLedMatrixBenchmarks::grow()
+{
+    QFETCH(int, rows);
+    QFETCH(int, columns);
+    QLedMatrix matrix;
+
+    // Grows the matrix in eight steps, as a layout adding content would
+    QBENCHMARK
+    {
+        matrix.setRowCount(0);
+        matrix.setColumnCount(0);
+        for(int step=1; step <= 8; ++step)
+        {
+            matrix.setColumnCount(columns * step / 8);
+            matrix.setRowCount(rows * step / 8);
+        }
+    }
+}
+
+void QLedMatrixBenchmarks::paint_data()
+{
+    addSizes();
+}
+
+void QLedMatrixBenchmarks::paint()
+{
+    QLedMatrix matrix;
+    resize(matrix);
+
+    // From 10 pixels per LED for small matrices down to 2 for the largest
+    const int ledSize = qBound(2, 2048 / matrix.columnCount(), 10);
+    matrix.resize(matrix.columnCount() * ledSize, matrix.rowCount() * ledSize);
+
+    for(int row=0; row < matrix.rowCount(); ++row)
+    {
+        for(int col=0; col < matrix.columnCount(); ++col)
+        {
+            matrix.setColorAt(row, col, ((row + col) % 3 == 0) ? QLedMatrix::Red
+                                                               : QLedMatrix::NoColor);
+        }
+    }
+
+    QImage image(matrix.size(), QImage::Format_ARGB32_Premultiplied);
+    QBENCHMARK
+    {
+        matrix.render(&image);
+    }
+}
+
+void QLedMatrixBenchmarks::blit_data()
+{
+    addSizes();
+}
+
+void QLedMatrixBenchmarks::blit()
+{
+    QLedMatrix matrix;
+    resize(matrix);
+
+    // Tiles the display with 8x8 icons, as a dashboard composing gauges would
+    QImage icon(8, 8, QImage::Format_ARGB32);
+    icon.fill(QLedMatrix::Orange);
+    QBENCHMARK
+    {
+        for(int row=0; row < matrix.rowCount(); row += icon.height())
+        {
+            for(int col=0; col < matrix.columnCount(); col += icon.width())
+            {
+                matrix.blit(icon, QPoint(col, row));
+            }
+        }
+    }
+}
+
+void QLedMatrixBenchmarks::renderer_data()
+{
+    addSizes();
+}
+
+void QLedMatrixBenchmarks::renderer()
+{
+    QFETCH(int, rows);
+    QFETCH(int, columns);
+
+    // Same scale as the paint benchmark, without a widget
+    QLedMatrixRenderer renderer;
+    renderer.setScale(qBound(2, 2048 / columns, 10));
+
+    QImage frame(columns, rows, QImage::Format_RGB32);
+    for(int row=0; row < rows; ++row)
+    {
+        for(int col=0; col < columns; ++col)
+        {
+            frame.setPixel(col, row, ((row + col) % 3 == 0) ? QLedMatrix::Red
+                                                            : QLedMatrix::NoColor);
+        }
+    }
+
+    QImage image(renderer.imageSize(frame.size()), QImage::Format_ARGB32_Premultiplied);
+    QBENCHMARK
+    {
+        renderer.render(&image, frame);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+    // Reproducible numbers: no window system, no vsync
+    if(qgetenv("QT_QPA_PLATFORM").isEmpty())
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+#endif
+
+    QApplication app(argc, argv);
+    QLedMatrixBenchmarks benchmarks;
+    return QTest::qExec(&benchmarks, argc, argv);
+}
+
+#include "qledmatrix_benchmarks.moc"
@@ -32,24 +32,10 @@ int main(int argc, char* argv[])
     matrix.setRowCount(16);
     matrix.show();
 
+    // Monochrome display: white pixels will be shown as red LEDs, other
+    // pixels shown as dark LEDs
     QImage img(":/HelloWorld.png");
-    for(int row=0; row < matrix.rowCount(); ++row)
-    {
-        for(int col=0; col < matrix.columnCount(); ++col)
-        {
-            // Monochrome display
-            if(img.pixel(col, row) == 0xFFFFFFFF)
-            {
-                // White pixels will be shown as red LEDs
-                matrix.setColorAt(row, col, QLedMatrix::Red);
-            }
-            else
-            {
-                // Other pixels shown as dark LEDs
-                matrix.setColorAt(row, col, QLedMatrix::NoColor);
-            }
-        }
-    }
+    matrix.setFrame(img, QLedMatrix::Red, QLedMatrix::NoColor, 255);
 
     return app.exec();
 }
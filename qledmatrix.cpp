@@ -18,35 +18,427 @@
 **
 *******************************************************************************/
 
-#include "qledmatrix.h"
+#include "qledmatrix_p.h"
+#include "qledmatrixkernels_p.h"
+#include "qledmatrixrenderer_p.h"
 
+#include <qendian.h>
+#include <qevent.h>
+#include <qmath.h>
 #include <qpainter.h>
+#include <qthread.h>
+#include <qtimer.h>
+#include <qvarlengtharray.h>
+
+#ifndef QT_NO_CONCURRENT
+#include <qtconcurrentmap.h>
+#endif
+
+#include <algorithm>
+#include <limits.h>
+#include <string.h>
+
+// Maximum number of colors in IndexedStorage
+static const int MaxPaletteSize = 256;
+
+// Maximum number of sprites kept by each widget in front of the cache shared
+// by all the displays (see QLedMatrixRenderer::setSpriteCacheLimit())
+static const int MaxSpriteImages = 1024;
+
+// The back buffer is rasterized in bands by several threads from this
+// number of LEDs, each band at least MinBandHeight pixels high
+static const int ParallelMinLeds = 16384;
+static const int MinBandHeight = 16;
+
+// Interval of statsUpdated(), in milliseconds
+static const int StatsInterval = 1000;
+
+/**
+ * \internal
+ * A band of the back buffer rasterized by a thread of the pool.
+ */
+struct Band
+{
+    const QLedMatrixPrivate* d;
+    uchar* bits;
+    QRect rect;
+};
+
+/**
+ * \internal
+ */
+static void rasterizeBandEntry(Band& band)
+{
+    band.d->rasterizeBand(band.bits, band.rect);
+}
+
+/**
+ * \internal
+ * Returns the rectangles making up a region.
+ */
+static QVector<QRect> regionRects(const QRegion& region)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,8,0)
+    QVector<QRect> rects;
+    rects.reserve(region.rectCount());
+    for(QRegion::const_iterator it = region.begin(); it != region.end(); ++it)
+    {
+        rects.append(*it);
+    }
+    return rects;
+#else
+    return region.rects();
+#endif
+}
+
+// Shortest interval between two scrollText() steps, in milliseconds
+static const int MarqueeMinInterval = 16;
+
+// Interval between two transitionTo() steps, in milliseconds, and maximum
+// number of LEDs changed by a step
+static const int TransitionInterval = 16;
+static const int TransitionBudget = 32768;
+
+// Size of the squares of LEDs repainted together by a dissolve step
+static const int DissolveTileSize = 16;
+
+/**
+ * \internal
+ * Fills count values of a frame buffer.
+ */
+static inline void fillValues(QRgb* dst, int count, QRgb value)
+{
+    QLedMatrixKernels::instance().fill(dst, count, value);
+}
+
+static inline void fillValues(uchar* dst, int count, uchar value)
+{
+    memset(dst, value, count);
+}
+
+/**
+ * \internal
+ * Resizes a row-major buffer to \a rows by \a columns values, the old values
+ * being moved by \a dx columns and \a dy rows. The values common to both
+ * sizes are kept with a block copy per row, the new ones are set to
+ * \a value. The rows are copied to \a spare, whose allocation is reused,
+ * and the two buffers are swapped: while their capacity is large enough,
+ * resizing does not allocate memory.
+ */
+template <typename T>
+static void resizeBuffer(QVector<T>& buffer, QVector<T>& spare, int rowCount, int columnCount,
+                         int rows, int columns, int dx, int dy, T value)
+{
+    if((columns == columnCount) && (dx == 0) && (dy == 0))
+    {
+        // Same stride: rows are simply added or removed at the end
+        buffer.resize(rows * columns);
+        if(rows > rowCount)
+        {
+            fillValues(buffer.data() + rowCount * columns,
+                       (rows - rowCount) * columns, value);
+        }
+        return;
+    }
+
+    spare.resize(rows * columns);
+    T* dst = spare.data();
+    const QRect kept = QRect(dx, dy, columnCount, rowCount) & QRect(0, 0, columns, rows);
+    if(kept.isEmpty())
+    {
+        fillValues(dst, rows * columns, value);
+    }
+    else
+    {
+        fillValues(dst, kept.top() * columns, value);
+        for(int row=kept.top(); row <= kept.bottom(); ++row)
+        {
+            T* line = dst + row * columns;
+            fillValues(line, kept.left(), value);
+            memcpy(line + kept.left(),
+                   buffer.constData() + (row - dy) * columnCount + (kept.left() - dx),
+                   kept.width() * sizeof(T));
+            fillValues(line + kept.right() + 1, columns - kept.right() - 1, value);
+        }
+        fillValues(dst + (kept.bottom() + 1) * columns, (rows - kept.bottom() - 1) * columns,
+                   value);
+    }
+    qSwap(buffer, spare);
+}
+
+/**
+ * \internal
+ * Moves the values of a row-major buffer by \a dx columns and \a dy rows
+ * with block moves. The vacated values are set to \a value.
+ */
+template <typename T>
+static void scrollBuffer(T* buffer, int rows, int columns, int dx, int dy, T value)
+{
+    if(dy > 0)
+    {
+        memmove(buffer + dy * columns, buffer, (rows - dy) * columns * sizeof(T));
+        fillValues(buffer, dy * columns, value);
+    }
+    else if(dy < 0)
+    {
+        memmove(buffer, buffer - dy * columns, (rows + dy) * columns * sizeof(T));
+        fillValues(buffer + (rows + dy) * columns, -dy * columns, value);
+    }
+
+    if(dx == 0)
+    {
+        return;
+    }
+
+    for(int row=0; row < rows; ++row)
+    {
+        T* line = buffer + row * columns;
+        if(dx > 0)
+        {
+            memmove(line + dx, line, (columns - dx) * sizeof(T));
+            fillValues(line, dx, value);
+        }
+        else
+        {
+            memmove(line, line - dx, (columns + dx) * sizeof(T));
+            fillValues(line + columns + dx, -dx, value);
+        }
+    }
+}
+
+/**
+ * \internal
+ * Moves the values of a row-major buffer by \a dx columns and \a dy rows
+ * with block moves. The values moved past an edge enter again from the
+ * opposite edge. Both distances must be smaller than the buffer size.
+ */
+template <typename T>
+static void rotateBuffer(T* buffer, int rows, int columns, int dx, int dy)
+{
+    // Moving to the left or up is moving to the right or down the rest
+    dx = (dx < 0) ? dx + columns : dx;
+    dy = (dy < 0) ? dy + rows : dy;
+
+    QVector<T> spare(qMax(dx, dy * columns));
+    if(dy > 0)
+    {
+        const int wrapped = dy * columns;
+        const int kept = (rows - dy) * columns;
+        memcpy(spare.data(), buffer + kept, wrapped * sizeof(T));
+        memmove(buffer + wrapped, buffer, kept * sizeof(T));
+        memcpy(buffer, spare.constData(), wrapped * sizeof(T));
+    }
+
+    if(dx == 0)
+    {
+        return;
+    }
+
+    for(int row=0; row < rows; ++row)
+    {
+        T* line = buffer + row * columns;
+        memcpy(spare.data(), line + columns - dx, dx * sizeof(T));
+        memmove(line + dx, line, (columns - dx) * sizeof(T));
+        memcpy(line, spare.constData(), dx * sizeof(T));
+    }
+}
+
+/**
+ * \internal
+ * Moves the pixels of a 32-bit image inside \a rect by (\a dx, \a dy)
+ * pixels. The pixels vacated inside \a rect are left unchanged.
+ */
+static void scrollImage(QImage& image, const QRect& rect, int dx, int dy)
+{
+    const QRect target = rect & rect.translated(dx, dy);
+    if(target.isEmpty())
+    {
+        return;
+    }
+
+    const int bytes = target.width() * sizeof(QRgb);
+    const int step = (dy > 0) ? -1 : 1;
+    const int first = (dy > 0) ? target.bottom() : target.top();
+    for(int i=0; i < target.height(); ++i)
+    {
+        const int y = first + i * step;
+        uchar* line = image.scanLine(y) + target.x() * sizeof(QRgb);
+        const uchar* source = image.constScanLine(y - dy) + (target.x() - dx) * sizeof(QRgb);
+        memmove(line, source, bytes);
+    }
+}
+
+/**
+ * \internal
+ * Returns the bit of the given column in a MonochromeStorage row. The first
+ * column is the most significant bit of the first word.
+ */
+static inline bool testBit(const quint32* line, int col)
+{
+    return (line[col >> 5] >> (31 - (col & 31))) & 1;
+}
+
+static inline void setBit(quint32* line, int col, bool on)
+{
+    const quint32 mask = quint32(1) << (31 - (col & 31));
+    if(on)
+    {
+        line[col >> 5] |= mask;
+    }
+    else
+    {
+        line[col >> 5] &= ~mask;
+    }
+}
 
 /**
  * \internal
+ * Resizes a MonochromeStorage buffer as resizeBuffer() does, bit by bit:
+ * used when the columns move by a number of bits that is not a multiple of
+ * 32. The new LEDs are off.
  */
-class QLedMatrixPrivate
+static void resizeMonoBuffer(QVector<quint32>& buffer, QVector<quint32>& spare,
+                             int rowCount, int columnCount, int rows, int columns,
+                             int dx, int dy)
 {
-    Q_DECLARE_PUBLIC(QLedMatrix)
+    const int oldStride = (columnCount + 31) / 32;
+    const int stride = (columns + 31) / 32;
+    spare.fill(0, rows * stride);
+    const QRect kept = QRect(dx, dy, columnCount, rowCount) & QRect(0, 0, columns, rows);
+    for(int row=kept.top(); row <= kept.bottom(); ++row)
+    {
+        const quint32* src = buffer.constData() + (row - dy) * oldStride;
+        quint32* dst = spare.data() + row * stride;
+        for(int col=kept.left(); col <= kept.right(); ++col)
+        {
+            setBit(dst, col, testBit(src, col - dx));
+        }
+    }
+    qSwap(buffer, spare);
+}
 
-    public:
-        bool isValid(int row, int col) const;
-        void setColorAt(int row, int col, QRgb rgb, bool doUpdate);
-        void drawLEDs(QPainter& painter);
-        void calculateAspectRatio();
+/**
+ * \internal
+ * Shifts a MonochromeStorage row of \a count words by \a shift columns, a
+ * word at a time. Positive values move the LEDs to the right.
+ */
+static void shiftBits(quint32* words, int count, int shift)
+{
+    const int wordShift = qAbs(shift) / 32;
+    const int bitShift = qAbs(shift) % 32;
+    if(shift > 0)
+    {
+        for(int i=count - 1; i >= 0; --i)
+        {
+            const int src = i - wordShift;
+            const quint32 high = (src >= 0) ? words[src] : 0;
+            const quint32 low = (src >= 1) ? words[src - 1] : 0;
+            words[i] = bitShift ? ((high >> bitShift) | (low << (32 - bitShift))) : high;
+        }
+    }
+    else if(shift < 0)
+    {
+        for(int i=0; i < count; ++i)
+        {
+            const int src = i + wordShift;
+            const quint32 high = (src < count) ? words[src] : 0;
+            const quint32 next = (src + 1 < count) ? words[src + 1] : 0;
+            words[i] = bitShift ? ((high << bitShift) | (next >> (32 - bitShift))) : high;
+        }
+    }
+}
 
-        QLedMatrix* q_ptr;
-        QBrush backgroundBrush;
-        Qt::BGMode backgroundMode;
-        QColor darkLedColor;
-        QVector< QVector<QRgb> > colorTable;
-        int rowCount;
-        int columnCount;
-        qreal rowHeight;
-        qreal columnWidth;
-        qreal aspectRatio;
+/**
+ * \internal
+ * Bits of each byte value in reverse order, to read Format_MonoLSB images.
+ */
+static const uchar reversedBits[256] = {
+#define R2(n) n, n + 2*64, n + 1*64, n + 3*64
+#define R4(n) R2(n), R2(n + 2*16), R2(n + 1*16), R2(n + 3*16)
+#define R6(n) R4(n), R4(n + 2*4), R4(n + 1*4), R4(n + 3*4)
+    R6(0), R6(2), R6(1), R6(3)
+#undef R6
+#undef R4
+#undef R2
 };
 
+/**
+ * \internal
+ */
+QLedMatrixPrivate::QLedMatrixPrivate():
+    q_ptr(0)
+{
+}
+
+/**
+ * \internal
+ */
+QLedMatrixPrivate::~QLedMatrixPrivate()
+{
+}
+
+/**
+ * \internal
+ * Sets the default state of the display, once q_ptr is set.
+ */
+void QLedMatrixPrivate::init()
+{
+    Q_Q(QLedMatrix);
+    backgroundBrush = QBrush(Qt::black, Qt::SolidPattern);
+    backgroundMode = Qt::OpaqueMode;
+    darkLedColor = QColor(QLedMatrix::NoColor);
+    rowCount = 0;
+    columnCount = 0;
+    panelRows = 0;
+    panelColumns = 0;
+    panelSpacing = 0.0;
+    rowHeight = 0.0;
+    columnWidth = 0.0;
+    aspectRatio = 0.0;
+    transformDirty = true;
+    updateDepth = 0;
+    renderMode = QLedMatrix::DirectRendering;
+    storageFormat = QLedMatrix::RgbStorage;
+    frameLeds = 0;
+    indexLeds = 0;
+    monoLeds = 0;
+    fixedStorage = false;
+    fixedSize = false;
+    litLedColor = QColor(QLedMatrix::Red);
+    backBufferValid = false;
+    recordPending = true;
+    detailThreshold = 4.0;
+    spriteImageDiameter = 0.0;
+    renderThreads = 1;
+    smoothScaling = false;
+    font = QLedMatrixFont::font5x7();
+    marqueeTimer = 0;
+    marqueeSteps = 0;
+    marqueeHeight = 0;
+    marqueePosition = 0;
+    marqueeSpeed = 0;
+    marqueeColor = QLedMatrix::NoColor;
+    transitionTimer = 0;
+    transitionType = QLedMatrix::Crossfade;
+    transitionDuration = 0;
+    transitionPosition = 0;
+    transitionLevel = 0;
+    transitionSeed = 0x2545F491;
+    statsEnabled = false;
+    statsTimer = 0;
+    ledsDrawn = 0;
+    ledsDrawnTotal = 0;
+    dirtyArea = 0;
+    updateRequests = 0;
+    updateOpaquePaint();
+
+    const QByteArray statsVariable = qgetenv("QLEDMATRIX_STATS");
+    if(!statsVariable.isEmpty() && (statsVariable != "0"))
+    {
+        q->setStatsEnabled(true);
+    }
+}
+
 /**
  * \internal
  */
@@ -63,14 +455,13 @@ bool QLedMatrixPrivate::isValid(int row, int col) const
  */
 void QLedMatrixPrivate::setColorAt(int row, int col, QRgb rgb, bool doUpdate)
 {
-    Q_Q(QLedMatrix);
     if(isValid(row, col))
     {
-        colorTable[col][row] = rgb;
+        setPixel(row, col, rgb);
 
         if(doUpdate == true)
         {
-            q->update();
+            invalidate(QRect(col, row, 1, 1));
         }
     }
     else
@@ -81,472 +472,3912 @@ void QLedMatrixPrivate::setColorAt(int row, int col, QRgb rgb, bool doUpdate)
 
 /**
  * \internal
+ * Returns the color of a LED, without checking its position.
  */
-void QLedMatrixPrivate::drawLEDs(QPainter& painter)
+QRgb QLedMatrixPrivate::pixel(int row, int col) const
 {
-    Q_Q(QLedMatrix);
-    for(int row=0; row < rowCount; ++row)
+    switch(storageFormat)
+    {
+        case QLedMatrix::IndexedStorage:
+            return colorTable.at(constIndexScanLine(row)[col]);
+        case QLedMatrix::MonochromeStorage:
+            return testBit(constMonoScanLine(row), col) ? litLedColor.rgb()
+                                                        : darkLedColor.rgb();
+        default:
+            return constScanLine(row)[col];
+    }
+}
+
+/**
+ * \internal
+ * Sets the color of a LED, without checking its position.
+ */
+void QLedMatrixPrivate::setPixel(int row, int col, QRgb rgb)
+{
+    switch(storageFormat)
+    {
+        case QLedMatrix::IndexedStorage:
+            indexScanLine(row)[col] = colorIndex(rgb);
+            break;
+        case QLedMatrix::MonochromeStorage:
+            setBit(monoScanLine(row), col, rgb != darkLedColor.rgb());
+            break;
+        default:
+            scanLine(row)[col] = rgb;
+            break;
+    }
+}
+
+/**
+ * \internal
+ * Returns the colors of a row of LEDs. In RgbStorage the frame buffer is
+ * returned directly, otherwise the colors are converted in \a buffer, which
+ * must hold columnCount values.
+ */
+const QRgb* QLedMatrixPrivate::fetchScanLine(int row, QRgb* buffer) const
+{
+    if(storageFormat == QLedMatrix::IndexedStorage)
+    {
+        const uchar* line = constIndexScanLine(row);
+        const QRgb* table = colorTable.constData();
+        for(int col=0; col < columnCount; ++col)
+        {
+            buffer[col] = table[line[col]];
+        }
+        return buffer;
+    }
+    else if(storageFormat == QLedMatrix::MonochromeStorage)
     {
-        painter.save();
+        const quint32* line = constMonoScanLine(row);
+        const QRgb colors[2] = { darkLedColor.rgb(), litLedColor.rgb() };
         for(int col=0; col < columnCount; ++col)
         {
-            painter.setBrush(QColor(q->colorAt(row, col)));
-            painter.drawEllipse(QRectF(0.0, 0.0, 8.0, 8.0));
-            painter.translate(10.0, 0.0);
+            buffer[col] = colors[testBit(line, col)];
         }
-        painter.restore();
-        painter.translate(0.0, 10.0);
+        return buffer;
     }
+    return constScanLine(row);
 }
 
 /**
  * \internal
+ * Sets the colors of \a count LEDs of a row, from column \a col.
  */
-void QLedMatrixPrivate::calculateAspectRatio()
+void QLedMatrixPrivate::storeScanLine(int row, int col, const QRgb* data, int count)
 {
-    if(rowHeight > 0.0)
+    if(storageFormat == QLedMatrix::IndexedStorage)
     {
-        aspectRatio = columnWidth / rowHeight;
+        uchar* line = indexScanLine(row) + col;
+        QRgb previous = 0;
+        uchar index = 0;
+        for(int i=0; i < count; ++i)
+        {
+            // Avoid searching the palette for runs of the same color
+            if((i == 0) || (data[i] != previous))
+            {
+                previous = data[i];
+                index = colorIndex(previous);
+            }
+            line[i] = index;
+        }
+    }
+    else if(storageFormat == QLedMatrix::MonochromeStorage)
+    {
+        quint32* line = monoScanLine(row);
+        const QRgb dark = darkLedColor.rgb();
+        for(int i=0; i < count; ++i)
+        {
+            setBit(line, col + i, data[i] != dark);
+        }
+    }
+    else
+    {
+        memcpy(scanLine(row) + col, data, count * sizeof(QRgb));
     }
 }
 
-//////////////////////////////////
+/**
+ * \internal
+ * Sets all the LEDs to the given color.
+ */
+void QLedMatrixPrivate::fill(QRgb rgb)
+{
+    switch(storageFormat)
+    {
+        case QLedMatrix::IndexedStorage:
+            fillValues(indexLeds, rowCount * columnCount, uchar(colorIndex(rgb)));
+            break;
+        case QLedMatrix::MonochromeStorage:
+            fillValues(monoLeds, rowCount * monoStride(),
+                       (rgb != darkLedColor.rgb()) ? ~quint32(0) : quint32(0));
+            clearPadding();
+            break;
+        default:
+            fillValues(frameLeds, rowCount * columnCount, rgb);
+            break;
+    }
+}
 
 /**
- * \class QLedMatrix
- *
- * \brief The QLedMatrix widget simulates a LED matrix (dot matrix) display.
- *
- * A LED matrix display is a 2-dimensional array of dots used to generate
- * characters, symbols and images. It is often seen on machines, clocks and
- * display boards.
- *
- * This generic implementation can configured for any size of rows (greater
- * than 0) and columns. The number of colors is not limited, therefore it can
- * be used to make a monochrome, bi-color or even a full RGB display.
- *
- * Individual LEDs can be addressed in the matrix by their row and column
- * position. The index (0,0) is located in the upper left corner. Columns
- * grow from left to right, and rows grow from top to bottom.
- *
- * \version 0.6
- *
- * \author Pierre-Etienne Messier  <pierre.etienne.messier\@gmail.com>
+ * \internal
+ * Clears the bits past the last column of each row in MonochromeStorage, so
+ * that whole words can be inverted or shifted.
  */
+void QLedMatrixPrivate::clearPadding()
+{
+    const int stride = monoStride();
+    const int used = columnCount % 32;
+    if((used == 0) || (stride == 0))
+    {
+        return;
+    }
+
+    const quint32 mask = ~quint32(0) << (32 - used);
+    for(int row=0; row < rowCount; ++row)
+    {
+        monoScanLine(row)[stride - 1] &= mask;
+    }
+}
 
 /**
- * \enum QLedMatrix::LEDColor
- *
- * This type defines standard LED colors in the QRgb format, provided purely
- * for convenience.
+ * \internal
+ * Turns the LEDs that are on off, and the LEDs that are off on.
+ */
+void QLedMatrixPrivate::invert()
+{
+    const QRgb dark = darkLedColor.rgb();
+    const QRgb lit = litLedColor.rgb();
+    switch(storageFormat)
+    {
+        case QLedMatrix::IndexedStorage:
+        {
+            const uchar darkIndex = colorIndex(dark);
+            const uchar litIndex = colorIndex(lit);
+            const int count = rowCount * columnCount;
+            for(int i=0; i < count; ++i)
+            {
+                indexLeds[i] = (indexLeds[i] == darkIndex) ? litIndex : darkIndex;
+            }
+            break;
+        }
+        case QLedMatrix::MonochromeStorage:
+        {
+            quint32* words = monoLeds;
+            const int count = rowCount * monoStride();
+            for(int i=0; i < count; ++i)
+            {
+                words[i] = ~words[i];
+            }
+            clearPadding();
+            break;
+        }
+        default:
+        {
+            QRgb* colors = frameLeds;
+            const int count = rowCount * columnCount;
+            for(int i=0; i < count; ++i)
+            {
+                colors[i] = (colors[i] == dark) ? lit : dark;
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * \internal
+ * Sets the LEDs of a rectangle, which must be inside the display, to the
+ * given color.
+ */
+void QLedMatrixPrivate::fillLeds(const QRect& leds, QRgb rgb)
+{
+    if(leds.isEmpty())
+    {
+        return;
+    }
+
+    switch(storageFormat)
+    {
+        case QLedMatrix::IndexedStorage:
+        {
+            const uchar index = colorIndex(rgb);
+            for(int row=leds.top(); row <= leds.bottom(); ++row)
+            {
+                fillValues(indexScanLine(row) + leds.x(), leds.width(), index);
+            }
+            break;
+        }
+        case QLedMatrix::MonochromeStorage:
+        {
+            const bool on = (rgb != darkLedColor.rgb());
+            for(int row=leds.top(); row <= leds.bottom(); ++row)
+            {
+                quint32* line = monoScanLine(row);
+                for(int col=leds.left(); col <= leds.right(); ++col)
+                {
+                    setBit(line, col, on);
+                }
+            }
+            break;
+        }
+        default:
+            for(int row=leds.top(); row <= leds.bottom(); ++row)
+            {
+                fillValues(scanLine(row) + leds.x(), leds.width(), rgb);
+            }
+            break;
+    }
+}
+
+/**
+ * \internal
+ * Copies a rectangle of a row-major buffer to \a target with a block move
+ * per row. The rows are copied in the order that keeps overlapping
+ * rectangles correct.
+ */
+template <typename T>
+static void copyBlock(T* buffer, int stride, const QRect& source, const QPoint& target)
+{
+    const bool down = (target.y() > source.y());
+    for(int i=0; i < source.height(); ++i)
+    {
+        const int row = down ? source.height() - 1 - i : i;
+        memmove(buffer + (target.y() + row) * stride + target.x(),
+                buffer + (source.y() + row) * stride + source.x(),
+                source.width() * sizeof(T));
+    }
+}
+
+/**
+ * \internal
+ * Copies the LEDs of \a source, which must be inside the display, to the
+ * rectangle of the same size at \a target, also inside the display.
+ */
+void QLedMatrixPrivate::copyLeds(const QRect& source, const QPoint& target)
+{
+    switch(storageFormat)
+    {
+        case QLedMatrix::IndexedStorage:
+            copyBlock(indexLeds, columnCount, source, target);
+            break;
+        case QLedMatrix::MonochromeStorage:
+        {
+            // Bits are not byte aligned: copy through QRgb rows
+            QVector<QRgb> colors(source.height() * columnCount);
+            for(int row=0; row < source.height(); ++row)
+            {
+                QRgb* line = colors.data() + row * columnCount;
+                fetchScanLine(source.y() + row, line);
+            }
+            for(int row=0; row < source.height(); ++row)
+            {
+                storeScanLine(target.y() + row, target.x(),
+                              colors.constData() + row * columnCount + source.x(),
+                              source.width());
+            }
+            break;
+        }
+        default:
+            copyBlock(frameLeds, columnCount, source, target);
+            break;
+    }
+}
+
+/**
+ * \internal
+ * Moves the LEDs by \a dx columns and \a dy rows. The LEDs moved out of the
+ * display are lost, the vacated ones are set to \a rgb.
+ */
+void QLedMatrixPrivate::scroll(int dx, int dy, QRgb rgb)
+{
+    if((qAbs(dx) >= columnCount) || (qAbs(dy) >= rowCount))
+    {
+        fill(rgb);
+        return;
+    }
+
+    switch(storageFormat)
+    {
+        case QLedMatrix::IndexedStorage:
+            scrollBuffer(indexLeds, rowCount, columnCount, dx, dy,
+                         uchar(colorIndex(rgb)));
+            break;
+        case QLedMatrix::MonochromeStorage:
+        {
+            const int stride = monoStride();
+            if(dx != 0)
+            {
+                for(int row=0; row < rowCount; ++row)
+                {
+                    shiftBits(monoScanLine(row), stride, dx);
+                }
+                clearPadding();
+            }
+            scrollBuffer(monoLeds, rowCount, stride, 0, dy, quint32(0));
+
+            // The vacated LEDs are off, turn them on if needed
+            if(rgb != darkLedColor.rgb())
+            {
+                fillLeds(QRect((dx > 0) ? 0 : columnCount + dx, 0, qAbs(dx), rowCount), rgb);
+                fillLeds(QRect(0, (dy > 0) ? 0 : rowCount + dy, columnCount, qAbs(dy)), rgb);
+            }
+            break;
+        }
+        default:
+            scrollBuffer(frameLeds, rowCount, columnCount, dx, dy, rgb);
+            break;
+    }
+}
+
+/**
+ * \internal
+ * Moves the LEDs by \a dx columns and \a dy rows. The LEDs moved out of the
+ * display enter again from the opposite edge. Both distances must be smaller
+ * than the size of the display.
+ */
+void QLedMatrixPrivate::rotate(int dx, int dy)
+{
+    switch(storageFormat)
+    {
+        case QLedMatrix::IndexedStorage:
+            rotateBuffer(indexLeds, rowCount, columnCount, dx, dy);
+            break;
+        case QLedMatrix::MonochromeStorage:
+        {
+            const int stride = monoStride();
+            rotateBuffer(monoLeds, rowCount, stride, 0, dy);
+            if(dx == 0)
+            {
+                break;
+            }
+
+            // The LEDs that wrap around are the row shifted the other way
+            const int wrap = (dx > 0) ? dx - columnCount : dx + columnCount;
+            QVector<quint32> wrapped(stride);
+            for(int row=0; row < rowCount; ++row)
+            {
+                quint32* line = monoScanLine(row);
+                memcpy(wrapped.data(), line, stride * sizeof(quint32));
+                shiftBits(line, stride, dx);
+                shiftBits(wrapped.data(), stride, wrap);
+                for(int i=0; i < stride; ++i)
+                {
+                    line[i] |= wrapped.at(i);
+                }
+            }
+            clearPadding();
+            break;
+        }
+        default:
+            rotateBuffer(frameLeds, rowCount, columnCount, dx, dy);
+            break;
+    }
+}
+
+/**
+ * \internal
+ * Returns the palette index of the given color. A color that is not in the
+ * palette yet is added to it; when the palette is full, the index of the
+ * closest color is returned.
+ */
+int QLedMatrixPrivate::colorIndex(QRgb rgb)
+{
+    const int size = colorTable.size();
+    const QRgb* table = colorTable.constData();
+    for(int i=0; i < size; ++i)
+    {
+        if(table[i] == rgb)
+        {
+            return i;
+        }
+    }
+
+    if(size < MaxPaletteSize)
+    {
+        colorTable.append(rgb);
+        return size;
+    }
+
+    int closest = 0;
+    int closestDistance = INT_MAX;
+    for(int i=0; i < size; ++i)
+    {
+        const int r = qRed(table[i]) - qRed(rgb);
+        const int g = qGreen(table[i]) - qGreen(rgb);
+        const int b = qBlue(table[i]) - qBlue(rgb);
+        const int a = qAlpha(table[i]) - qAlpha(rgb);
+        const int distance = r * r + g * g + b * b + a * a;
+        if(distance < closestDistance)
+        {
+            closest = i;
+            closestDistance = distance;
+        }
+    }
+    return closest;
+}
+
+/**
+ * \internal
+ * Returns the position of the old content in a row or column of the new
+ * size, for the given anchor flags.
+ */
+static int anchorOffset(int oldSize, int newSize, Qt::Alignment anchor,
+                        Qt::Alignment end, Qt::Alignment center)
+{
+    if(anchor & end)
+    {
+        return newSize - oldSize;
+    }
+    if(anchor & center)
+    {
+        return (newSize - oldSize) / 2;
+    }
+    return 0;
+}
+
+/**
+ * \internal
+ * Resizes the display, see QLedMatrix::setMatrixSize(). Subclasses setting
+ * fixedSize resize the display with it.
+ */
+void QLedMatrixPrivate::resize(int rows, int columns, Qt::Alignment anchor)
+{
+    Q_Q(QLedMatrix);
+    if((rows == rowCount) && (columns == columnCount))
+    {
+        return;
+    }
+
+    resizeFrameBuffer(rows, columns, anchor);
+    calculateExtent();
+    q->update();
+}
+
+/**
+ * \internal
+ * Resizes the frame buffer to the given size, in a single copy. The LEDs that
+ * are common to both sizes keep their color and are aligned to \a anchor,
+ * the new ones are set to the dark LED color.
+ */
+void QLedMatrixPrivate::resizeFrameBuffer(int rows, int columns, Qt::Alignment anchor)
+{
+    const int dx = anchorOffset(columnCount, columns, anchor, Qt::AlignRight, Qt::AlignHCenter);
+    const int dy = anchorOffset(rowCount, rows, anchor, Qt::AlignBottom, Qt::AlignVCenter);
+    switch(storageFormat)
+    {
+        case QLedMatrix::IndexedStorage:
+        {
+            const uchar dark = colorIndex(darkLedColor.rgb());
+            resizeBuffer(indexBuffer, spareIndexBuffer, rowCount, columnCount,
+                         rows, columns, dx, dy, dark);
+            break;
+        }
+        case QLedMatrix::MonochromeStorage:
+            if(dx % 32 == 0)
+            {
+                resizeBuffer(monoBuffer, spareMonoBuffer, rowCount, monoStride(),
+                             rows, (columns + 31) / 32, dx / 32, dy, quint32(0));
+            }
+            else
+            {
+                resizeMonoBuffer(monoBuffer, spareMonoBuffer, rowCount, columnCount,
+                                 rows, columns, dx, dy);
+            }
+            break;
+        default:
+            resizeBuffer(frameBuffer, spareFrameBuffer, rowCount, columnCount,
+                         rows, columns, dx, dy, darkLedColor.rgb());
+            break;
+    }
+
+    attachBuffers();
+
+    // A transition can not go on with buffers of the old size
+    clearTransition();
+
+    rowCount = rows;
+    columnCount = columns;
+    recordPending = true;
+    backBufferValid = false;
+
+    if(storageFormat == QLedMatrix::MonochromeStorage)
+    {
+        clearPadding();
+    }
+}
+
+/**
+ * \internal
+ * Points the scanline accessors to the LED buffers again after they were
+ * reallocated. The fixed storage of a subclass is never reallocated.
+ */
+void QLedMatrixPrivate::attachBuffers()
+{
+    if(!fixedStorage)
+    {
+        frameLeds = frameBuffer.data();
+        indexLeds = indexBuffer.data();
+        monoLeds = monoBuffer.data();
+    }
+}
+
+/**
+ * \internal
+ * Returns true if the pixels of the first color of a Format_Mono or
+ * Format_MonoLSB image, the 0 bits, are the brightest ones.
+ */
+static inline bool isInvertedMonochrome(const QImage& image)
+{
+    return (image.colorCount() == 2) && (qGray(image.color(0)) > qGray(image.color(1)));
+}
+
+/**
+ * \internal
+ * Returns the bit of a pixel in a Format_Mono (or, with \a lsb,
+ * Format_MonoLSB) scanline.
+ */
+static inline bool monochromeBit(const uchar* bytes, int col, bool lsb)
+{
+    const uchar byte = bytes[col >> 3];
+    return lsb ? ((byte >> (col & 7)) & 1) : ((byte >> (7 - (col & 7))) & 1);
+}
+
+/**
+ * \internal
+ * Copies Format_Mono or Format_MonoLSB scanlines to the MonochromeStorage
+ * buffer, 32 LEDs at a time. Pixels using the brightest color of the image
+ * are on.
+ */
+void QLedMatrixPrivate::importMonochrome(const QImage& image)
+{
+    const int rows = qMin(image.height(), rowCount);
+    const int columns = qMin(image.width(), columnCount);
+    const int words = columns / 32;
+    const bool lsb = (image.format() == QImage::Format_MonoLSB);
+    const bool inverted = isInvertedMonochrome(image);
+
+    for(int row=0; row < rows; ++row)
+    {
+        const uchar* bytes = image.constScanLine(row);
+        quint32* line = monoScanLine(row);
+        for(int word=0; word < words; ++word)
+        {
+            const uchar* p = bytes + word * 4;
+            quint32 value;
+            if(lsb)
+            {
+                value = (quint32(reversedBits[p[0]]) << 24) | (quint32(reversedBits[p[1]]) << 16) |
+                        (quint32(reversedBits[p[2]]) << 8) | quint32(reversedBits[p[3]]);
+            }
+            else
+            {
+                value = qFromBigEndian<quint32>(p);
+            }
+            line[word] = inverted ? ~value : value;
+        }
+
+        // Remaining columns, one at a time
+        for(int col=words * 32; col < columns; ++col)
+        {
+            setBit(line, col, monochromeBit(bytes, col, lsb) != inverted);
+        }
+    }
+
+    clearPadding();
+    invalidate(QRect(0, 0, columns, rows));
+}
+
+/**
+ * \internal
+ * Sets the colors of a rectangle of LEDs from a buffer holding the first LED
+ * of the rectangle at \a data, then schedules its repaint. The parts of the
+ * rectangle outside the display are ignored.
+ */
+void QLedMatrixPrivate::copyPixels(const QRgb* data, const QRect& leds, int stride)
+{
+    const QRect rect = leds & QRect(0, 0, columnCount, rowCount);
+    if(rect.isEmpty())
+    {
+        return;
+    }
+    data += (rect.y() - leds.y()) * stride + (rect.x() - leds.x());
+
+    if((storageFormat == QLedMatrix::RgbStorage) &&
+       (rect.width() == columnCount) && (stride == columnCount))
+    {
+        memcpy(scanLine(rect.y()), data, rect.height() * columnCount * sizeof(QRgb));
+    }
+    else
+    {
+        for(int row=0; row < rect.height(); ++row)
+        {
+            storeScanLine(rect.y() + row, rect.x(), data + row * stride, rect.width());
+        }
+    }
+    invalidate(rect);
+}
+
+/**
+ * \internal
+ * Turns on the LEDs of a glyph run (see QLedMatrixFont::render()) whose top
+ * left corner is at (\a row, \a col). The LEDs of the blank bits and the
+ * ones outside the display are left unchanged.
+ */
+void QLedMatrixPrivate::drawColumns(const quint32* columns, int count, int height,
+                                    int row, int col, QRgb rgb)
+{
+    const int firstColumn = qMax(0, -col);
+    const int lastColumn = qMin(count, columnCount - col);
+    const int firstRow = qMax(0, -row);
+    const int lastRow = qMin(height, rowCount - row);
+    for(int i=firstColumn; i < lastColumn; ++i)
+    {
+        const quint32 bits = columns[i];
+        if(bits == 0)
+        {
+            continue;
+        }
+
+        for(int j=firstRow; j < lastRow; ++j)
+        {
+            if(bits & (quint32(1) << j))
+            {
+                setPixel(row + j, col + i, rgb);
+            }
+        }
+    }
+}
+
+/**
+ * \internal
+ * Returns the next value of a xorshift generator.
+ */
+static inline quint32 nextRandom(quint32& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/**
+ * \internal
+ * Saves the current colors and the colors of the given frame for
+ * stepTransition(). Only the LEDs whose color changes are kept track of: the
+ * changed columns of each row and, for a dissolve, the changed LEDs in a
+ * random order.
+ */
+void QLedMatrixPrivate::startTransition(const QImage& frame, QLedMatrix::TransitionType type)
+{
+    const int count = rowCount * columnCount;
+    transitionSource.resize(count);
+    for(int row=0; row < rowCount; ++row)
+    {
+        QRgb* dst = transitionSource.data() + row * columnCount;
+        const QRgb* line = fetchScanLine(row, dst);
+        if(line != dst)
+        {
+            memcpy(dst, line, columnCount * sizeof(QRgb));
+        }
+    }
+
+    // As with setFrame(), the LEDs outside of the frame keep their color and
+    // monochrome images are read bit by bit in MonochromeStorage
+    transitionTarget = transitionSource;
+    const int rows = qMin(frame.height(), rowCount);
+    const int columns = qMin(frame.width(), columnCount);
+    const QRgb dark = darkLedColor.rgb();
+    const QRgb lit = litLedColor.rgb();
+    if((storageFormat == QLedMatrix::MonochromeStorage) &&
+       ((frame.format() == QImage::Format_Mono) || (frame.format() == QImage::Format_MonoLSB)))
+    {
+        const bool lsb = (frame.format() == QImage::Format_MonoLSB);
+        const bool inverted = isInvertedMonochrome(frame);
+        for(int row=0; row < rows; ++row)
+        {
+            const uchar* bytes = frame.constScanLine(row);
+            QRgb* dst = transitionTarget.data() + row * columnCount;
+            for(int col=0; col < columns; ++col)
+            {
+                dst[col] = (monochromeBit(bytes, col, lsb) != inverted) ? lit : dark;
+            }
+        }
+    }
+    else
+    {
+        QImage source = frame;
+        if((source.format() != QImage::Format_ARGB32) &&
+           (source.format() != QImage::Format_RGB32))
+        {
+            source = source.convertToFormat(QImage::Format_ARGB32);
+        }
+        for(int row=0; row < rows; ++row)
+        {
+            const QRgb* src = reinterpret_cast<const QRgb*>(source.constScanLine(row));
+            QRgb* dst = transitionTarget.data() + row * columnCount;
+            if(storageFormat == QLedMatrix::MonochromeStorage)
+            {
+                for(int col=0; col < columns; ++col)
+                {
+                    dst[col] = (src[col] != dark) ? lit : dark;
+                }
+            }
+            else
+            {
+                memcpy(dst, src, columns * sizeof(QRgb));
+            }
+        }
+    }
+
+    transitionSpans.fill(-1, 2 * rowCount);
+    transitionOrder.clear();
+    for(int row=0; row < rowCount; ++row)
+    {
+        const QRgb* from = transitionSource.constData() + row * columnCount;
+        const QRgb* to = transitionTarget.constData() + row * columnCount;
+        int first = 0;
+        int last = columnCount - 1;
+        while((first <= last) && (from[first] == to[first]))
+        {
+            ++first;
+        }
+        while((last >= first) && (from[last] == to[last]))
+        {
+            --last;
+        }
+        if(first > last)
+        {
+            continue;
+        }
+        transitionSpans[2 * row] = first;
+        transitionSpans[2 * row + 1] = last;
+
+        if(type == QLedMatrix::Dissolve)
+        {
+            for(int col=first; col <= last; ++col)
+            {
+                if(from[col] != to[col])
+                {
+                    transitionOrder.append(row * columnCount + col);
+                }
+            }
+        }
+    }
+
+    // Fisher-Yates shuffle
+    for(int i=transitionOrder.size() - 1; i > 0; --i)
+    {
+        const int j = int(nextRandom(transitionSeed) % quint32(i + 1));
+        qSwap(transitionOrder[i], transitionOrder[j]);
+    }
+
+    transitionType = type;
+    transitionPosition = 0;
+    transitionLevel = -1;
+}
+
+/**
+ * \internal
+ * Changes the LEDs due at the current time of the transition, at most
+ * TransitionBudget of them: when more are due, the next step goes on. Wipes
+ * and crossfades change whole rows or columns, and a step always changes at
+ * least one of them, even if it is longer than the budget. Only the LEDs
+ * whose color changes are written and repainted. Returns true once all the
+ * LEDs have their final color.
+ *
+ * A crossfade is done in passes blending all the changed LEDs at the same
+ * level; a pass larger than the budget spans several steps. The LEDs of a
+ * dissolve are scattered over the display, they are repainted by squares of
+ * DissolveTileSize LEDs rather than by their bounding rectangle.
+ */
+bool QLedMatrixPrivate::stepTransition()
+{
+    const qint64 elapsed = transitionClock.elapsed();
+    const qreal progress = (elapsed >= transitionDuration) ? 1.0
+                                                           : qreal(elapsed) / transitionDuration;
+    const QRgb* source = transitionSource.constData();
+    const QRgb* target = transitionTarget.constData();
+    const int* spans = transitionSpans.constData();
+    int budget = TransitionBudget;
+    QRect changed;
+    bool done = false;
+
+    switch(transitionType)
+    {
+        case QLedMatrix::Crossfade:
+        {
+            if(transitionPosition == 0)
+            {
+                // Nothing to blend until the level changes
+                const int level = qRound(progress * 256);
+                if(level == transitionLevel)
+                {
+                    break;
+                }
+                transitionLevel = level;
+            }
+            const QLedMatrixKernels& kernels = QLedMatrixKernels::instance();
+            const bool direct = (storageFormat == QLedMatrix::RgbStorage);
+            QVector<QRgb> buffer(direct ? 0 : columnCount);
+            while(transitionPosition < rowCount)
+            {
+                const int row = transitionPosition;
+                const int first = spans[2 * row];
+                if(first < 0)
+                {
+                    ++transitionPosition;
+                    continue;
+                }
+                const int count = spans[2 * row + 1] - first + 1;
+                if((count > budget) && (budget < TransitionBudget))
+                {
+                    break;
+                }
+                ++transitionPosition;
+                const int offset = row * columnCount + first;
+                QRgb* line = direct ? scanLine(row) + first : buffer.data();
+                kernels.blend(line, source + offset, target + offset, count, transitionLevel);
+                if(!direct)
+                {
+                    storeScanLine(row, first, line, count);
+                }
+                changed |= QRect(first, row, count, 1);
+                budget -= count;
+            }
+            if(transitionPosition == rowCount)
+            {
+                done = (transitionLevel == 256);
+                transitionPosition = 0;
+            }
+            break;
+        }
+        case QLedMatrix::WipeLeft:
+        case QLedMatrix::WipeRight:
+        {
+            const int due = qRound(progress * columnCount);
+            for(; (transitionPosition < due) &&
+                  ((budget >= rowCount) || (budget == TransitionBudget)); ++transitionPosition)
+            {
+                const int col = (transitionType == QLedMatrix::WipeRight)
+                                ? transitionPosition : columnCount - 1 - transitionPosition;
+                for(int row=0; row < rowCount; ++row)
+                {
+                    const int offset = row * columnCount + col;
+                    if((col >= spans[2 * row]) && (col <= spans[2 * row + 1]) &&
+                       (source[offset] != target[offset]))
+                    {
+                        setPixel(row, col, target[offset]);
+                        changed |= QRect(col, row, 1, 1);
+                    }
+                }
+                budget -= rowCount;
+            }
+            done = (transitionPosition == columnCount);
+            break;
+        }
+        case QLedMatrix::WipeUp:
+        case QLedMatrix::WipeDown:
+        {
+            const int due = qRound(progress * rowCount);
+            for(; transitionPosition < due; ++transitionPosition)
+            {
+                const int row = (transitionType == QLedMatrix::WipeDown)
+                                ? transitionPosition : rowCount - 1 - transitionPosition;
+                const int first = spans[2 * row];
+                if(first >= 0)
+                {
+                    const int count = spans[2 * row + 1] - first + 1;
+                    if((count > budget) && (budget < TransitionBudget))
+                    {
+                        break;
+                    }
+                    storeScanLine(row, first, target + row * columnCount + first, count);
+                    changed |= QRect(first, row, count, 1);
+                    budget -= count;
+                }
+            }
+            done = (transitionPosition == rowCount);
+            break;
+        }
+        case QLedMatrix::Dissolve:
+        {
+            const int due = qRound(progress * transitionOrder.size());
+            const int end = qMin(due, transitionPosition + budget);
+            if(transitionPosition >= end)
+            {
+                done = (transitionPosition == transitionOrder.size());
+                break;
+            }
+
+            // Marks the tiles holding the changed LEDs
+            const int tileColumns = (columnCount + DissolveTileSize - 1) / DissolveTileSize;
+            const int tileRows = (rowCount + DissolveTileSize - 1) / DissolveTileSize;
+            QVector<bool> tiles(tileColumns * tileRows, false);
+            for(; transitionPosition < end; ++transitionPosition)
+            {
+                const int led = transitionOrder.at(transitionPosition);
+                const int row = led / columnCount;
+                const int col = led % columnCount;
+                setPixel(row, col, target[led]);
+                tiles[(row / DissolveTileSize) * tileColumns + col / DissolveTileSize] = true;
+            }
+
+            // Repaints the runs of marked tiles of each row of tiles
+            for(int tileRow=0; tileRow < tileRows; ++tileRow)
+            {
+                const bool* marks = tiles.constData() + tileRow * tileColumns;
+                for(int first=0; first < tileColumns; ++first)
+                {
+                    if(!marks[first])
+                    {
+                        continue;
+                    }
+                    int last = first;
+                    while((last + 1 < tileColumns) && marks[last + 1])
+                    {
+                        ++last;
+                    }
+                    const QRect run(first * DissolveTileSize, tileRow * DissolveTileSize,
+                                    (last - first + 1) * DissolveTileSize, DissolveTileSize);
+                    invalidate(run & QRect(0, 0, columnCount, rowCount));
+                    first = last;
+                }
+            }
+            done = (transitionPosition == transitionOrder.size());
+            break;
+        }
+    }
+
+    if(!changed.isEmpty())
+    {
+        invalidate(changed);
+    }
+    return done;
+}
+
+/**
+ * \internal
+ * Stops the transition and frees its buffers, the LEDs are left as they are.
+ */
+void QLedMatrixPrivate::clearTransition()
+{
+    if(transitionTimer != 0)
+    {
+        transitionTimer->stop();
+    }
+    transitionSource = QVector<QRgb>();
+    transitionTarget = QVector<QRgb>();
+    transitionSpans = QVector<int>();
+    transitionOrder = QVector<int>();
+}
+
+/**
+ * \internal
+ * Schedules a repaint of the given LEDs (in row and column coordinates) only.
+ * While an update is in progress, the LEDs are only marked as dirty.
+ */
+void QLedMatrixPrivate::invalidate(const QRect& leds)
+{
+    Q_Q(QLedMatrix);
+    recordPending = true;
+    if(updateDepth > 0)
+    {
+        dirtyLeds |= leds;
+        return;
+    }
+
+    if((rowHeight <= 0.0) || (columnWidth <= 0.0))
+    {
+        return;
+    }
+
+    if(renderMode == QLedMatrix::BufferedRendering)
+    {
+        backBufferDirtyLeds |= leds;
+    }
+
+    ensureTransform();
+    q->update(deviceRect(leds));
+    if(statsEnabled)
+    {
+        ++updateRequests;
+    }
+}
+
+/**
+ * \internal
+ * Schedules the repaint of the display after its LEDs were moved by \a dx
+ * columns and \a dy rows. When the move is a whole number of pixels, the
+ * pixels already rendered are moved as well (in the back buffer and on the
+ * widget), and only the LEDs that entered the display are repainted.
+ */
+void QLedMatrixPrivate::invalidateScrolled(int dx, int dy)
+{
+    Q_Q(QLedMatrix);
+    const QRect all(0, 0, columnCount, rowCount);
+    if((updateDepth > 0) || (rowHeight <= 0.0) || (columnWidth <= 0.0) ||
+       (qAbs(dx) >= columnCount) || (qAbs(dy) >= rowCount) || !q->isVisible() ||
+       ((dx != 0) && (panelColumns > 0)) || ((dy != 0) && (panelRows > 0)))
+    {
+        invalidate(all);
+        return;
+    }
+
+    ensureTransform();
+    const qreal pixelsX = dx * 10.0 * transform.m11();
+    const qreal pixelsY = dy * 10.0 * transform.m22();
+    const QPoint offset(qRound(pixelsX), qRound(pixelsY));
+
+    // Sprites are drawn at rounded positions, they only keep their shape
+    // under a whole number of pixels
+    if((qAbs(pixelsX - offset.x()) > 0.001) || (qAbs(pixelsY - offset.y()) > 0.001))
+    {
+        invalidate(all);
+        return;
+    }
+
+    const QRect area = deviceRect(all) & q->rect();
+    if(renderMode == QLedMatrix::BufferedRendering)
+    {
+        if(!backBufferValid || (backBuffer.size() != q->size()) ||
+           (backBufferTransform != transform))
+        {
+            // The back buffer is rebuilt by the next paint anyway
+            invalidate(all);
+            return;
+        }
+
+        scrollImage(backBuffer, area, offset.x(), offset.y());
+        backBufferDirtyLeds = backBufferDirtyLeds.translated(dx, dy) & all;
+    }
+    q->scroll(offset.x(), offset.y(), area);
+    if(statsEnabled)
+    {
+        ++updateRequests;
+    }
+
+    if(dx != 0)
+    {
+        invalidate(QRect((dx > 0) ? 0 : columnCount + dx, 0, qAbs(dx), rowCount));
+    }
+    if(dy != 0)
+    {
+        invalidate(QRect(0, (dy > 0) ? 0 : rowCount + dy, columnCount, qAbs(dy)));
+    }
+}
+
+/**
+ * \internal
+ * Fills the \a exposed rectangle with the background. In transparent mode,
+ * the rectangle is cleared if the painter paints on the back buffer (or a
+ * band of it).
+ */
+void QLedMatrixPrivate::drawBackground(QPainter& painter, const QRect& exposed) const
+{
+    if(backgroundMode == Qt::OpaqueMode)
+    {
+        painter.setBrush(backgroundBrush);
+        painter.drawRect(exposed);
+    }
+    else if(painter.device() != q_ptr)
+    {
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.fillRect(exposed, Qt::transparent);
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+    }
+}
+
+/**
+ * \internal
+ * Tells Qt whether paint events cover the exposed area, which lets it move
+ * the pixels on screen in invalidateScrolled() and skip painting the parent
+ * widget behind the display.
+ */
+void QLedMatrixPrivate::updateOpaquePaint()
+{
+    Q_Q(QLedMatrix);
+    const bool opaque = (backgroundMode == Qt::OpaqueMode) &&
+                        (backgroundBrush.color().alpha() == 255);
+    q->setAttribute(Qt::WA_OpaquePaintEvent, opaque);
+}
+
+/**
+ * \internal
+ * Rasterizes the LEDs changed since the last paint event in the back buffer.
+ * The whole buffer is rebuilt when the widget is resized or when the scale
+ * factor changes. Each rectangle of the dirty LEDs is rasterized on its own,
+ * so scattered changes (as done by a dissolve) do not rebuild the LEDs
+ * between them.
+ */
+void QLedMatrixPrivate::updateBackBuffer()
+{
+    Q_Q(QLedMatrix);
+    QVector<QRect> areas;
+    if(!backBufferValid || (backBuffer.size() != q->size()) ||
+       (backBufferTransform != transform))
+    {
+        if(backBuffer.size() != q->size())
+        {
+            backBuffer = QImage(q->size(), QImage::Format_ARGB32_Premultiplied);
+        }
+        backBufferTransform = transform;
+        backBufferValid = true;
+        areas.append(backBuffer.rect());
+    }
+    else
+    {
+        const QVector<QRect> dirtyLeds = regionRects(backBufferDirtyLeds);
+        for(int i=0; i < dirtyLeds.size(); ++i)
+        {
+            const QRect dirty = deviceRect(dirtyLeds.at(i)) & backBuffer.rect();
+            if(!dirty.isEmpty())
+            {
+                areas.append(dirty);
+            }
+        }
+    }
+    backBufferDirtyLeds = QRegion();
+
+    for(int i=0; i < areas.size(); ++i)
+    {
+        rasterizeArea(areas.at(i));
+    }
+}
+
+/**
+ * \internal
+ * Rasterizes a \a dirty rectangle of the back buffer.
+ *
+ * Round LEDs are drawn from QImage sprites, which can be used by other
+ * threads: large areas are split in horizontal bands rasterized in
+ * parallel. A single band is rasterized by the same code, so the result does
+ * not depend on the number of threads.
+ */
+void QLedMatrixPrivate::rasterizeArea(const QRect& dirty)
+{
+    const QLedMatrixGeometry geometry = ledGeometry();
+    if(geometry.detail == QLedMatrixGeometry::ImageDetail)
+    {
+        // A pixel per LED or less, drawLEDs() draws a single image
+        QPainter painter(&backBuffer);
+        painter.setPen(Qt::NoPen);
+        painter.setClipRect(dirty);
+        drawBackground(painter, dirty);
+        drawLEDs(painter, dirty);
+        return;
+    }
+
+    const QRect leds = ledsIn(dirty);
+    if(statsEnabled)
+    {
+        ledsDrawn += leds.width() * leds.height();
+    }
+    if(geometry.detail == QLedMatrixGeometry::SpriteDetail)
+    {
+        prepareSpriteImages(leds);
+    }
+
+    uchar* bits = backBuffer.bits();
+    const int count = bandCount(dirty, leds);
+#ifndef QT_NO_CONCURRENT
+    if(count > 1)
+    {
+        QVector<Band> bands(count);
+        for(int i=0; i < count; ++i)
+        {
+            const int top = dirty.top() + dirty.height() * i / count;
+            const int bottom = dirty.top() + dirty.height() * (i + 1) / count;
+            bands[i].d = this;
+            bands[i].bits = bits;
+            bands[i].rect = QRect(dirty.left(), top, dirty.width(), bottom - top);
+        }
+        QtConcurrent::blockingMap(bands, rasterizeBandEntry);
+        return;
+    }
+#endif
+    rasterizeBand(bits, dirty);
+}
+
+/**
+ * \internal
+ * Returns the number of bands to rasterize in parallel for the given
+ * device and LED rectangles.
+ */
+int QLedMatrixPrivate::bandCount(const QRect& dirty, const QRect& leds) const
+{
+    if((renderThreads == 1) || (leds.width() * leds.height() < ParallelMinLeds))
+    {
+        return 1;
+    }
+
+    const int threads = (renderThreads > 0) ? renderThreads : QThread::idealThreadCount();
+    return qBound(1, dirty.height() / MinBandHeight, qMax(1, threads));
+}
+
+/**
+ * \internal
+ * Draws the background and the LEDs of a band of the back buffer, through a
+ * QImage sharing its scanlines. It only reads the state of the display and
+ * can be run by any thread.
+ */
+void QLedMatrixPrivate::rasterizeBand(uchar* bits, const QRect& band) const
+{
+    QImage slice(bits + band.top() * backBuffer.bytesPerLine(), backBuffer.width(),
+                 band.height(), backBuffer.bytesPerLine(), backBuffer.format());
+
+    QPainter painter(&slice);
+    painter.setPen(Qt::NoPen);
+    painter.translate(0, -band.top());
+    painter.setClipRect(band);
+    drawBackground(painter, band);
+
+    rasterizeLeds(painter, ledsIn(band));
+}
+
+/**
+ * \internal
+ * Draws the given LEDs as round sprites or, below the detail threshold, as
+ * squares, with the routine shared with QLedMatrixRenderer. The sprites must
+ * have been prepared; it only reads the state of the display and can be run
+ * by any thread.
+ */
+void QLedMatrixPrivate::rasterizeLeds(QPainter& painter, const QRect& leds) const
+{
+    if(leds.isEmpty())
+    {
+        return;
+    }
+
+    const QLedMatrixGeometry geometry = ledGeometry();
+    QVarLengthArray<int, 256> x(leds.width());
+    geometry.columnPositions(leds.left(), leds.width(), x.data());
+
+    QVector<QRgb> buffer(columnCount);
+    for(int row=leds.top(); row <= leds.bottom(); ++row)
+    {
+        const QRgb* line = fetchScanLine(row, buffer.data());
+        QLedMatrixRendererPrivate::drawRow(painter, geometry, spriteImages, line + leds.left(),
+                                           x.constData(), leds.width(), row);
+    }
+}
+
+/**
+ * \internal
+ * Adds the sprites of the colors of the given LEDs missing from
+ * spriteImages, before the LEDs are rasterized. The sprites come from the
+ * cache shared with QLedMatrixRenderer.
+ */
+void QLedMatrixPrivate::prepareSpriteImages(const QRect& leds)
+{
+    const qreal diameter = ledGeometry().diameter;
+    if((diameter != spriteImageDiameter) || (spriteImages.size() >= MaxSpriteImages))
+    {
+        spriteImageDiameter = diameter;
+        spriteImages.clear();
+    }
+
+    if(storageFormat == QLedMatrix::IndexedStorage)
+    {
+        QLedMatrixRendererPrivate::addSprites(spriteImages, colorTable.constData(),
+                                              colorTable.size(), diameter);
+    }
+    else if(storageFormat == QLedMatrix::MonochromeStorage)
+    {
+        const QRgb colors[2] = { darkLedColor.rgb(), litLedColor.rgb() };
+        QLedMatrixRendererPrivate::addSprites(spriteImages, colors, 2, diameter);
+    }
+    else
+    {
+        for(int row=leds.top(); row <= leds.bottom(); ++row)
+        {
+            QLedMatrixRendererPrivate::addSprites(spriteImages, constScanLine(row) + leds.left(),
+                                                  leds.width(), diameter);
+        }
+    }
+}
+
+/**
+ * \internal
+ * Returns the LEDs whose sprite overlaps the \a exposed device rectangle.
+ */
+QRect QLedMatrixPrivate::ledsIn(const QRect& exposed) const
+{
+    const qreal diameter = 8.0 * transform.m11();
+    const int firstRow = qMax(0, rowAt((exposed.top() - transform.dy() - diameter - 1.0) / transform.m22()));
+    const int lastRow = qMin(rowCount - 1, rowAt((exposed.bottom() - transform.dy() + 1.0) / transform.m22()));
+    const int firstCol = qMax(0, columnAt((exposed.left() - transform.dx() - diameter - 1.0) / transform.m11()));
+    const int lastCol = qMin(columnCount - 1, columnAt((exposed.right() - transform.dx() + 1.0) / transform.m11()));
+    if((lastRow < firstRow) || (lastCol < firstCol))
+    {
+        return QRect();
+    }
+    return QRect(QPoint(firstCol, firstRow), QPoint(lastCol, lastRow));
+}
+
+/**
+ * \internal
+ * Draws the LEDs that intersect the \a exposed rectangle with the sprites of
+ * the current scale factor. The painter must not be transformed; the LED
+ * positions are mapped with \a transform.
+ *
+ * The level of detail drops with the size of the LEDs: below the detail
+ * threshold they are drawn as squares, and at a pixel per LED or less the
+ * whole matrix is drawn as a single scaled image.
+ */
+void QLedMatrixPrivate::drawLEDs(QPainter& painter, const QRect& exposed)
+{
+    const QLedMatrixGeometry geometry = ledGeometry();
+    if(geometry.detail == QLedMatrixGeometry::ImageDetail)
+    {
+        drawLedImage(painter);
+        if(statsEnabled)
+        {
+            ledsDrawn += rowCount * columnCount;
+        }
+        return;
+    }
+
+    // Only the LEDs whose sprite overlaps the exposed rectangle are drawn
+    const QRect leds = ledsIn(exposed);
+    if(statsEnabled)
+    {
+        ledsDrawn += leds.width() * leds.height();
+    }
+    if(geometry.detail == QLedMatrixGeometry::SpriteDetail)
+    {
+        prepareSpriteImages(leds);
+    }
+    rasterizeLeds(painter, leds);
+}
+
+/**
+ * \internal
+ * Draws the whole matrix as an image of a pixel per LED, scaled down to the
+ * LED area of each panel. As with the sprites, the alpha channel of the
+ * colors is ignored. The frame buffer is used directly in RgbStorage.
+ */
+void QLedMatrixPrivate::drawLedImage(QPainter& painter)
+{
+    QImage image;
+    if(storageFormat == QLedMatrix::RgbStorage)
+    {
+        image = QImage(reinterpret_cast<const uchar*>(frameLeds),
+                       columnCount, rowCount, columnCount * sizeof(QRgb),
+                       QImage::Format_RGB32);
+    }
+    else
+    {
+        if(ledImage.size() != QSize(columnCount, rowCount))
+        {
+            ledImage = QImage(columnCount, rowCount, QImage::Format_RGB32);
+        }
+        for(int row=0; row < rowCount; ++row)
+        {
+            QRgb* line = reinterpret_cast<QRgb*>(ledImage.scanLine(row));
+            const QRgb* colors = fetchScanLine(row, line);
+            if(colors != line)
+            {
+                memcpy(line, colors, columnCount * sizeof(QRgb));
+            }
+        }
+        image = ledImage;
+    }
+
+    const int stepRows = (panelRows > 0) ? panelRows : rowCount;
+    const int stepColumns = (panelColumns > 0) ? panelColumns : columnCount;
+    painter.save();
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, smoothScaling);
+    for(int row=0; row < rowCount; row += stepRows)
+    {
+        for(int col=0; col < columnCount; col += stepColumns)
+        {
+            const QRect source = QRect(col, row, stepColumns, stepRows) & image.rect();
+            const QRectF target(transform.dx() + ledX(col) * transform.m11(),
+                                transform.dy() + ledY(row) * transform.m22(),
+                                source.width() * 10.0 * transform.m11(),
+                                source.height() * 10.0 * transform.m22());
+            painter.drawImage(target, image, source);
+        }
+    }
+    painter.restore();
+}
+
+/**
+ * \internal
+ */
+void QLedMatrixPrivate::calculateAspectRatio()
+{
+    if(rowHeight > 0.0)
+    {
+        aspectRatio = columnWidth / rowHeight;
+    }
+}
+
+/**
+ * \internal
+ * Calculates the size of the LED area, in LED coordinates (10 units per
+ * LED, plus the spacing between panels).
+ */
+void QLedMatrixPrivate::calculateExtent()
+{
+    rowHeight = (rowCount > 0) ? ledY(rowCount - 1) + 10.0 : 0.0;
+    columnWidth = (columnCount > 0) ? ledX(columnCount - 1) + 10.0 : 0.0;
+    calculateAspectRatio();
+    transformDirty = true;
+}
+
+/**
+ * \internal
+ * Returns the column at the given position in LED coordinates. Positions in
+ * the spacing after a panel belong to its last column.
+ */
+int QLedMatrixPrivate::columnAt(qreal x) const
+{
+    if(panelColumns <= 0)
+    {
+        return qFloor(x / 10.0);
+    }
+    const qreal period = 10.0 * (panelColumns + panelSpacing);
+    const int panel = qFloor(x / period);
+    return panel * panelColumns + qMin(panelColumns - 1, qFloor((x - panel * period) / 10.0));
+}
+
+/**
+ * \internal
+ * Returns the row at the given position in LED coordinates. Positions in the
+ * spacing after a panel belong to its last row.
+ */
+int QLedMatrixPrivate::rowAt(qreal y) const
+{
+    if(panelRows <= 0)
+    {
+        return qFloor(y / 10.0);
+    }
+    const qreal period = 10.0 * (panelRows + panelSpacing);
+    const int panel = qFloor(y / period);
+    return panel * panelRows + qMin(panelRows - 1, qFloor((y - panel * period) / 10.0));
+}
+
+/**
+ * \internal
+ * Returns the placement and the level of detail of the LEDs at the current
+ * scale factor, for the drawing routines shared with QLedMatrixRenderer.
+ */
+QLedMatrixGeometry QLedMatrixPrivate::ledGeometry() const
+{
+    QLedMatrixGeometry geometry(QPointF(transform.dx(), transform.dy()),
+                                10.0 * transform.m11(), 10.0 * transform.m22(),
+                                8.0 * transform.m11(), detailThreshold, false);
+    geometry.panelColumns = panelColumns;
+    geometry.panelRows = panelRows;
+    geometry.panelSpacing = panelSpacing;
+    return geometry;
+}
+
+/**
+ * \internal
+ * Calculates the transformation from LED coordinates (10 units per LED) to
+ * the coordinates of a widget of the given size, keeping the aspect ratio.
+ */
+void QLedMatrixPrivate::calculateTransform(int width, int height)
+{
+    const qreal w = width;
+    const qreal h = height;
+    const qreal currentAspectRatio  = w / h;
+
+    transform.reset();
+    transform.translate(w / 2.0, h / 2.0);
+
+    // Set the scale factor to keep the aspect ratio
+    if(currentAspectRatio > aspectRatio)
+    {
+        qreal side = h / rowHeight;
+        transform.scale(side, side);
+    }
+    else if(currentAspectRatio < aspectRatio)
+    {
+        qreal side = w / columnWidth;
+        transform.scale(side, side);
+    }
+    else
+    {
+        transform.scale(w / columnWidth, h / rowHeight);
+    }
+
+    transform.translate(1.0 - (columnWidth/2), 1.0 - (rowHeight/2));
+
+    transformSize = QSize(width, height);
+    transformDirty = false;
+}
+
+/**
+ * \internal
+ * Recalculates the transformation if the widget or the matrix was resized
+ * since the last calculation.
+ */
+void QLedMatrixPrivate::ensureTransform()
+{
+    Q_Q(QLedMatrix);
+    if(transformDirty || (transformSize != q->size()))
+    {
+        calculateTransform(q->width(), q->height());
+    }
+}
+
+/**
+ * \internal
+ * Returns the device rectangle covered by the sprites of the given LEDs. It
+ * is enlarged by a pixel on each side to account for the rounding of the
+ * sprite positions.
+ */
+QRect QLedMatrixPrivate::deviceRect(const QRect& leds) const
+{
+    const qreal left = ledX(leds.left());
+    const qreal top = ledY(leds.top());
+    const QRectF rect(left, top, ledX(leds.right()) + 8.0 - left,
+                      ledY(leds.bottom()) + 8.0 - top);
+    return transform.mapRect(rect).toAlignedRect().adjusted(-1, -1, 2, 2);
+}
+
+//////////////////////////////////
+
+/**
+ * \class QLedMatrix
+ *
+ * \brief The QLedMatrix widget simulates a LED matrix (dot matrix) display.
+ *
+ * A LED matrix display is a 2-dimensional array of dots used to generate
+ * characters, symbols and images. It is often seen on machines, clocks and
+ * display boards.
+ *
+ * This generic implementation can configured for any size of rows (greater
+ * than 0) and columns. The number of colors is not limited, therefore it can
+ * be used to make a monochrome, bi-color or even a full RGB display.
+ *
+ * Individual LEDs can be addressed in the matrix by their row and column
+ * position. The index (0,0) is located in the upper left corner. Columns
+ * grow from left to right, and rows grow from top to bottom.
+ *
+ * The LEDs are drawn by the same code as QLedMatrixRenderer, from antialiased
+ * sprites rendered once per color and scale factor. The sprites are shared by
+ * all the LED matrix displays and renderers through a process-wide cache,
+ * whose limit (see QLedMatrixRenderer::setSpriteCacheLimit()) bounds the
+ * memory they use.
+ *
+ * \version 0.6
+ *
+ * \author Pierre-Etienne Messier  <pierre.etienne.messier\@gmail.com>
+ */
+
+/**
+ * \enum QLedMatrix::LEDColor
+ *
+ * This type defines standard LED colors in the QRgb format, provided purely
+ * for convenience.
+ *
+ * \sa QRgb
+ */
+
+/**
+ * \enum QLedMatrix::RenderMode
+ *
+ * This type defines how the LEDs are drawn on the widget.
+ *
+ * \sa setRenderMode()
+ */
+
+/**
+ * \var QLedMatrix::RenderMode QLedMatrix::DirectRendering
+ * The LEDs exposed by a paint event are drawn on the widget
+ **/
+
+/**
+ * \var QLedMatrix::RenderMode QLedMatrix::BufferedRendering
+ * The LEDs are drawn in a back buffer, which is copied to the widget
+ **/
+
+/**
+ * \enum QLedMatrix::StorageFormat
+ *
+ * This type defines how the LED colors are stored.
+ *
+ * \sa setStorageFormat()
+ */
+
+/**
+ * \var QLedMatrix::StorageFormat QLedMatrix::RgbStorage
+ * A QRgb value per LED
+ **/
+
+/**
+ * \var QLedMatrix::StorageFormat QLedMatrix::IndexedStorage
+ * An 8-bit palette index per LED
+ **/
+
+/**
+ * \var QLedMatrix::StorageFormat QLedMatrix::MonochromeStorage
+ * A bit per LED, on or off
+ **/
+
+/**
+ * \enum QLedMatrix::TransitionType
+ *
+ * This type defines how transitionTo() goes from the current frame to the
+ * next one.
+ *
+ * \sa transitionTo()
+ */
+
+/**
+ * \var QLedMatrix::TransitionType QLedMatrix::Crossfade
+ * The LEDs fade from their current color to their new color
+ **/
+
+/**
+ * \var QLedMatrix::TransitionType QLedMatrix::WipeLeft
+ * The new frame is uncovered from the right edge to the left edge
+ **/
+
+/**
+ * \var QLedMatrix::TransitionType QLedMatrix::WipeRight
+ * The new frame is uncovered from the left edge to the right edge
+ **/
+
+/**
+ * \var QLedMatrix::TransitionType QLedMatrix::WipeUp
+ * The new frame is uncovered from the bottom edge to the top edge
+ **/
+
+/**
+ * \var QLedMatrix::TransitionType QLedMatrix::WipeDown
+ * The new frame is uncovered from the top edge to the bottom edge
+ **/
+
+/**
+ * \var QLedMatrix::TransitionType QLedMatrix::Dissolve
+ * The LEDs change to their new color one at a time, in a random order
+ **/
+
+/**
+ * \var QLedMatrix::LEDColor QLedMatrix::NoColor
+ * Default dark LED color (\#222222)
+ **/
+
+/**
+ * \var QLedMatrix::LEDColor QLedMatrix::Red
+ * Red (\#FF0000)
+ **/
+
+/**
+ * \var QLedMatrix::LEDColor QLedMatrix::Green
+ * Green (\#00FF00)
+ **/
+
+/**
+ * \var QLedMatrix::LEDColor QLedMatrix::Blue
+ * Blue (\#0000FF)
+ **/
+
+/**
+ * \var QLedMatrix::LEDColor QLedMatrix::White
+ * White (\#FFFFFF)
+ **/
+
+/**
+ * \var QLedMatrix::LEDColor QLedMatrix::Orange
+ * Orange (\#FF8800)
+ **/
+
+/**
+ * \var QLedMatrix::LEDColor QLedMatrix::OrangeRed
+ * Orange-Red (\#FF2200)
+ **/
+
+/**
+ * \var QLedMatrix::LEDColor QLedMatrix::Yellow
+ * Yellow (\#FFFF00)
+ **/
+
+/**
+ * Constructs a LED Matrix display, sets the background color to black,
+ * the background mode to opaque, the dark LED color to QLedMatrix::NoColor and
+ * the number of rows and columns to 0.
+ *
+ * \sa setBackgroundColor(), setBackgroundMode(), setDarkLedColor(),
+ *     setRowCount(), setColumnCount()
+ *
+ * \param parent parent QWidget
+ */
+QLedMatrix::QLedMatrix(QWidget* parent): QWidget(parent),
+    d_ptr(new QLedMatrixPrivate)
+{
+    Q_D(QLedMatrix);
+    d->q_ptr = this;
+    d->init();
+}
+
+/**
+ * Constructs a LED Matrix display with the given private object, for
+ * subclasses that extend the private state of QLedMatrix. The display takes
+ * the ownership of \a dd.
+ *
+ * \param dd the private object, derived from QLedMatrixPrivate
+ * \param parent parent QWidget
+ */
+QLedMatrix::QLedMatrix(QLedMatrixPrivate& dd, QWidget* parent): QWidget(parent),
+    d_ptr(&dd)
+{
+    Q_D(QLedMatrix);
+    d->q_ptr = this;
+    d->init();
+}
+
+/**
+ * Destroys the LED Matrix display.
+ */
+QLedMatrix::~QLedMatrix()
+{
+    delete d_ptr;
+}
+
+/**
+ * \brief Clears the LED Matrix display.
+ *
+ * When the display is cleared, all the LEDs are set to the dark LED color.
+ *
+ * \sa darkLedColor(), setDarkLedColor()
+ */
+void QLedMatrix::clear()
+{
+    Q_D(QLedMatrix);
+    d->fill(d->darkLedColor.rgb());
+    d->invalidate(QRect(0, 0, d->columnCount, d->rowCount));
+}
+
+/**
+ * \brief Inverts the LED Matrix display.
+ *
+ * The LEDs that are off (of the dark LED color) are turned on with the lit
+ * LED color, and all the other LEDs are turned off. In
+ * QLedMatrix::MonochromeStorage, this is done 32 LEDs at a time.
+ *
+ * \sa litLedColor(), darkLedColor()
+ */
+void QLedMatrix::invert()
+{
+    Q_D(QLedMatrix);
+    d->invert();
+    d->invalidate(QRect(0, 0, d->columnCount, d->rowCount));
+}
+
+/**
+ * \brief Moves the contents of the LED Matrix display.
+ *
+ * Same as scrollLeds(\a dx, \a dy, darkLedColor()).
+ *
+ * \param dx the number of columns to move the LEDs by
+ * \param dy the number of rows to move the LEDs by
+ *
+ * \sa rotate(), clear()
+ */
+void QLedMatrix::scrollLeds(int dx, int dy)
+{
+    Q_D(QLedMatrix);
+    scrollLeds(dx, dy, d->darkLedColor.rgb());
+}
+
+/**
+ * \brief Moves the contents of the LED Matrix display.
+ *
+ * The LEDs are moved by \a dx columns to the right and \a dy rows down
+ * (negative values move them to the left and up) with block moves in the
+ * frame buffer. Unlike QWidget::scroll(), the distances are in LEDs, not in
+ * pixels. LEDs moved out of the display are lost, and the vacated ones
+ * are set to \a rgb.
+ *
+ * When the LEDs move by a whole number of pixels on the widget, the pixels
+ * already drawn are moved as well and only the vacated LEDs are repainted.
+ *
+ * \param dx the number of columns to move the LEDs by
+ * \param dy the number of rows to move the LEDs by
+ * \param rgb the color of the vacated LEDs (in QRgb format)
+ *
+ * \sa rotate(), clear()
+ */
+void QLedMatrix::scrollLeds(int dx, int dy, QRgb rgb)
+{
+    Q_D(QLedMatrix);
+    if((dx == 0) && (dy == 0))
+    {
+        return;
+    }
+
+    d->scroll(dx, dy, rgb);
+    d->invalidateScrolled(dx, dy);
+}
+
+/**
+ * \brief Rotates the contents of the LED Matrix display.
+ *
+ * The LEDs are moved like with scrollLeds(), except that the LEDs moved out of
+ * the display enter again from the opposite edge. The distances are taken
+ * modulo the size of the display.
+ *
+ * \param dx the number of columns to move the LEDs by
+ * \param dy the number of rows to move the LEDs by
+ *
+ * \sa scrollLeds()
+ */
+void QLedMatrix::rotate(int dx, int dy)
+{
+    Q_D(QLedMatrix);
+    if((d->rowCount == 0) || (d->columnCount == 0))
+    {
+        return;
+    }
+
+    dx %= d->columnCount;
+    dy %= d->rowCount;
+    if((dx == 0) && (dy == 0))
+    {
+        return;
+    }
+
+    d->rotate(dx, dy);
+    d->invalidateScrolled(dx, dy);
+}
+
+/**
+ * \brief Starts a batch of changes to the LED matrix display.
+ *
+ * Until the matching endUpdate(), changing LEDs only marks them as dirty
+ * instead of scheduling a repaint. Calls can be nested, the repaint is
+ * scheduled by the outermost endUpdate().
+ *
+ * \sa endUpdate(), QLedMatrixUpdateGuard
+ */
+void QLedMatrix::beginUpdate()
+{
+    Q_D(QLedMatrix);
+    ++d->updateDepth;
+}
+
+/**
+ * \brief Ends a batch of changes to the LED matrix display.
+ *
+ * When the outermost batch ends, a single repaint is scheduled for the area
+ * covering all the LEDs changed during the batch.
+ *
+ * \sa beginUpdate(), QLedMatrixUpdateGuard
+ */
+void QLedMatrix::endUpdate()
+{
+    Q_D(QLedMatrix);
+    if(d->updateDepth == 0)
+    {
+        qWarning("QLedMatrix::endUpdate: called without a matching beginUpdate");
+        return;
+    }
+
+    if(--d->updateDepth == 0)
+    {
+        const QRect dirtyLeds = d->dirtyLeds;
+        d->dirtyLeds = QRect();
+        if(!dirtyLeds.isEmpty())
+        {
+            d->invalidate(dirtyLeds);
+        }
+    }
+}
+
+/**
+ * \brief Returns the background color of the widget.
+ *
+ * \return background color of the widget
+ *
+ * \sa setBackgroundColor()
+ */
+QColor QLedMatrix::backgroundColor() const
+{
+    Q_D(const QLedMatrix);
+    return d->backgroundBrush.color();
+}
+
+/**
+ * \brief Sets the background color of the widget to the given color.
+ *
+ * The background color of the widget will only be visible if the background
+ * mode is set to Qt::OpaqueMode.
+ *
+ * \param color the background color to be set
+ *
+ * \sa backgroundColor(), backgroundMode(), setBackgroundMode()
+ */
+void QLedMatrix::setBackgroundColor(const QColor& color)
+{
+    Q_D(QLedMatrix);
+    d->backgroundBrush.setColor(color);
+    d->backBufferValid = false;
+    d->updateOpaquePaint();
+    update();
+}
+
+/**
+ * \brief Returns the background mode of the widget.
+ *
+ * \return background mode of the widget
+ *
+ * \sa setBackgroundMode()
+ */
+Qt::BGMode QLedMatrix::backgroundMode() const
+{
+    Q_D(const QLedMatrix);
+    return d->backgroundMode;
+}
+
+/**
+ * \brief Sets the background mode of the widget to the given mode.
+ *
+ * Qt::OpaqueMode (the default) fills the widget's background with the current
+ * background color. Qt::TransparentMode doesn't draw any background color.
+ *
+ * \param mode the background mode to be set
+ *
+ * \sa backgroundMode(), backgroundColor(), setBackgroundColor()
+ */
+void QLedMatrix::setBackgroundMode(Qt::BGMode mode)
+{
+    Q_D(QLedMatrix);
+    d->backgroundMode = mode;
+    d->backBufferValid = false;
+    d->updateOpaquePaint();
+    update();
+}
+
+/**
+ * \brief Returns the render mode of the widget.
+ *
+ * \return render mode of the widget
+ *
+ * \sa setRenderMode()
+ */
+QLedMatrix::RenderMode QLedMatrix::renderMode() const
+{
+    Q_D(const QLedMatrix);
+    return d->renderMode;
+}
+
+/**
+ * \brief Sets the render mode of the widget to the given mode.
+ *
+ * QLedMatrix::DirectRendering (the default) draws the LEDs on the widget at
+ * each paint event. QLedMatrix::BufferedRendering keeps a copy of the whole
+ * widget in an image of its size: only the LEDs that changed are drawn in
+ * the image, and paint events copy it to the widget. This costs
+ * width() * height() * 4 bytes of memory, but repaints caused by the window
+ * system (exposed or overlapped areas) no longer draw any LED.
+ *
+ * \param mode the render mode to be set
+ *
+ * \sa renderMode()
+ */
+void QLedMatrix::setRenderMode(RenderMode mode)
+{
+    Q_D(QLedMatrix);
+    if(mode != d->renderMode)
+    {
+        d->renderMode = mode;
+        d->backBuffer = QImage();
+        d->backBufferDirtyLeds = QRegion();
+        d->backBufferValid = false;
+        update();
+    }
+}
+
+/**
+ * \brief Returns the number of threads rasterizing the back buffer.
+ *
+ * \return the number of threads, 0 for one per processor core
+ *
+ * \sa setRenderThreadCount()
+ */
+int QLedMatrix::renderThreadCount() const
+{
+    Q_D(const QLedMatrix);
+    return d->renderThreads;
+}
+
+/**
+ * \brief Sets the number of threads rasterizing the back buffer.
+ *
+ * In QLedMatrix::BufferedRendering, when many LEDs change at once, the
+ * back buffer is split in horizontal bands rasterized in parallel by the
+ * threads of QThreadPool::globalInstance(). The pixels are the same whatever
+ * the number of threads.
+ *
+ * \param threads the number of threads, 1 (the default) to rasterize in
+ *        the GUI thread only, or 0 for QThread::idealThreadCount()
+ *
+ * \sa renderThreadCount(), setRenderMode()
+ */
+void QLedMatrix::setRenderThreadCount(int threads)
+{
+    Q_D(QLedMatrix);
+    if(threads < 0)
+    {
+        qWarning("QLedMatrix::setRenderThreadCount: invalid count %d", threads);
+        return;
+    }
+    d->renderThreads = threads;
+}
+
+/**
+ * \brief Returns the smallest LED size drawn round.
+ *
+ * \return the detail threshold, in pixels
+ *
+ * \sa setDetailThreshold()
+ */
+qreal QLedMatrix::detailThreshold() const
+{
+    Q_D(const QLedMatrix);
+    return d->detailThreshold;
+}
+
+/**
+ * \brief Sets the smallest LED size drawn round.
+ *
+ * Antialiased round LEDs only a few pixels wide cost much more to draw than
+ * squares and do not look different. LEDs whose diameter is smaller than
+ * \a pixels are drawn as squares. When a LED takes a pixel or less, the
+ * matrix is drawn as a single image scaled to the widget (see
+ * setSmoothScaling()), whatever the threshold.
+ *
+ * \param pixels the detail threshold, in pixels (4 by default); 0 always
+ *        draws round LEDs
+ *
+ * \sa detailThreshold()
+ */
+void QLedMatrix::setDetailThreshold(qreal pixels)
+{
+    Q_D(QLedMatrix);
+    pixels = qMax(qreal(0.0), pixels);
+    if(pixels != d->detailThreshold)
+    {
+        d->detailThreshold = pixels;
+        d->backBufferValid = false;
+        update();
+    }
+}
+
+/**
+ * \brief Returns true if the LEDs are smoothed when a LED takes a pixel or
+ * less.
+ *
+ * \return true if smooth scaling is used
+ *
+ * \sa setSmoothScaling()
+ */
+bool QLedMatrix::isSmoothScaling() const
+{
+    Q_D(const QLedMatrix);
+    return d->smoothScaling;
+}
+
+/**
+ * \brief Sets how the LEDs are scaled down when a LED takes a pixel or less.
+ *
+ * \param smooth true to average the colors of the LEDs sharing a pixel,
+ *        false (the default) to show one of them, which is faster and keeps
+ *        the colors saturated
+ *
+ * \sa isSmoothScaling(), setDetailThreshold()
+ */
+void QLedMatrix::setSmoothScaling(bool smooth)
+{
+    Q_D(QLedMatrix);
+    if(smooth != d->smoothScaling)
+    {
+        d->smoothScaling = smooth;
+        d->backBufferValid = false;
+        update();
+    }
+}
+
+/**
+ * \brief Returns the dark LED color.
+ *
+ * \return dark LED color
+ *
+ * \sa setDarkLedColor()
+ */
+QColor QLedMatrix::darkLedColor() const
+{
+    Q_D(const QLedMatrix);
+    return d->darkLedColor;
+}
+
+/**
+ * \brief Sets the dark LED color to the given color.
+ *
+ * The dark LED color is used to represent a LED in the 'off' state. It is
+ * used when adding rows or cols, and when using the clear() method.
+ *
+ * \param color the color to be set
+ *
+ * \sa darkLedColor(), clear(), setRowCount(), setColumnCount()
+ */
+void QLedMatrix::setDarkLedColor(const QColor& color)
+{
+    Q_D(QLedMatrix);
+    QRgb oldColor = d->darkLedColor.rgb();
+    d->darkLedColor = color;
+
+    if(d->storageFormat == IndexedStorage)
+    {
+        std::replace(d->colorTable.begin(), d->colorTable.end(),
+                     oldColor, d->darkLedColor.rgb());
+    }
+    else if(d->storageFormat == RgbStorage)
+    {
+        QLedMatrixKernels::instance().replace(d->frameLeds, d->rowCount * d->columnCount,
+                                              oldColor, d->darkLedColor.rgb());
+    }
+    d->invalidate(QRect(0, 0, d->columnCount, d->rowCount));
+}
+
+/**
+ * \brief Returns the lit LED color.
+ *
+ * \return lit LED color
+ *
+ * \sa setLitLedColor()
+ */
+QColor QLedMatrix::litLedColor() const
+{
+    Q_D(const QLedMatrix);
+    return d->litLedColor;
+}
+
+/**
+ * \brief Sets the lit LED color to the given color.
+ *
+ * The lit LED color is used to represent a LED in the 'on' state in
+ * QLedMatrix::MonochromeStorage, and by invert(). The default is
+ * QLedMatrix::Red.
+ *
+ * \param color the color to be set
+ *
+ * \sa litLedColor(), darkLedColor(), setStorageFormat()
+ */
+void QLedMatrix::setLitLedColor(const QColor& color)
+{
+    Q_D(QLedMatrix);
+    d->litLedColor = color;
+    if(d->storageFormat == MonochromeStorage)
+    {
+        d->invalidate(QRect(0, 0, d->columnCount, d->rowCount));
+    }
+}
+
+/**
+ * \brief Returns the color of the LED at the specified position.
+ *
+ * This function uses the QRgb data format. If the specified position is
+ * invalid, this function will return the current dark LED color.
+ *
+ * \param row the row index of the LED
+ * \param col the column index of the LED
+ *
+ * \return the color of the LED at the given position
+ *
+ * \sa setColorAt(), darkLedColor()
+ */
+QRgb QLedMatrix::colorAt(int row, int col) const
+{
+    Q_D(const QLedMatrix);
+    if(d->isValid(row, col))
+    {
+        return d->pixel(row, col);
+    }
+
+    qWarning("QLedMatrix::colorAt: coordinate (row=%d, col=%d) out of range", row, col);
+    return d->darkLedColor.rgb();
+}
+
+/**
+ * \brief Sets the given color to the LED at the specified position.
+ *
+ * If the specified position is invalid, this function will do nothing.
+ *
+ * \param row the row index of the LED
+ * \param col the column index of the LED
+ * \param rgb the color to be set (in QRgb format)
+ *
+ * \sa colorAt()
+ */
+void QLedMatrix::setColorAt(int row, int col, QRgb rgb)
+{
+    Q_D(QLedMatrix);
+    d->setColorAt(row, col, rgb, true);
+}
+
+/**
+ * \brief Returns a copy of the LED matrix display contents.
+ *
+ * The returned image has one pixel per LED (columnCount() pixels wide and
+ * rowCount() pixels high) and uses the QImage::Format_ARGB32 format. A null
+ * image is returned if the display has no rows or no columns.
+ *
+ * \return the colors of all the LEDs
+ *
+ * \sa setFrame(), colorAt()
+ */
+QImage QLedMatrix::frame() const
+{
+    Q_D(const QLedMatrix);
+    if((d->rowCount == 0) || (d->columnCount == 0))
+    {
+        return QImage();
+    }
+
+    QImage image(d->columnCount, d->rowCount, QImage::Format_ARGB32);
+    for(int row=0; row < d->rowCount; ++row)
+    {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(row));
+        const QRgb* colors = d->fetchScanLine(row, line);
+        if(colors != line)
+        {
+            memcpy(line, colors, d->columnCount * sizeof(QRgb));
+        }
+    }
+    return image;
+}
+
+/**
+ * \brief Sets the color of all the LEDs from the given image.
+ *
+ * Each pixel of the image sets the color of the LED at the same position.
+ * If the image is larger than the display, it is cropped. If it is smaller,
+ * the LEDs that are not covered by the image keep their current color. The
+ * display is repainted once.
+ *
+ * In QLedMatrix::MonochromeStorage, QImage::Format_Mono and
+ * QImage::Format_MonoLSB images are copied 32 LEDs at a time: the pixels of
+ * the brightest of the two image colors are on. Pixels of other images are
+ * on unless they are of the dark LED color.
+ *
+ * \param image the image to be shown
+ *
+ * \sa frame(), setPixels(), setColorAt()
+ */
+void QLedMatrix::setFrame(const QImage& image)
+{
+    Q_D(QLedMatrix);
+    if(image.isNull())
+    {
+        qWarning("QLedMatrix::setFrame: null image");
+        return;
+    }
+
+    if((d->storageFormat == MonochromeStorage) &&
+       ((image.format() == QImage::Format_Mono) ||
+        (image.format() == QImage::Format_MonoLSB)))
+    {
+        d->importMonochrome(image);
+        return;
+    }
+
+    QImage source = image;
+    if((source.format() != QImage::Format_ARGB32) &&
+       (source.format() != QImage::Format_RGB32))
+    {
+        source = source.convertToFormat(QImage::Format_ARGB32);
+    }
+
+    d->copyPixels(reinterpret_cast<const QRgb*>(source.constBits()),
+                  source.rect(), source.bytesPerLine() / sizeof(QRgb));
+}
+
+/**
+ * \brief Sets the color of all the LEDs from the gray levels of the given
+ * image.
+ *
+ * Each pixel of the image whose gray level (see qGray()) is at least
+ * \a threshold turns the LED at the same position on with \a onColor, the
+ * other pixels turn it off with \a offColor. This is the usual way to show a
+ * monochrome picture or rendered text. The image is cropped as with
+ * setFrame(). In QLedMatrix::MonochromeStorage, the lit and dark LED colors
+ * are used instead of \a onColor and \a offColor.
+ *
+ * \param image the image to be shown
+ * \param onColor the color of the LEDs that are on (in QRgb format)
+ * \param offColor the color of the LEDs that are off (in QRgb format)
+ * \param threshold the gray level, from 0 to 255, from which a LED is on
+ *
+ * \sa setFrame(), darkLedColor()
+ */
+void QLedMatrix::setFrame(const QImage& image, QRgb onColor, QRgb offColor, int threshold)
+{
+    Q_D(QLedMatrix);
+    if(image.isNull())
+    {
+        qWarning("QLedMatrix::setFrame: null image");
+        return;
+    }
+
+    QImage source = image;
+    if((source.format() != QImage::Format_ARGB32) &&
+       (source.format() != QImage::Format_RGB32))
+    {
+        source = source.convertToFormat(QImage::Format_ARGB32);
+    }
+
+    const QLedMatrixKernels& kernels = QLedMatrixKernels::instance();
+    const int level = qBound(0, threshold, 256);
+    const int rows = qMin(source.height(), d->rowCount);
+    const int columns = qMin(source.width(), d->columnCount);
+    const bool direct = (d->storageFormat == RgbStorage);
+    QVector<QRgb> buffer(direct ? 0 : columns);
+    if(d->storageFormat == MonochromeStorage)
+    {
+        // Only two colors can be shown
+        onColor = d->litLedColor.rgb();
+        offColor = d->darkLedColor.rgb();
+    }
+    for(int row=0; row < rows; ++row)
+    {
+        QRgb* line = direct ? d->scanLine(row) : buffer.data();
+        kernels.threshold(line,
+                          reinterpret_cast<const QRgb*>(source.constScanLine(row)),
+                          columns, level, onColor, offColor);
+        if(!direct)
+        {
+            d->storeScanLine(row, 0, line, columns);
+        }
+    }
+    d->invalidate(QRect(0, 0, columns, rows));
+}
+
+/**
+ * \brief Sets the color of all the LEDs from a buffer of QRgb values.
+ *
+ * The buffer must hold rowCount() rows of columnCount() values each. The
+ * rows are copied in a single pass and the display is repainted once.
+ *
+ * \param data the first LED of the first row (in QRgb format)
+ * \param stride the number of QRgb values between the start of two
+ *        consecutive rows, at least columnCount()
+ *
+ * \sa setFrame(), frame()
+ */
+void QLedMatrix::setPixels(const QRgb* data, int stride)
+{
+    Q_D(QLedMatrix);
+    if((data == 0) || (stride < d->columnCount))
+    {
+        qWarning("QLedMatrix::setPixels: invalid buffer (stride=%d)", stride);
+        return;
+    }
+
+    d->copyPixels(data, QRect(0, 0, d->columnCount, d->rowCount), stride);
+}
+
+/**
+ * \brief Sets the color of a rectangle of LEDs from a buffer of QRgb values.
+ *
+ * The buffer must hold leds.height() rows of leds.width() values each. The
+ * parts of the rectangle outside the display are ignored. Only the
+ * rectangle is repainted.
+ *
+ * \param leds the rectangle of LEDs, in columns and rows
+ * \param data the first LED of the first row of the rectangle (in QRgb
+ *        format)
+ * \param stride the number of QRgb values between the start of two
+ *        consecutive rows, at least leds.width()
+ *
+ * \sa setFrame(), setColorAt()
+ */
+void QLedMatrix::setPixels(const QRect& leds, const QRgb* data, int stride)
+{
+    Q_D(QLedMatrix);
+    if((data == 0) || (stride < leds.width()))
+    {
+        qWarning("QLedMatrix::setPixels: invalid buffer (stride=%d)", stride);
+        return;
+    }
+
+    d->copyPixels(data, leds, stride);
+}
+
+/**
+ * \brief Returns the colors of a row of LEDs.
+ *
+ * In QLedMatrix::RgbStorage, the frame buffer of the display is returned
+ * directly. In the other storage formats, the row is converted to a buffer
+ * which is overwritten by the next call. The pointer is valid until the
+ * LEDs change. The row is not checked, except by an assertion in debug
+ * builds.
+ *
+ * \param row the row, from 0 to rowCount() - 1
+ *
+ * \return the columnCount() colors of the row (in QRgb format)
+ *
+ * \sa QLedMatrixScanLineWriter
+ */
+const QRgb* QLedMatrix::constScanLine(int row) const
+{
+    Q_D(const QLedMatrix);
+    Q_ASSERT((row >= 0) && (row < d->rowCount));
+    if(d->storageFormat == RgbStorage)
+    {
+        return d->constScanLine(row);
+    }
+    d->constLine.resize(d->columnCount);
+    return d->fetchScanLine(row, d->constLine.data());
+}
+
+/**
+ * \brief Sets a rectangle of LEDs to the given color.
+ *
+ * The rectangle is filled a row at a time and repainted once. The parts of
+ * the rectangle outside the display are ignored.
+ *
+ * \param leds the rectangle of LEDs, in columns and rows
+ * \param rgb the new color of the LEDs (in QRgb format)
+ *
+ * \sa clear(), blit(), copyRect()
+ */
+void QLedMatrix::fillRect(const QRect& leds, QRgb rgb)
+{
+    Q_D(QLedMatrix);
+    const QRect rect = leds & QRect(0, 0, d->columnCount, d->rowCount);
+    if(!rect.isEmpty())
+    {
+        d->fillLeds(rect, rgb);
+        d->invalidate(rect);
+    }
+}
+
+/**
+ * \brief Copies an image to the LEDs, with its top left pixel at the given
+ * LED.
+ *
+ * Each pixel of the image replaces the color of a LED, as with setFrame():
+ * the pixels are not blended. The rows are copied in a single pass and the
+ * covered LEDs are repainted once. The parts of the image outside the
+ * display are ignored.
+ *
+ * \param image the image to copy, an icon for example
+ * \param position the LED of the top left pixel of the image, as (column,
+ *        row)
+ *
+ * \sa setFrame(), copyRect()
+ */
+void QLedMatrix::blit(const QImage& image, const QPoint& position)
+{
+    Q_D(QLedMatrix);
+    if(image.isNull())
+    {
+        qWarning("QLedMatrix::blit: null image");
+        return;
+    }
+
+    QImage source = image;
+    if((source.format() != QImage::Format_ARGB32) &&
+       (source.format() != QImage::Format_RGB32))
+    {
+        source = source.convertToFormat(QImage::Format_ARGB32);
+    }
+
+    d->copyPixels(reinterpret_cast<const QRgb*>(source.constBits()),
+                  QRect(position, source.size()), source.bytesPerLine() / sizeof(QRgb));
+}
+
+/**
+ * \brief Copies a rectangle of LEDs to another position of the display.
+ *
+ * The LEDs are copied with a block move per row; the two rectangles may
+ * overlap. The parts of either rectangle outside the display are ignored.
+ * Only the target rectangle is repainted.
+ *
+ * \param source the rectangle of LEDs to copy, in columns and rows
+ * \param target the new position of the top left LED of \a source, as
+ *        (column, row)
+ *
+ * \sa blit(), fillRect(), scrollLeds()
+ */
+void QLedMatrix::copyRect(const QRect& source, const QPoint& target)
+{
+    Q_D(QLedMatrix);
+    const QRect display(0, 0, d->columnCount, d->rowCount);
+    const QPoint offset = target - source.topLeft();
+    const QRect dst = (source & display).translated(offset) & display;
+    if(dst.isEmpty())
+    {
+        return;
+    }
+
+    d->copyLeds(dst.translated(-offset), dst.topLeft());
+    d->invalidate(dst);
+}
+
+/**
+ * \brief Returns the storage format of the LED colors.
+ *
+ * \return storage format of the LED colors
+ *
+ * \sa setStorageFormat()
+ */
+QLedMatrix::StorageFormat QLedMatrix::storageFormat() const
+{
+    Q_D(const QLedMatrix);
+    return d->storageFormat;
+}
+
+/**
+ * \brief Sets the storage format of the LED colors to the given format.
+ *
+ * QLedMatrix::RgbStorage (the default) stores a QRgb value per LED.
+ * QLedMatrix::IndexedStorage stores an 8-bit index per LED in a palette of
+ * up to 256 colors, which uses 4 times less memory. Colors that are not in
+ * the palette are added to it when they are set; once the palette is full,
+ * the closest palette color is used instead.
+ * QLedMatrix::MonochromeStorage stores a single bit per LED, which uses 32
+ * times less memory: LEDs are either off (dark LED color) or on (lit LED
+ * color). Setting any color other than the dark LED color turns a LED on.
+ *
+ * The current colors are converted to the new format. When converting to
+ * QLedMatrix::IndexedStorage, the palette is rebuilt from the dark LED color
+ * and the colors of the LEDs. A running crossfade (see transitionTo()) ends
+ * at once when leaving QLedMatrix::RgbStorage. The format of a display
+ * whose LEDs are stored by a subclass (see setFixedStorage()) can not be
+ * changed.
+ *
+ * \param format the storage format to be set
+ *
+ * \sa storageFormat(), setPaletteColor(), setColorIndexAt()
+ */
+void QLedMatrix::setStorageFormat(StorageFormat format)
+{
+    Q_D(QLedMatrix);
+    if(format == d->storageFormat)
+    {
+        return;
+    }
+    if(d->fixedStorage)
+    {
+        qWarning("QLedMatrix::setStorageFormat: the LEDs are stored by a subclass");
+        return;
+    }
+
+    // A crossfade only runs in RgbStorage, see transitionTo()
+    if((format != RgbStorage) && isTransitioning() && (d->transitionType == Crossfade))
+    {
+        stopTransition();
+    }
+
+    // Convert through a frame of QRgb values
+    QVector<QRgb> colors(d->rowCount * d->columnCount);
+    for(int row=0; row < d->rowCount; ++row)
+    {
+        QRgb* line = colors.data() + row * d->columnCount;
+        const QRgb* fetched = d->fetchScanLine(row, line);
+        if(fetched != line)
+        {
+            memcpy(line, fetched, d->columnCount * sizeof(QRgb));
+        }
+    }
+
+    d->frameBuffer = QVector<QRgb>();
+    d->indexBuffer = QVector<uchar>();
+    d->colorTable = QVector<QRgb>();
+    d->monoBuffer = QVector<quint32>();
+    d->spareFrameBuffer = QVector<QRgb>();
+    d->spareIndexBuffer = QVector<uchar>();
+    d->spareMonoBuffer = QVector<quint32>();
+    d->storageFormat = format;
+
+    switch(format)
+    {
+        case IndexedStorage:
+            d->colorTable.append(d->darkLedColor.rgb());
+            d->indexBuffer.resize(d->rowCount * d->columnCount);
+            break;
+        case MonochromeStorage:
+            d->monoBuffer.fill(0, d->rowCount * d->monoStride());
+            break;
+        default:
+            qSwap(d->frameBuffer, colors);
+            break;
+    }
+    d->attachBuffers();
+
+    if(format != RgbStorage)
+    {
+        for(int row=0; row < d->rowCount; ++row)
+        {
+            d->storeScanLine(row, 0, colors.constData() + row * d->columnCount,
+                             d->columnCount);
+        }
+    }
+
+    d->invalidate(QRect(0, 0, d->columnCount, d->rowCount));
+}
+
+/**
+ * \brief Returns the number of colors in the palette.
+ *
+ * \return the number of colors in the palette, or 0 if the storage format is
+ *         not QLedMatrix::IndexedStorage
+ *
+ * \sa paletteColor(), setStorageFormat()
+ */
+int QLedMatrix::paletteSize() const
+{
+    Q_D(const QLedMatrix);
+    return d->colorTable.size();
+}
+
+/**
+ * \brief Returns the color of the palette at the given index.
+ *
+ * If the index is invalid, this function will return the current dark LED
+ * color.
+ *
+ * \param index the palette index
+ *
+ * \return the color at the given index (in QRgb format)
+ *
+ * \sa setPaletteColor(), paletteSize()
+ */
+QRgb QLedMatrix::paletteColor(int index) const
+{
+    Q_D(const QLedMatrix);
+    if((index >= 0) && (index < d->colorTable.size()))
+    {
+        return d->colorTable.at(index);
+    }
+
+    qWarning("QLedMatrix::paletteColor: index %d out of range", index);
+    return d->darkLedColor.rgb();
+}
+
+/**
+ * \brief Sets the color of the palette at the given index.
+ *
+ * All the LEDs using this index change color at once, without going over the
+ * LEDs. If the index is past the end of the palette, the palette is enlarged
+ * and the new entries are set to the dark LED color. This function does
+ * nothing if the storage format is not QLedMatrix::IndexedStorage or if the
+ * index is not between 0 and 255.
+ *
+ * \param index the palette index
+ * \param rgb the color to be set (in QRgb format)
+ *
+ * \sa paletteColor(), setColorIndexAt()
+ */
+void QLedMatrix::setPaletteColor(int index, QRgb rgb)
+{
+    Q_D(QLedMatrix);
+    if(d->storageFormat != IndexedStorage)
+    {
+        qWarning("QLedMatrix::setPaletteColor: the storage format is not IndexedStorage");
+        return;
+    }
+    if((index < 0) || (index >= MaxPaletteSize))
+    {
+        qWarning("QLedMatrix::setPaletteColor: index %d out of range", index);
+        return;
+    }
+
+    const int size = d->colorTable.size();
+    if(index >= size)
+    {
+        d->colorTable.resize(index + 1);
+        std::fill(d->colorTable.begin() + size, d->colorTable.end(),
+                  d->darkLedColor.rgb());
+    }
+    d->colorTable[index] = rgb;
+    d->invalidate(QRect(0, 0, d->columnCount, d->rowCount));
+}
+
+/**
+ * \brief Returns the palette index of the LED at the specified position.
+ *
+ * \param row the row index of the LED
+ * \param col the column index of the LED
+ *
+ * \return the palette index of the LED, or -1 if the position is invalid or
+ *         if the storage format is not QLedMatrix::IndexedStorage
+ *
+ * \sa setColorIndexAt(), colorAt()
+ */
+int QLedMatrix::colorIndexAt(int row, int col) const
+{
+    Q_D(const QLedMatrix);
+    if((d->storageFormat == IndexedStorage) && d->isValid(row, col))
+    {
+        return d->constIndexScanLine(row)[col];
+    }
+
+    qWarning("QLedMatrix::colorIndexAt: no index at (row=%d, col=%d)", row, col);
+    return -1;
+}
+
+/**
+ * \brief Sets the palette index of the LED at the specified position.
+ *
+ * This function does nothing if the position or the index is invalid, or if
+ * the storage format is not QLedMatrix::IndexedStorage.
+ *
+ * \param row the row index of the LED
+ * \param col the column index of the LED
+ * \param index the palette index to be set
+ *
+ * \sa colorIndexAt(), setPaletteColor(), setColorAt()
+ */
+void QLedMatrix::setColorIndexAt(int row, int col, int index)
+{
+    Q_D(QLedMatrix);
+    if((d->storageFormat != IndexedStorage) || !d->isValid(row, col) ||
+       (index < 0) || (index >= d->colorTable.size()))
+    {
+        qWarning("QLedMatrix::setColorIndexAt: invalid index %d at (row=%d, col=%d)",
+                 index, row, col);
+        return;
+    }
+
+    d->indexScanLine(row)[col] = uchar(index);
+    d->invalidate(QRect(col, row, 1, 1));
+}
+
+/**
+ * \brief Returns the font used to draw text.
+ *
+ * \return the font used by drawText() and scrollText()
+ *
+ * \sa setLedFont()
+ */
+QLedMatrixFont QLedMatrix::ledFont() const
+{
+    Q_D(const QLedMatrix);
+    return d->font;
+}
+
+/**
+ * \brief Sets the font used to draw text.
+ *
+ * The default font is QLedMatrixFont::font5x7(). A text that is already
+ * scrolling keeps the font it was started with.
+ *
+ * \param font the new font
+ *
+ * \sa ledFont(), drawText(), scrollText()
+ */
+void QLedMatrix::setLedFont(const QLedMatrixFont& font)
+{
+    Q_D(QLedMatrix);
+    d->font = font;
+}
+
+/**
+ * \brief Draws a text with the LED font.
+ *
+ * The LEDs of the glyphs are set to \a rgb, the other ones are left
+ * unchanged. The parts of the text outside the display are clipped.
+ *
+ * \param row the row of the top of the text
+ * \param col the column of the left of the text
+ * \param text the text to draw
+ * \param rgb the color of the text (in QRgb format)
+ *
+ * \sa setLedFont(), QLedMatrixFont::textWidth()
+ */
+void QLedMatrix::drawText(int row, int col, const QString& text, QRgb rgb)
+{
+    Q_D(QLedMatrix);
+    const QVector<quint32> run = d->font.render(text);
+    const int height = d->font.height();
+    d->drawColumns(run.constData(), run.size(), height, row, col, rgb);
+
+    const QRect leds = QRect(col, row, run.size(), height) &
+                       QRect(0, 0, d->columnCount, d->rowCount);
+    if(!leds.isEmpty())
+    {
+        d->invalidate(leds);
+    }
+}
+
+/**
+ * \brief Scrolls a text through the display from right to left.
+ *
+ * The text is rendered once with the LED font and vertically centered. At
+ * each step, the LEDs are moved to the left as with scrollLeds() and only
+ * the columns of the text that enter from the right are drawn. Once the
+ * text has left the display, it enters again, until stopScrollText() is
+ * called.
+ *
+ * The steps are timed on the elapsed time, at most every 16 ms: at high
+ * speeds, several columns are scrolled at once.
+ *
+ * \param text the text to scroll
+ * \param rgb the color of the text (in QRgb format)
+ * \param pixelsPerSecond the speed of the text, in columns per second
+ *
+ * \sa stopScrollText(), drawText(), setLedFont()
+ */
+void QLedMatrix::scrollText(const QString& text, QRgb rgb, int pixelsPerSecond)
+{
+    Q_D(QLedMatrix);
+    if(pixelsPerSecond <= 0)
+    {
+        qWarning("QLedMatrix::scrollText: invalid speed %d", pixelsPerSecond);
+        return;
+    }
+
+    d->marqueeRun = d->font.render(text);
+    d->marqueeHeight = d->font.height();
+    d->marqueePosition = 0;
+    d->marqueeSpeed = pixelsPerSecond;
+    d->marqueeColor = rgb;
+    d->marqueeSteps = 0;
+
+    if(d->marqueeTimer == 0)
+    {
+        d->marqueeTimer = new QTimer(this);
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+        d->marqueeTimer->setTimerType(Qt::PreciseTimer);
+#endif
+        connect(d->marqueeTimer, SIGNAL(timeout()), this, SLOT(scrollTextStep()));
+    }
+    d->marqueeTimer->start(qMax(MarqueeMinInterval, 1000 / pixelsPerSecond));
+    d->marqueeClock.start();
+}
+
+/**
+ * \brief Stops the text started by scrollText().
+ *
+ * The display is left as it is.
+ *
+ * \sa scrollText()
+ */
+void QLedMatrix::stopScrollText()
+{
+    Q_D(QLedMatrix);
+    if(d->marqueeTimer != 0)
+    {
+        d->marqueeTimer->stop();
+    }
+    d->marqueeRun.clear();
+}
+
+/**
+ * \brief Returns true while a text started by scrollText() is scrolling.
+ *
+ * \return true if a text is scrolling
+ *
+ * \sa scrollText()
+ */
+bool QLedMatrix::isScrollingText() const
+{
+    Q_D(const QLedMatrix);
+    return (d->marqueeTimer != 0) && d->marqueeTimer->isActive();
+}
+
+/**
+ * \internal
+ * Scrolls the text of scrollText() by the columns due since the last step.
+ */
+void QLedMatrix::scrollTextStep()
+{
+    Q_D(QLedMatrix);
+    const qint64 steps = d->marqueeClock.elapsed() * d->marqueeSpeed / 1000;
+    const qint64 due = steps - d->marqueeSteps;
+    if((due <= 0) || (d->columnCount == 0))
+    {
+        return;
+    }
+    d->marqueeSteps = steps;
+
+    // The text is followed by a blank display width before it enters again
+    const int period = d->marqueeRun.size() + d->columnCount;
+
+    // After a stall, the columns that would scroll out of sight are skipped
+    const int count = int(qMin<qint64>(due, d->columnCount));
+    d->marqueePosition = int((d->marqueePosition + due - count) % period);
+
+    d->scroll(-count, 0, d->darkLedColor.rgb());
+    const int row = (d->rowCount - d->marqueeHeight) / 2;
+    for(int col=d->columnCount - count; col < d->columnCount; ++col)
+    {
+        if(d->marqueePosition < d->marqueeRun.size())
+        {
+            d->drawColumns(d->marqueeRun.constData() + d->marqueePosition, 1,
+                           d->marqueeHeight, row, col, d->marqueeColor);
+        }
+        d->marqueePosition = (d->marqueePosition + 1) % period;
+    }
+    d->invalidateScrolled(-count, 0);
+}
+
+/**
+ * \brief Goes from the current frame to the given image with a transition
+ * effect.
+ *
+ * The image is cropped as with setFrame(); when it is smaller than the
+ * display, the LEDs it does not cover keep their color. The transition is
+ * timed on the elapsed time and runs from the event loop: each step only
+ * writes and repaints the LEDs that change at that step, and at most a fixed
+ * number of them, so that many displays can run transitions together
+ * without blocking the GUI thread. Crossfades blend whole rows with SIMD
+ * instructions when the CPU has them.
+ *
+ * Starting a transition while another one runs starts from the LEDs as they
+ * are. Resizing the display stops the transition. In
+ * QLedMatrix::MonochromeStorage, where a LED is on or off, and in
+ * QLedMatrix::IndexedStorage, whose palette would fill up with the blended
+ * colors, a crossfade is a dissolve.
+ *
+ * \param frame the image shown at the end of the transition
+ * \param type the transition effect
+ * \param duration the duration of the transition in milliseconds; with 0 or
+ *        less, the image is shown at once
+ *
+ * \sa stopTransition(), transitionFinished(), setFrame()
+ */
+void QLedMatrix::transitionTo(const QImage& frame, TransitionType type, int duration)
+{
+    Q_D(QLedMatrix);
+    if(frame.isNull())
+    {
+        qWarning("QLedMatrix::transitionTo: null image");
+        return;
+    }
+
+    d->clearTransition();
+    if(duration <= 0)
+    {
+        setFrame(frame);
+        Q_EMIT transitionFinished();
+        return;
+    }
+
+    // Blended colors can not be stored in MonochromeStorage, and would fill
+    // the palette of IndexedStorage
+    if((type == Crossfade) && (d->storageFormat != RgbStorage))
+    {
+        type = Dissolve;
+    }
+    d->startTransition(frame, type);
+    d->transitionDuration = duration;
+
+    if(d->transitionTimer == 0)
+    {
+        d->transitionTimer = new QTimer(this);
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+        d->transitionTimer->setTimerType(Qt::PreciseTimer);
+#endif
+        connect(d->transitionTimer, SIGNAL(timeout()), this, SLOT(transitionStep()));
+    }
+    d->transitionTimer->start(TransitionInterval);
+    d->transitionClock.start();
+}
+
+/**
+ * \brief Stops the transition started by transitionTo() and shows its final
+ * frame at once.
+ *
+ * transitionFinished() is not emitted.
+ *
+ * \sa transitionTo()
+ */
+void QLedMatrix::stopTransition()
+{
+    Q_D(QLedMatrix);
+    if(!isTransitioning())
+    {
+        return;
+    }
+    d->copyPixels(d->transitionTarget.constData(), QRect(0, 0, d->columnCount, d->rowCount),
+                  d->columnCount);
+    d->clearTransition();
+}
+
+/**
+ * \brief Returns true while a transition started by transitionTo() runs.
+ *
+ * \return true if a transition runs
+ *
+ * \sa transitionTo()
+ */
+bool QLedMatrix::isTransitioning() const
+{
+    Q_D(const QLedMatrix);
+    return (d->transitionTimer != 0) && d->transitionTimer->isActive();
+}
+
+/**
+ * \internal
+ * Runs a step of the transition started by transitionTo().
+ */
+void QLedMatrix::transitionStep()
+{
+    Q_D(QLedMatrix);
+    if(d->stepTransition())
+    {
+        d->clearTransition();
+        Q_EMIT transitionFinished();
+    }
+}
+
+/**
+ * \brief Returns the frame sink shown by the LED matrix display.
+ *
+ * \return the current frame sink, or 0 if there is none
+ *
+ * \sa setFrameSink()
+ */
+QLedMatrixFrameSink* QLedMatrix::frameSink() const
+{
+    Q_D(const QLedMatrix);
+    return d->frameSink;
+}
+
+/**
+ * \brief Shows the frames published to the given frame sink.
+ *
+ * Each time a producer thread publishes a frame, the newest frame is copied
+ * to the display from the GUI thread, as with setPixels(). Frames larger
+ * than the display are cropped. The sink is not owned by the display.
+ *
+ * \param sink the frame sink to be shown, or 0 to detach the current one
+ *
+ * \sa frameSink(), QLedMatrixFrameSink
+ */
+void QLedMatrix::setFrameSink(QLedMatrixFrameSink* sink)
+{
+    Q_D(QLedMatrix);
+    if(d->frameSink)
+    {
+        disconnect(d->frameSink, 0, this, 0);
+    }
+
+    d->frameSink = sink;
+    if(sink != 0)
+    {
+        connect(sink, SIGNAL(framePublished()),
+                this, SLOT(presentSinkFrame()), Qt::QueuedConnection);
+        presentSinkFrame();
+    }
+}
+
+/**
+ * \internal
+ * Copies the newest frame of the frame sink, if any, to the display.
+ */
+void QLedMatrix::presentSinkFrame()
+{
+    Q_D(QLedMatrix);
+    if(!d->frameSink)
+    {
+        return;
+    }
+
+    const QRgb* data = d->frameSink->acquire();
+    if(data != 0)
+    {
+        const int columns = d->frameSink->columnCount();
+        d->copyPixels(data, QRect(0, 0, columns, d->frameSink->rowCount()), columns);
+    }
+}
+
+/**
+ * \brief Returns the recorder of the LED matrix display.
+ *
+ * \return the current recorder, or 0 if there is none
+ *
+ * \sa setRecorder()
+ */
+QLedMatrixRecorder* QLedMatrix::recorder() const
+{
+    Q_D(const QLedMatrix);
+    return d->recorder;
+}
+
+/**
+ * \brief Records the frames shown by the LED matrix display.
+ *
+ * Each time the display paints LEDs that changed, the colors of all the
+ * LEDs are passed to QLedMatrixRecorder::recordFrame(). Paints that only
+ * expose the widget again are not recorded, and nothing is recorded while
+ * the display is hidden. The recorder is not owned by the display.
+ *
+ * \param recorder the recorder, or 0 to stop recording
+ *
+ * \sa recorder(), QLedMatrixRecorder
+ */
+void QLedMatrix::setRecorder(QLedMatrixRecorder* recorder)
+{
+    Q_D(QLedMatrix);
+    d->recorder = recorder;
+    d->recordPending = true;
+    if(recorder != 0)
+    {
+        update();
+    }
+}
+
+/**
+ * \brief Returns the number of rows in the LED matrix display.
+ *
+ * \return the number of rows in the LED matrix display
+ *
+ * \sa setRowCount(), columnCount()
+ */
+int QLedMatrix::rowCount() const
+{
+    Q_D(const QLedMatrix);
+    return d->rowCount;
+}
+
+/**
+ * \brief Sets the number of rows in the LED matrix display.
+ *
+ * This function will do nothing if the new number of rows is less than 0
+ * or if it is equal to the current number of rows. If the new number of
+ * rows is less than the current number of rows, the display will be
+ * cropped to the new value. Otherwise, if the new number of rows is
+ * greater than the current number of rows, the new LEDs will be
+ * initialized using the dark LED color.
+ * 
+ * \param rows the new number of rows
+ *
+ * \sa rowsCount(), setColumnCount(), darkLedColor()
+ */
+void QLedMatrix::setRowCount(int rows)
+{
+    Q_D(QLedMatrix);
+    if(rows >= 0)
+    {
+        setMatrixSize(rows, d->columnCount);
+    }
+}
+
+/**
+ * \brief Returns the number of columns in the LED matrix display.
+ *
+ * \return the number of columns in the LED matrix display
+ *
+ * \sa setColumnCount(), rowCount()
+ */
+int QLedMatrix::columnCount() const
+{
+    Q_D(const QLedMatrix);
+    return d->columnCount;
+}
+
+/**
+ * \brief Sets the number of columns in the LED matrix display.
+ *
+ * This function will do nothing if the new number of columns is less than 0
+ * or if it is equal to the current number of columns. If the new number of
+ * columns is less than the current number of columns, the display will be
+ * cropped to the new value. Otherwise, if the new number of columns is
+ * greater than the current number of columns, the new LEDs will be
+ * initialized using the dark LED color.
+ * 
+ * \param columns the new number of columns
+ *
+ * \sa columnCount(), setRowCount(), darkLedColor()
+ */
+void QLedMatrix::setColumnCount(int columns)
+{
+    Q_D(QLedMatrix);
+    if(columns >= 0)
+    {
+        setMatrixSize(d->rowCount, columns);
+    }
+}
+
+/**
+ * \brief Returns the size of the LED matrix display.
+ *
+ * \return the number of columns (width) and rows (height) of the display
+ *
+ * \sa setMatrixSize()
+ */
+QSize QLedMatrix::matrixSize() const
+{
+    Q_D(const QLedMatrix);
+    return QSize(d->columnCount, d->rowCount);
+}
+
+/**
+ * \brief Sets the number of rows and columns of the LED matrix display at
+ * once.
+ *
+ * The frame buffer is resized in a single copy and the display is repainted
+ * once. The LEDs that are common to both sizes keep their color: the
+ * current content stays aligned to \a anchor, a combination of a horizontal
+ * flag (Qt::AlignLeft, Qt::AlignHCenter or Qt::AlignRight) and a vertical
+ * flag (Qt::AlignTop, Qt::AlignVCenter or Qt::AlignBottom). With
+ * Qt::AlignCenter, for example, the display grows or shrinks equally on all
+ * sides. The new LEDs are initialized using the dark LED color.
+ *
+ * The previous allocation is kept and reused by the next resize; with
+ * reserveMatrixSize(), the display can be resized up to the reserved size
+ * without allocating memory. A transition started by transitionTo() is
+ * stopped. The size of a display whose LEDs are stored by a subclass (see
+ * setFixedStorage()), or of a QLedMatrixWall, can not be set.
+ *
+ * \param rows the new number of rows
+ * \param columns the new number of columns
+ * \param anchor the alignment of the current content in the new size
+ *
+ * \sa matrixSize(), reserveMatrixSize(), setRowCount(), setColumnCount()
+ */
+void QLedMatrix::setMatrixSize(int rows, int columns, Qt::Alignment anchor)
+{
+    Q_D(QLedMatrix);
+    if((rows < 0) || (columns < 0))
+    {
+        qWarning("QLedMatrix::setMatrixSize: invalid size (rows=%d, columns=%d)", rows, columns);
+        return;
+    }
+    if((rows == d->rowCount) && (columns == d->columnCount))
+    {
+        return;
+    }
+    if(d->fixedSize)
+    {
+        qWarning("QLedMatrix::setMatrixSize: the size of a %s can not be set",
+                 metaObject()->className());
+        return;
+    }
+
+    d->resize(rows, columns, anchor);
+}
+
+/**
+ * \brief Reserves memory for a display of up to the given size.
+ *
+ * Resizing the display with setMatrixSize(), setRowCount() or
+ * setColumnCount() then never allocates memory as long as it stays within
+ * this size, which suits layouts resizing their displays often. Changing
+ * the storage format releases the reserved memory. Nothing is reserved for
+ * a display whose LEDs are stored by a subclass (see setFixedStorage()).
+ *
+ * \param rows the largest number of rows
+ * \param columns the largest number of columns
+ *
+ * \sa setMatrixSize()
+ */
+void QLedMatrix::reserveMatrixSize(int rows, int columns)
+{
+    Q_D(QLedMatrix);
+    if((rows < 0) || (columns < 0))
+    {
+        qWarning("QLedMatrix::reserveMatrixSize: invalid size (rows=%d, columns=%d)",
+                 rows, columns);
+        return;
+    }
+    if(d->fixedStorage)
+    {
+        return;
+    }
+
+    switch(d->storageFormat)
+    {
+        case IndexedStorage:
+            d->indexBuffer.reserve(rows * columns);
+            d->spareIndexBuffer.reserve(rows * columns);
+            break;
+        case MonochromeStorage:
+            d->monoBuffer.reserve(rows * ((columns + 31) / 32));
+            d->spareMonoBuffer.reserve(rows * ((columns + 31) / 32));
+            break;
+        default:
+            d->frameBuffer.reserve(rows * columns);
+            d->spareFrameBuffer.reserve(rows * columns);
+            break;
+    }
+    d->attachBuffers();
+}
+
+/**
+ * \brief Returns true if the display measures its paint events.
+ *
+ * \return true if the statistics are enabled
+ *
+ * \sa setStatsEnabled(), stats()
+ */
+bool QLedMatrix::isStatsEnabled() const
+{
+    Q_D(const QLedMatrix);
+    return d->statsEnabled;
+}
+
+/**
+ * \brief Enables the statistics of the paint events.
+ *
+ * While enabled, the display times its paint events and counts the LEDs it
+ * draws and the repaints it requests. Every second, stats() is updated with
+ * the figures of the last second and statsUpdated() is emitted. When
+ * disabled (the default), nothing is measured.
+ *
+ * Setting the QLEDMATRIX_STATS environment variable to a value other than 0
+ * enables the statistics of every display.
+ *
+ * \param enabled true to enable the statistics
+ *
+ * \sa isStatsEnabled(), stats()
+ */
+void QLedMatrix::setStatsEnabled(bool enabled)
+{
+    Q_D(QLedMatrix);
+    if(enabled == d->statsEnabled)
+    {
+        return;
+    }
+
+    d->statsEnabled = enabled;
+    d->ledsDrawn = 0;
+    d->paintTimes.clear();
+    d->ledsDrawnTotal = 0;
+    d->dirtyArea = 0;
+    d->updateRequests = 0;
+    d->stats = QLedMatrixStats();
+    if(enabled)
+    {
+        d->statsTimer = new QTimer(this);
+        connect(d->statsTimer, SIGNAL(timeout()), this, SLOT(updateStats()));
+        d->statsTimer->start(StatsInterval);
+        d->statsClock.start();
+    }
+    else
+    {
+        delete d->statsTimer;
+        d->statsTimer = 0;
+    }
+}
+
+/**
+ * \brief Returns the statistics of the paint events of the last second.
+ *
+ * \return the statistics, all zero if they are not enabled
+ *
+ * \sa setStatsEnabled(), statsUpdated()
+ */
+QLedMatrixStats QLedMatrix::stats() const
+{
+    Q_D(const QLedMatrix);
+    return d->stats;
+}
+
+/**
+ * \internal
+ * Computes the statistics of the interval that just ended and starts the
+ * next one.
+ */
+void QLedMatrix::updateStats()
+{
+    Q_D(QLedMatrix);
+    const qint64 elapsed = d->statsClock.restart();
+    QVector<qint64>& times = d->paintTimes;
+
+    QLedMatrixStats stats;
+    stats.paints = times.size();
+    stats.updateRequests = d->updateRequests;
+    if(elapsed > 0)
+    {
+        stats.framesPerSecond = stats.paints * 1000.0 / elapsed;
+    }
+    if(!times.isEmpty())
+    {
+        std::sort(times.begin(), times.end());
+        qint64 total = 0;
+        for(int i=0; i < times.size(); ++i)
+        {
+            total += times.at(i);
+        }
+        const int p99 = qMax(0, qCeil(times.size() * 0.99) - 1);
+        stats.minPaintTime = times.first() / 1000000.0;
+        stats.averagePaintTime = total / 1000000.0 / times.size();
+        stats.p99PaintTime = times.at(p99) / 1000000.0;
+        stats.ledsPerPaint = qreal(d->ledsDrawnTotal) / times.size();
+        stats.dirtyAreaPerPaint = qreal(d->dirtyArea) / times.size();
+    }
+
+    times.clear();
+    d->ledsDrawnTotal = 0;
+    d->dirtyArea = 0;
+    d->updateRequests = 0;
+    d->stats = stats;
+    Q_EMIT statsUpdated(stats);
+}
+
+/**
+ * \brief Groups the LEDs in panels separated by a spacing.
+ *
+ * The LEDs are drawn in panels of \a panelRows rows and \a panelColumns
+ * columns, from the top left LED, with \a spacing LEDs between them. The
+ * LED coordinates are not changed. Subclasses such as QLedMatrixWall use it
+ * to show tiled displays.
+ *
+ * \param panelRows the number of rows of a panel, 0 for a single panel
+ * \param panelColumns the number of columns of a panel, 0 for a single panel
+ * \param spacing the space between two panels, in LEDs
+ */
+void QLedMatrix::setPanelLayout(int panelRows, int panelColumns, qreal spacing)
+{
+    Q_D(QLedMatrix);
+    d->panelRows = qMax(0, panelRows);
+    d->panelColumns = qMax(0, panelColumns);
+    d->panelSpacing = qMax(qreal(0.0), spacing);
+    d->calculateExtent();
+    d->backBufferValid = false;
+    updateGeometry();
+    update();
+}
+
+/**
+ * \brief Stores the LEDs in memory owned by a subclass.
+ *
+ * The display gets a fixed size and storage format and uses \a leds as its
+ * only frame, without allocating a frame buffer: every function that
+ * changes the LEDs (setColorAt(), setFrame(), transitionTo(), ...) writes
+ * to it, and the display is drawn from it. The storage must stay valid as
+ * long as the display, hold the LEDs row by row as in the given format,
+ * and may be written directly by the subclass, followed by a call to
+ * updateLeds().
+ *
+ * \li QLedMatrix::RgbStorage: \a rows x \a columns QRgb values.
+ * \li QLedMatrix::IndexedStorage: \a rows x \a columns palette indexes
+ *     of one byte each. The palette is reset to the dark LED color, at
+ *     index 0.
+ * \li QLedMatrix::MonochromeStorage: \a rows x ((\a columns + 31) / 32)
+ *     quint32 words, the first column being the most significant bit of
+ *     the first word of a row. The bits past the last column are cleared.
+ *
+ * The LEDs keep the values found in the storage. Afterwards, the size and
+ * the storage format of the display can not be changed.
+ *
+ * \param format the storage format of \a leds
+ * \param leds the LEDs, in the layout of \a format
+ * \param rows the number of rows
+ * \param columns the number of columns
+ *
+ * \sa updateLeds(), QLedMatrixFixed
+ */
+void QLedMatrix::setFixedStorage(StorageFormat format, void* leds, int rows, int columns)
+{
+    Q_D(QLedMatrix);
+    if((leds == 0) || (rows <= 0) || (columns <= 0))
+    {
+        qWarning("QLedMatrix::setFixedStorage: invalid storage");
+        return;
+    }
+
+    d->clearTransition();
+    d->frameBuffer = QVector<QRgb>();
+    d->indexBuffer = QVector<uchar>();
+    d->colorTable = QVector<QRgb>();
+    d->monoBuffer = QVector<quint32>();
+    d->spareFrameBuffer = QVector<QRgb>();
+    d->spareIndexBuffer = QVector<uchar>();
+    d->spareMonoBuffer = QVector<quint32>();
+    d->frameLeds = 0;
+    d->indexLeds = 0;
+    d->monoLeds = 0;
+    d->fixedStorage = true;
+    d->fixedSize = true;
+    d->storageFormat = format;
+    d->rowCount = rows;
+    d->columnCount = columns;
+
+    switch(format)
+    {
+        case IndexedStorage:
+            d->indexLeds = static_cast<uchar*>(leds);
+            d->colorTable.append(d->darkLedColor.rgb());
+            break;
+        case MonochromeStorage:
+            d->monoLeds = static_cast<quint32*>(leds);
+            d->clearPadding();
+            break;
+        default:
+            d->frameLeds = static_cast<QRgb*>(leds);
+            break;
+    }
+
+    d->backBufferValid = false;
+    d->calculateExtent();
+    updateGeometry();
+    d->invalidate(QRect(0, 0, columns, rows));
+}
+
+/**
+ * \brief Schedules the repaint of LEDs written directly to the storage set
+ * with setFixedStorage().
+ *
+ * \param leds the LEDs that changed
+ *
+ * \sa setFixedStorage()
+ */
+void QLedMatrix::updateLeds(const QRect& leds)
+{
+    Q_D(QLedMatrix);
+    const QRect rect = leds & QRect(0, 0, d->columnCount, d->rowCount);
+    if(!rect.isEmpty())
+    {
+        d->invalidate(rect);
+    }
+}
+
+/**
+ * \brief Returns the palette index of the given color in
+ * QLedMatrix::IndexedStorage.
+ *
+ * A color that is not in the palette yet is added to it; when the palette
+ * is full, the index of the closest color is returned. Subclasses writing
+ * palette indexes to their storage (see setFixedStorage()) use it.
+ *
+ * \param rgb the color (in QRgb format)
+ *
+ * \return the palette index of the color, or -1 if the storage format is
+ *         not QLedMatrix::IndexedStorage
+ */
+int QLedMatrix::colorIndex(QRgb rgb)
+{
+    Q_D(QLedMatrix);
+    if(d->storageFormat != IndexedStorage)
+    {
+        return -1;
+    }
+    return d->colorIndex(rgb);
+}
+
+/**
+ * \internal
+ * Reimplemented from QWidget::sizeHint()
+ */
+QSize QLedMatrix::sizeHint() const
+{
+    Q_D(const QLedMatrix);
+    if((d->rowCount > 0) && (d->columnCount > 0))
+    {
+        return QSizeF(d->columnWidth, d->rowHeight).toSize();
+    }
+    else
+    {
+        qWarning("QLedMatrix::sizeHint: no rows or columns to display, defaulting size to (10,10)");
+        return QSize(10, 10);
+    }
+}
+
+/**
+ * \internal
+ * Reimplemented from QWidget::paintEvent()
+ */
+void QLedMatrix::paintEvent(QPaintEvent* event)
+{
+    Q_D(QLedMatrix);
+    QElapsedTimer paintClock;
+    if(d->statsEnabled)
+    {
+        paintClock.start();
+    }
+
+    if(d->recordPending && d->recorder && d->recorder->isOpen())
+    {
+        d->recorder->recordFrame(this);
+        d->recordPending = false;
+    }
+
+    const QRect exposed = event->rect();
+    const bool hasLeds = (d->rowHeight > 0.0) && (d->columnWidth > 0.0);
+    if(hasLeds)
+    {
+        d->ensureTransform();
+    }
+
+    QPainter painter(this);
+    painter.setPen(Qt::NoPen);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    if(hasLeds && (d->renderMode == BufferedRendering))
+    {
+        d->updateBackBuffer();
+        painter.drawImage(exposed, d->backBuffer, exposed);
+    }
+    else
+    {
+        d->drawBackground(painter, exposed);
+        if(hasLeds)
+        {
+            d->drawLEDs(painter, exposed);
+        }
+    }
+
+    if(d->statsEnabled)
+    {
+        painter.end();
+        d->paintTimes.append(paintClock.nsecsElapsed());
+        d->ledsDrawnTotal += d->ledsDrawn;
+
+        const QVector<QRect> rects = regionRects(event->region());
+        for(int i=0; i < rects.size(); ++i)
+        {
+            d->dirtyArea += qint64(rects.at(i).width()) * rects.at(i).height();
+        }
+        d->ledsDrawn = 0;
+    }
+}
+
+//////////////////////////////////
+
+/**
+ * \struct QLedMatrixStats
+ *
+ * \brief The QLedMatrixStats structure holds the statistics of the paint
+ * events of a QLedMatrix over the last second.
  *
- * \sa QRgb
+ * \sa QLedMatrix::setStatsEnabled(), QLedMatrix::stats()
  */
 
 /**
- * \var QLedMatrix::LEDColor QLedMatrix::NoColor
- * Default dark LED color (\#222222)
+ * \var int QLedMatrixStats::paints
+ * Number of paint events
  **/
 
 /**
- * \var QLedMatrix::LEDColor QLedMatrix::Red
- * Red (\#FF0000)
+ * \var int QLedMatrixStats::updateRequests
+ * Number of repaints requested by changes of the LEDs. Qt merges the
+ * requests made before a paint event, so there are usually more requests
+ * than paints.
  **/
 
 /**
- * \var QLedMatrix::LEDColor QLedMatrix::Green
- * Green (\#00FF00)
+ * \var qreal QLedMatrixStats::framesPerSecond
+ * Number of paint events per second
  **/
 
 /**
- * \var QLedMatrix::LEDColor QLedMatrix::Blue
- * Blue (\#0000FF)
+ * \var qreal QLedMatrixStats::minPaintTime
+ * Shortest paint event, in milliseconds
  **/
 
 /**
- * \var QLedMatrix::LEDColor QLedMatrix::White
- * White (\#FFFFFF)
+ * \var qreal QLedMatrixStats::averagePaintTime
+ * Average duration of the paint events, in milliseconds
  **/
 
 /**
- * \var QLedMatrix::LEDColor QLedMatrix::Orange
- * Orange (\#FF8800)
+ * \var qreal QLedMatrixStats::p99PaintTime
+ * 99th percentile of the duration of the paint events, in milliseconds
  **/
 
 /**
- * \var QLedMatrix::LEDColor QLedMatrix::OrangeRed
- * Orange-Red (\#FF2200)
+ * \var qreal QLedMatrixStats::ledsPerPaint
+ * Average number of LEDs drawn by a paint event. In
+ * QLedMatrix::BufferedRendering, only the LEDs drawn in the back buffer are
+ * counted.
  **/
 
 /**
- * \var QLedMatrix::LEDColor QLedMatrix::Yellow
- * Yellow (\#FFFF00)
+ * \var qreal QLedMatrixStats::dirtyAreaPerPaint
+ * Average area repainted by a paint event, in pixels
  **/
 
 /**
- * Constructs a LED Matrix display, sets the background color to black,
- * the background mode to opaque, the dark LED color to QLedMatrix::NoColor and
- * the number of rows and columns to 0.
- *
- * \sa setBackgroundColor(), setBackgroundMode(), setDarkLedColor(),
- *     setRowCount(), setColumnCount()
- *
- * \param parent parent QWidget
- */
-QLedMatrix::QLedMatrix(QWidget* parent): QWidget(parent),
-    d_ptr(new QLedMatrixPrivate)
-{
-    Q_D(QLedMatrix);
-    d->q_ptr = this;
-    d->backgroundBrush = QBrush(Qt::black, Qt::SolidPattern);
-    d->backgroundMode = Qt::OpaqueMode;
-    d->darkLedColor = QColor(QLedMatrix::NoColor);
-    d->rowCount = 0;
-    d->columnCount = 0;
-    d->rowHeight = 0.0;
-    d->columnWidth = 0.0;
-    d->aspectRatio = 0.0;
-}
-
-/**
- * Destroys the LED Matrix display.
+ * Constructs statistics set to zero.
  */
-QLedMatrix::~QLedMatrix()
+QLedMatrixStats::QLedMatrixStats():
+    paints(0),
+    updateRequests(0),
+    framesPerSecond(0.0),
+    minPaintTime(0.0),
+    averagePaintTime(0.0),
+    p99PaintTime(0.0),
+    ledsPerPaint(0.0),
+    dirtyAreaPerPaint(0.0)
 {
-    delete d_ptr;
 }
 
 /**
- * \brief Clears the LED Matrix display.
+ * \fn void QLedMatrix::statsUpdated(const QLedMatrixStats& stats)
  *
- * When the display is cleared, all the LEDs are set to the dark LED color.
+ * This signal is emitted every second while the statistics are enabled, with
+ * the statistics of the last second.
  *
- * \sa darkLedColor(), setDarkLedColor()
+ * \sa setStatsEnabled()
  */
-void QLedMatrix::clear()
-{
-    Q_D(QLedMatrix);
-    for(int i=0; i < d->rowCount; ++i)
-    {
-        for(int j=0; j < d->columnCount; ++j)
-        {
-            d->colorTable[j][i] = d->darkLedColor.rgb();
-        }
-    }
-    update();
-}
 
 /**
- * \brief Returns the background color of the widget.
- *
- * \return background color of the widget
+ * \fn void QLedMatrix::transitionFinished()
  *
- * \sa setBackgroundColor()
+ * This signal is emitted when a transition started by transitionTo() has
+ * shown its final frame.
  */
-QColor QLedMatrix::backgroundColor() const
-{
-    Q_D(const QLedMatrix);
-    return d->backgroundBrush.color();
-}
+
+//////////////////////////////////
 
 /**
- * \brief Sets the background color of the widget to the given color.
+ * \class QLedMatrixUpdateGuard
  *
- * The background color of the widget will only be visible if the background
- * mode is set to Qt::OpaqueMode.
+ * \brief The QLedMatrixUpdateGuard class batches the changes made to a
+ * QLedMatrix during its lifetime.
  *
- * \param color the background color to be set
+ * It calls QLedMatrix::beginUpdate() when constructed and
+ * QLedMatrix::endUpdate() when destroyed, so the display is repainted once
+ * when the guard goes out of scope.
  *
- * \sa backgroundColor(), backgroundMode(), setBackgroundMode()
+ * \code
+ * {
+ *     QLedMatrixUpdateGuard guard(&matrix);
+ *     for(int col=0; col < matrix.columnCount(); ++col)
+ *         matrix.setColorAt(0, col, QLedMatrix::Red);
+ * } // repainted here
+ * \endcode
  */
-void QLedMatrix::setBackgroundColor(const QColor& color)
-{
-    Q_D(QLedMatrix);
-    d->backgroundBrush.setColor(color);
-    update();
-}
 
 /**
- * \brief Returns the background mode of the widget.
+ * Starts a batch of changes to \a matrix.
  *
- * \return background mode of the widget
- *
- * \sa setBackgroundMode()
+ * \param matrix the LED matrix display to update
  */
-Qt::BGMode QLedMatrix::backgroundMode() const
+QLedMatrixUpdateGuard::QLedMatrixUpdateGuard(QLedMatrix* matrix):
+    matrix(matrix)
 {
-    Q_D(const QLedMatrix);
-    return d->backgroundMode;
+    matrix->beginUpdate();
 }
 
 /**
- * \brief Sets the background mode of the widget to the given mode.
- *
- * Qt::OpaqueMode (the default) fills the widget's background with the current
- * background color. Qt::TransparentMode doesn't draw any background color.
- *
- * \param mode the background mode to be set
- *
- * \sa backgroundMode(), backgroundColor(), setBackgroundColor()
+ * Ends the batch of changes and schedules the repaint.
  */
-void QLedMatrix::setBackgroundMode(Qt::BGMode mode)
+QLedMatrixUpdateGuard::~QLedMatrixUpdateGuard()
 {
-    Q_D(QLedMatrix);
-    d->backgroundMode = mode;
-    update();
+    matrix->endUpdate();
 }
 
-/**
- * \brief Returns the dark LED color.
- *
- * \return dark LED color
- *
- * \sa setDarkLedColor()
- */
-QColor QLedMatrix::darkLedColor() const
-{
-    Q_D(const QLedMatrix);
-    return d->darkLedColor;
-}
+//////////////////////////////////
 
 /**
- * \brief Sets the dark LED color to the given color.
+ * \class QLedMatrixScanLineWriter
  *
- * The dark LED color is used to represent a LED in the 'off' state. It is
- * used when adding rows or cols, and when using the clear() method.
- *
- * \param color the color to be set
+ * \brief The QLedMatrixScanLineWriter class gives write access to the rows
+ * of LEDs of a QLedMatrix.
  *
- * \sa darkLedColor(), clear(), setRowCount(), setColumnCount()
- */
-void QLedMatrix::setDarkLedColor(const QColor& color)
-{
-    Q_D(QLedMatrix);
-    QRgb oldColor = d->darkLedColor.rgb();
-    d->darkLedColor = color;
-
-    for(int i=0; i < d->rowCount; ++i)
-    {
-        for(int j=0; j < d->columnCount; ++j)
-        {
-            if(d->colorTable[j][i] == oldColor)
-            {
-                d->colorTable[j][i] = d->darkLedColor.rgb();
-            }
-        }
-    }
-    update();
-}
-
-/**
- * \brief Returns the color of the LED at the specified position.
+ * The writer covers a rectangle of LEDs, the whole display by default. The
+ * rows returned by scanLine() can be written directly, without any check or
+ * repaint per LED; the rectangle is repainted once, when the writer is
+ * destroyed.
  *
- * This function uses the QRgb data format. If the specified position is
- * invalid, this function will return the current dark LED color.
+ * In QLedMatrix::RgbStorage, scanLine() returns the frame buffer of the
+ * display. In the other storage formats, the rows of the rectangle are
+ * converted to QRgb values when the writer is constructed, and stored back
+ * when it is destroyed.
  *
- * \param row the row index of the LED
- * \param col the column index of the LED
+ * \code
+ * {
+ *     QLedMatrixScanLineWriter writer(&matrix, gauge);
+ *     for(int row=gauge.top(); row <= gauge.bottom(); ++row)
+ *     {
+ *         QRgb* line = writer.scanLine(row);
+ *         for(int col=gauge.left(); col <= gauge.right(); ++col)
+ *             line[col] = level(row, col);
+ *     }
+ * } // repainted here
+ * \endcode
  *
- * \return the color of the LED at the given position
+ * Only the LEDs of the rectangle may be written. The display must not be
+ * resized or change its storage format while the writer exists.
  *
- * \sa setColorAt(), darkLedColor()
+ * \sa QLedMatrix::constScanLine(), QLedMatrixUpdateGuard
  */
-QRgb QLedMatrix::colorAt(int row, int col) const
-{
-    Q_D(const QLedMatrix);
-    if(d->isValid(row, col))
-    {
-        return d->colorTable[col][row];
-    }
-
-    qWarning("QLedMatrix::colorAt: coordinate (row=%d, col=%d) out of range", row, col);
-    return d->darkLedColor.rgb();
-}
 
 /**
- * \brief Sets the given color to the LED at the specified position.
+ * Gives write access to all the LEDs of \a matrix.
  *
- * If the specified position is invalid, this function will do nothing.
- *
- * \param row the row index of the LED
- * \param col the column index of the LED
- * \param rgb the color to be set (in QRgb format)
- *
- * \sa colorAt()
+ * \param matrix the LED matrix display to write
  */
-void QLedMatrix::setColorAt(int row, int col, QRgb rgb)
+QLedMatrixScanLineWriter::QLedMatrixScanLineWriter(QLedMatrix* matrix):
+    matrix(matrix),
+    leds(0, 0, matrix->columnCount(), matrix->rowCount())
 {
-    Q_D(QLedMatrix);
-    d->setColorAt(row, col, rgb, true);
+    init();
 }
 
 /**
- * \brief Returns the number of rows in the LED matrix display.
- *
- * \return the number of rows in the LED matrix display
+ * Gives write access to a rectangle of LEDs of \a matrix. The parts of the
+ * rectangle outside the display are ignored.
  *
- * \sa setRowCount(), columnCount()
+ * \param matrix the LED matrix display to write
+ * \param leds the rectangle of LEDs, in columns and rows
  */
-int QLedMatrix::rowCount() const
+QLedMatrixScanLineWriter::QLedMatrixScanLineWriter(QLedMatrix* matrix, const QRect& leds):
+    matrix(matrix),
+    leds(leds & QRect(0, 0, matrix->columnCount(), matrix->rowCount()))
 {
-    Q_D(const QLedMatrix);
-    return d->rowCount;
+    init();
 }
 
 /**
- * \brief Sets the number of rows in the LED matrix display.
- *
- * This function will do nothing if the new number of rows is less than 0
- * or if it is equal to the current number of rows. If the new number of
- * rows is less than the current number of rows, the display will be
- * cropped to the new value. Otherwise, if the new number of rows is
- * greater than the current number of rows, the new LEDs will be
- * initialized using the dark LED color.
- * 
- * \param rows the new number of rows
- *
- * \sa rowsCount(), setColumnCount(), darkLedColor()
+ * \internal
+ * Converts the rows of the rectangle when the LEDs are not stored as QRgb.
  */
-void QLedMatrix::setRowCount(int rows)
+void QLedMatrixScanLineWriter::init()
 {
-    Q_D(QLedMatrix);
-    if((rows >= 0) && (rows != d->rowCount))
+    const QLedMatrixPrivate* d = matrix->d_func();
+    if((d->storageFormat == QLedMatrix::RgbStorage) || leds.isEmpty())
     {
-        int previousRowCount = d->rowCount;
-        d->rowCount = rows;
-        d->rowHeight = 10.0 * rows;
-        d->calculateAspectRatio();
+        return;
+    }
 
-        for(int i=0; i < d->columnCount; ++i)
+    buffer.resize(leds.height() * d->columnCount);
+    for(int row=0; row < leds.height(); ++row)
+    {
+        QRgb* line = buffer.data() + row * d->columnCount;
+        const QRgb* fetched = d->fetchScanLine(leds.top() + row, line);
+        if(fetched != line)
         {
-            d->colorTable[i].resize(rows);
-            if(rows > previousRowCount)
-            {
-                for(int j=previousRowCount; j < rows; ++j)
-                {
-                    d->setColorAt(j, i, d->darkLedColor.rgb(), false);
-                }
-            }
+            memcpy(line, fetched, d->columnCount * sizeof(QRgb));
         }
-
-        update();
     }
 }
 
 /**
- * \brief Returns the number of columns in the LED matrix display.
- *
- * \return the number of columns in the LED matrix display
- *
- * \sa setColumnCount(), rowCount()
- */
-int QLedMatrix::columnCount() const
-{
-    Q_D(const QLedMatrix);
-    return d->columnCount;
-}
-
-/**
- * \brief Sets the number of columns in the LED matrix display.
- *
- * This function will do nothing if the new number of columns is less than 0
- * or if it is equal to the current number of columns. If the new number of
- * columns is less than the current number of columns, the display will be
- * cropped to the new value. Otherwise, if the new number of columns is
- * greater than the current number of columns, the new LEDs will be
- * initialized using the dark LED color.
- * 
- * \param columns the new number of columns
- *
- * \sa columnCount(), setRowCount(), darkLedColor()
+ * Stores the rows back if needed and repaints the rectangle.
  */
-void QLedMatrix::setColumnCount(int columns)
+QLedMatrixScanLineWriter::~QLedMatrixScanLineWriter()
 {
-    Q_D(QLedMatrix);
-    if((columns >= 0) && (columns != d->columnCount))
+    if(leds.isEmpty())
     {
-        int previousColumnsCount = d->columnCount;
-        d->columnCount = columns;
-        d->columnWidth = 10.0 * columns; 
-        d->calculateAspectRatio();
+        return;
+    }
 
-        d->colorTable.resize(columns);
-        if(columns > previousColumnsCount)
+    QLedMatrixPrivate* d = matrix->d_func();
+    if(!buffer.isEmpty())
+    {
+        for(int row=0; row < leds.height(); ++row)
         {
-            for(int i=previousColumnsCount; i<columns; ++i)
-            {
-                d->colorTable[i].resize(d->rowCount);
-                for(int j=0; j < d->rowCount; ++j)
-                {
-                    d->setColorAt(j, i, d->darkLedColor.rgb(), false);
-                }
-            }
+            d->storeScanLine(leds.top() + row, leds.left(),
+                             buffer.constData() + row * d->columnCount + leds.left(),
+                             leds.width());
         }
-
-        update();
     }
+    d->invalidate(leds);
 }
 
 /**
- * \internal
- * Reimplemented from QWidget::sizeHint()
+ * \brief Returns the rectangle of LEDs covered by the writer.
+ *
+ * \return the rectangle of LEDs, inside the display
  */
-QSize QLedMatrix::sizeHint() const
+QRect QLedMatrixScanLineWriter::rect() const
 {
-    Q_D(const QLedMatrix);
-    if((d->rowCount > 0) && (d->columnCount > 0))
-    {
-        return QSizeF(d->columnWidth, d->rowHeight).toSize();
-    }
-    else
-    {
-        qWarning("QLedMatrix::sizeHint: no rows or columns to display, defaulting size to (10,10)");
-        return QSize(10, 10);
-    }
+    return leds;
 }
 
 /**
- * \internal
- * Reimplemented from QWidget::paintEvent()
+ * \brief Returns a row of LEDs to be written.
+ *
+ * The row is indexed by column, from 0 to columnCount() - 1, but only the
+ * columns of rect() may be written. The row is not checked, except by an
+ * assertion in debug builds.
+ *
+ * \param row a row of rect()
+ *
+ * \return the colors of the row (in QRgb format)
  */
-void QLedMatrix::paintEvent(QPaintEvent* /* event */)
+QRgb* QLedMatrixScanLineWriter::scanLine(int row)
 {
-    Q_D(QLedMatrix);
-    QPainter painter(this);
-    painter.setPen(Qt::NoPen);
-    painter.setRenderHint(QPainter::Antialiasing);
-
-    if(d->backgroundMode == Qt:: OpaqueMode)
-    {
-        painter.setBrush(d->backgroundBrush);
-        painter.drawRect(0, 0, width(), height());
-    }
-
-    if((d->rowHeight > 0.0) && (d->columnWidth > 0.0))
+    Q_ASSERT((row >= leds.top()) && (row <= leds.bottom()));
+    QLedMatrixPrivate* d = matrix->d_func();
+    if(buffer.isEmpty())
     {
-        const qreal w = width();
-        const qreal h = height();
-        const qreal currentAspectRatio  = w / h;
-
-        painter.translate(w / 2.0, h / 2.0);
-
-        // Set the scale factor to keep the aspect ratio
-        if(currentAspectRatio > d->aspectRatio)
-        {
-            qreal side = h / d->rowHeight;
-            painter.scale(side, side);
-        }
-        else if(currentAspectRatio < d->aspectRatio)
-        {
-            qreal side = w / d->columnWidth;
-            painter.scale(side, side);
-        }
-        else
-        {
-            painter.scale(w / d->columnWidth, h / d->rowHeight);
-        }
-
-        painter.translate(1.0 - (d->columnWidth/2), 1.0 - (d->rowHeight/2));
-        d->drawLEDs(painter);
+        return d->scanLine(row);
     }
+    return buffer.data() + (row - leds.top()) * d->columnCount;
 }
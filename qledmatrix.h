@@ -22,6 +22,7 @@
 #define QLEDMATRIX_H
 
 #include <QObject>
+#include <QVector>
 
 #if QT_VERSION > QT_VERSION_CHECK(5,0,0)
 // QT 5.x
@@ -40,14 +41,42 @@
 #include <QtDesigner/QDesignerExportWidget>
 #endif
 
+class QImage;
+class QLedMatrixFont;
+class QLedMatrixFrameSink;
 class QLedMatrixPrivate;
+class QLedMatrixRecorder;
+
+struct QDESIGNER_WIDGET_EXPORT QLedMatrixStats
+{
+    QLedMatrixStats();
+
+    int paints;
+    int updateRequests;
+    qreal framesPerSecond;
+    qreal minPaintTime;
+    qreal averagePaintTime;
+    qreal p99PaintTime;
+    qreal ledsPerPaint;
+    qreal dirtyAreaPerPaint;
+};
+
 class QDESIGNER_WIDGET_EXPORT QLedMatrix: public QWidget
 {
     Q_OBJECT
     Q_ENUMS(LEDColor)
+    Q_ENUMS(RenderMode)
+    Q_ENUMS(StorageFormat)
+    Q_ENUMS(TransitionType)
     Q_PROPERTY(QColor backgroundColor READ backgroundColor WRITE setBackgroundColor)
     Q_PROPERTY(Qt::BGMode backgroundMode READ backgroundMode WRITE setBackgroundMode)
     Q_PROPERTY(QColor darkLedColor READ darkLedColor WRITE setDarkLedColor)
+    Q_PROPERTY(QColor litLedColor READ litLedColor WRITE setLitLedColor)
+    Q_PROPERTY(RenderMode renderMode READ renderMode WRITE setRenderMode)
+    Q_PROPERTY(qreal detailThreshold READ detailThreshold WRITE setDetailThreshold)
+    Q_PROPERTY(bool smoothScaling READ isSmoothScaling WRITE setSmoothScaling)
+    Q_PROPERTY(int renderThreadCount READ renderThreadCount WRITE setRenderThreadCount)
+    Q_PROPERTY(StorageFormat storageFormat READ storageFormat WRITE setStorageFormat)
     Q_PROPERTY(int rows READ rowCount WRITE setRowCount)
     Q_PROPERTY(int columns READ columnCount WRITE setColumnCount)
 
@@ -69,7 +98,37 @@ class QDESIGNER_WIDGET_EXPORT QLedMatrix: public QWidget
             Yellow    = 0xFFFFFF00
         };
 
+        enum RenderMode
+        {
+            DirectRendering,
+            BufferedRendering
+        };
+
+        enum StorageFormat
+        {
+            RgbStorage,
+            IndexedStorage,
+            MonochromeStorage
+        };
+
+        enum TransitionType
+        {
+            Crossfade,
+            WipeLeft,
+            WipeRight,
+            WipeUp,
+            WipeDown,
+            Dissolve
+        };
+
         void clear();
+        void invert();
+        void scrollLeds(int dx, int dy);
+        void scrollLeds(int dx, int dy, QRgb rgb);
+        void rotate(int dx, int dy);
+
+        void beginUpdate();
+        void endUpdate();
 
         QColor backgroundColor() const;
         void setBackgroundColor(const QColor& color);
@@ -80,24 +139,137 @@ class QDESIGNER_WIDGET_EXPORT QLedMatrix: public QWidget
         QColor darkLedColor() const;
         void setDarkLedColor(const QColor& color);
 
+        QColor litLedColor() const;
+        void setLitLedColor(const QColor& color);
+
+        RenderMode renderMode() const;
+        void setRenderMode(RenderMode mode);
+
+        int renderThreadCount() const;
+        void setRenderThreadCount(int threads);
+
+        qreal detailThreshold() const;
+        void setDetailThreshold(qreal pixels);
+
+        bool isSmoothScaling() const;
+        void setSmoothScaling(bool smooth);
+
         QRgb colorAt(int row, int col) const;
         void setColorAt(int row, int col, QRgb rgb);
 
+        QImage frame() const;
+        void setFrame(const QImage& image);
+        void setFrame(const QImage& image, QRgb onColor, QRgb offColor, int threshold = 128);
+        void setPixels(const QRgb* data, int stride);
+        void setPixels(const QRect& leds, const QRgb* data, int stride);
+        const QRgb* constScanLine(int row) const;
+
+        void fillRect(const QRect& leds, QRgb rgb);
+        void blit(const QImage& image, const QPoint& position);
+        void copyRect(const QRect& source, const QPoint& target);
+
+        StorageFormat storageFormat() const;
+        void setStorageFormat(StorageFormat format);
+
+        int paletteSize() const;
+        QRgb paletteColor(int index) const;
+        void setPaletteColor(int index, QRgb rgb);
+
+        int colorIndexAt(int row, int col) const;
+        void setColorIndexAt(int row, int col, int index);
+
+        QLedMatrixFont ledFont() const;
+        void setLedFont(const QLedMatrixFont& font);
+
+        void drawText(int row, int col, const QString& text, QRgb rgb);
+
+        void scrollText(const QString& text, QRgb rgb, int pixelsPerSecond = 30);
+        void stopScrollText();
+        bool isScrollingText() const;
+
+        void transitionTo(const QImage& frame, TransitionType type, int duration);
+        void stopTransition();
+        bool isTransitioning() const;
+
+        QLedMatrixFrameSink* frameSink() const;
+        void setFrameSink(QLedMatrixFrameSink* sink);
+
+        QLedMatrixRecorder* recorder() const;
+        void setRecorder(QLedMatrixRecorder* recorder);
+
         int rowCount() const;
         void setRowCount(int rows);
 
         int columnCount() const;
         void setColumnCount(int columns);
 
+        QSize matrixSize() const;
+        void setMatrixSize(int rows, int columns,
+                           Qt::Alignment anchor = Qt::AlignTop | Qt::AlignLeft);
+        void reserveMatrixSize(int rows, int columns);
+
+        bool isStatsEnabled() const;
+        void setStatsEnabled(bool enabled);
+        QLedMatrixStats stats() const;
+
         QSize sizeHint() const;
 
+    Q_SIGNALS:
+        void statsUpdated(const QLedMatrixStats& stats);
+        void transitionFinished();
+
     protected:
+        QLedMatrix(QLedMatrixPrivate& dd, QWidget* parent);
+
         QLedMatrixPrivate* const d_ptr;
         void paintEvent(QPaintEvent* event);
+        void setPanelLayout(int panelRows, int panelColumns, qreal spacing);
+        void setFixedStorage(StorageFormat format, void* leds, int rows, int columns);
+        void updateLeds(const QRect& leds);
+        int colorIndex(QRgb rgb);
+
+    private Q_SLOTS:
+        void presentSinkFrame();
+        void scrollTextStep();
+        void transitionStep();
+        void updateStats();
 
     private:
         Q_DISABLE_COPY(QLedMatrix)
         Q_DECLARE_PRIVATE(QLedMatrix)
+        friend class QLedMatrixScanLineWriter;
 };
 
+class QDESIGNER_WIDGET_EXPORT QLedMatrixUpdateGuard
+{
+    public:
+        explicit QLedMatrixUpdateGuard(QLedMatrix* matrix);
+        ~QLedMatrixUpdateGuard();
+
+    private:
+        Q_DISABLE_COPY(QLedMatrixUpdateGuard)
+        QLedMatrix* const matrix;
+};
+
+class QDESIGNER_WIDGET_EXPORT QLedMatrixScanLineWriter
+{
+    public:
+        explicit QLedMatrixScanLineWriter(QLedMatrix* matrix);
+        QLedMatrixScanLineWriter(QLedMatrix* matrix, const QRect& leds);
+        ~QLedMatrixScanLineWriter();
+
+        QRect rect() const;
+        QRgb* scanLine(int row);
+
+    private:
+        Q_DISABLE_COPY(QLedMatrixScanLineWriter)
+        void init();
+
+        QLedMatrix* const matrix;
+        QRect leds;
+        QVector<QRgb> buffer; // rows of leds, when the LEDs are not stored as QRgb
+};
+
+Q_DECLARE_METATYPE(QLedMatrixStats)
+
 #endif // QLEDMATRIX_H
@@ -8,7 +8,7 @@ CONFIG                 += debug_and_release
 CONFIG                 += qt
 CONFIG                 += warn_on
 greaterThan(QT_MAJOR_VERSION, 4) {
-    QT                 += designer
+    QT                 += designer concurrent
 } else {
     CONFIG             += designer
 }
@@ -24,9 +24,31 @@ RCC_DIR                 = build/rcc
 DEPENDDIR               = .
 INCLUDEDIR              = .
 HEADERS                += qledmatrix.h \
-                          qledmatrixplugin.h
+                          qledmatrix_p.h \
+                          qledmatrixanimation.h \
+                          qledmatrixfixed.h \
+                          qledmatrixfont.h \
+                          qledmatrixframesink.h \
+                          qledmatrixkernels_p.h \
+                          qledmatrixplugin.h \
+                          qledmatrixrecorder.h \
+                          qledmatrixrenderer.h \
+                          qledmatrixrenderer_p.h \
+                          qledmatrixsharedfeed.h \
+                          qledmatrixstream.h \
+                          qledmatrixstream_p.h \
+                          qledmatrixwall.h
 SOURCES                += qledmatrix.cpp \
-                          qledmatrixplugin.cpp
+                          qledmatrixanimation.cpp \
+                          qledmatrixfont.cpp \
+                          qledmatrixframesink.cpp \
+                          qledmatrixkernels.cpp \
+                          qledmatrixplugin.cpp \
+                          qledmatrixrecorder.cpp \
+                          qledmatrixrenderer.cpp \
+                          qledmatrixsharedfeed.cpp \
+                          qledmatrixstream.cpp \
+                          qledmatrixwall.cpp
 RESOURCES              += qledmatrix.qrc
 
 CONFIG(debug, debug|release) {
@@ -0,0 +1,209 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef QLEDMATRIX_P_H
+#define QLEDMATRIX_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QLedMatrix API. It is shared by QLedMatrix
+// and its subclasses and may change without notice.
+//
+
+#include "qledmatrix.h"
+#include "qledmatrixfont.h"
+#include "qledmatrixframesink.h"
+#include "qledmatrixrecorder.h"
+
+#include <qbrush.h>
+#include <qcolor.h>
+#include <qelapsedtimer.h>
+#include <qhash.h>
+#include <qimage.h>
+#include <qpointer.h>
+#include <qregion.h>
+#include <qtransform.h>
+#include <qvector.h>
+
+class QPainter;
+class QTimer;
+struct QLedMatrixGeometry;
+
+/**
+ * \internal
+ * State of a QLedMatrix. Subclasses such as QLedMatrixWall derive their
+ * private class from it and pass it to the protected QLedMatrix
+ * constructor.
+ */
+class QLedMatrixPrivate
+{
+    Q_DECLARE_PUBLIC(QLedMatrix)
+
+    public:
+        QLedMatrixPrivate();
+        virtual ~QLedMatrixPrivate();
+
+        void init();
+        bool isValid(int row, int col) const;
+        void setColorAt(int row, int col, QRgb rgb, bool doUpdate);
+        QRgb pixel(int row, int col) const;
+        void setPixel(int row, int col, QRgb rgb);
+        const QRgb* fetchScanLine(int row, QRgb* buffer) const;
+        void storeScanLine(int row, int col, const QRgb* data, int count);
+        void fill(QRgb rgb);
+        void clearPadding();
+        void invert();
+        void fillLeds(const QRect& leds, QRgb rgb);
+        void copyLeds(const QRect& source, const QPoint& target);
+        void scroll(int dx, int dy, QRgb rgb);
+        void rotate(int dx, int dy);
+        int colorIndex(QRgb rgb);
+        void importMonochrome(const QImage& image);
+        void resize(int rows, int columns, Qt::Alignment anchor);
+        void resizeFrameBuffer(int rows, int columns, Qt::Alignment anchor);
+        void attachBuffers();
+        void copyPixels(const QRgb* data, const QRect& leds, int stride);
+        void drawColumns(const quint32* columns, int count, int height,
+                         int row, int col, QRgb rgb);
+        void startTransition(const QImage& frame, QLedMatrix::TransitionType type);
+        bool stepTransition();
+        void clearTransition();
+        void invalidate(const QRect& leds);
+        void invalidateScrolled(int dx, int dy);
+        void drawLEDs(QPainter& painter, const QRect& exposed);
+        void drawLedImage(QPainter& painter);
+        void drawBackground(QPainter& painter, const QRect& exposed) const;
+        void updateOpaquePaint();
+        void updateBackBuffer();
+        void rasterizeArea(const QRect& dirty);
+        int bandCount(const QRect& dirty, const QRect& leds) const;
+        void rasterizeBand(uchar* bits, const QRect& band) const;
+        void prepareSpriteImages(const QRect& leds);
+        void rasterizeLeds(QPainter& painter, const QRect& leds) const;
+        QRect ledsIn(const QRect& exposed) const;
+        void calculateAspectRatio();
+        void calculateExtent();
+        int columnAt(qreal x) const;
+        int rowAt(qreal y) const;
+        QLedMatrixGeometry ledGeometry() const;
+        void calculateTransform(int width, int height);
+        void ensureTransform();
+        QRect deviceRect(const QRect& leds) const;
+
+        inline QRgb* scanLine(int row)
+        { return frameLeds + row * columnCount; }
+        inline const QRgb* constScanLine(int row) const
+        { return frameLeds + row * columnCount; }
+        inline uchar* indexScanLine(int row)
+        { return indexLeds + row * columnCount; }
+        inline const uchar* constIndexScanLine(int row) const
+        { return indexLeds + row * columnCount; }
+        // Position of a LED in LED coordinates, panel spacing included
+        inline qreal ledX(int col) const
+        { return 10.0 * col + ((panelColumns > 0) ? 10.0 * panelSpacing * (col / panelColumns) : 0.0); }
+        inline qreal ledY(int row) const
+        { return 10.0 * row + ((panelRows > 0) ? 10.0 * panelSpacing * (row / panelRows) : 0.0); }
+        inline int monoStride() const
+        { return (columnCount + 31) / 32; }
+        inline quint32* monoScanLine(int row)
+        { return monoLeds + row * monoStride(); }
+        inline const quint32* constMonoScanLine(int row) const
+        { return monoLeds + row * monoStride(); }
+
+        QLedMatrix* q_ptr;
+        QBrush backgroundBrush;
+        Qt::BGMode backgroundMode;
+        QColor darkLedColor;
+        QLedMatrix::StorageFormat storageFormat;
+        QVector<QRgb> frameBuffer; // RgbStorage: row-major, stride is columnCount
+        QVector<uchar> indexBuffer; // IndexedStorage: same layout as frameBuffer
+        QVector<QRgb> colorTable; // IndexedStorage: 1 to 256 colors
+        QVector<quint32> monoBuffer; // MonochromeStorage: 1 bit per LED, see testBit()
+        QVector<QRgb> spareFrameBuffer; // previous allocations, see resizeBuffer()
+        QVector<uchar> spareIndexBuffer;
+        QVector<quint32> spareMonoBuffer;
+        QRgb* frameLeds; // frameBuffer, or the fixed storage (see setFixedStorage())
+        uchar* indexLeds; // indexBuffer, or the fixed storage
+        quint32* monoLeds; // monoBuffer, or the fixed storage
+        bool fixedStorage; // the LEDs are stored by a subclass, see setFixedStorage()
+        bool fixedSize; // only the subclass resizes the display, see resize()
+        mutable QVector<QRgb> constLine; // see QLedMatrix::constScanLine()
+        QColor litLedColor;
+        int rowCount;
+        int columnCount;
+        int panelRows; // LEDs are grouped in panels of this size, 0 if not
+        int panelColumns;
+        qreal panelSpacing; // between panels, in LEDs
+        qreal rowHeight;
+        qreal columnWidth;
+        qreal aspectRatio;
+        QTransform transform; // LED coordinates to device coordinates
+        QSize transformSize;
+        bool transformDirty;
+        int updateDepth;
+        QRect dirtyLeds; // LEDs changed since beginUpdate()
+        QPointer<QLedMatrixFrameSink> frameSink;
+        QPointer<QLedMatrixRecorder> recorder;
+        bool recordPending; // LEDs changed since the last recorded frame
+        QLedMatrix::RenderMode renderMode;
+        QImage backBuffer;
+        QTransform backBufferTransform;
+        QRegion backBufferDirtyLeds; // LEDs not rasterized in the back buffer yet
+        bool backBufferValid;
+        QHash<QRgb, QImage> spriteImages; // BufferedRendering, read by the band threads
+        qreal spriteImageDiameter;
+        int renderThreads; // 0 for QThread::idealThreadCount()
+        qreal detailThreshold; // smallest sprite diameter, in pixels
+        bool smoothScaling;
+        QImage ledImage; // one pixel per LED, see drawLedImage()
+        QLedMatrixFont font;
+        QTimer* marqueeTimer;
+        QElapsedTimer marqueeClock;
+        qint64 marqueeSteps; // columns scrolled since scrollText()
+        QVector<quint32> marqueeRun; // columns of the scrolling text
+        int marqueeHeight;
+        int marqueePosition; // column of marqueeRun shown next
+        int marqueeSpeed; // in columns per second
+        QRgb marqueeColor;
+        QTimer* transitionTimer;
+        QElapsedTimer transitionClock;
+        QLedMatrix::TransitionType transitionType;
+        int transitionDuration; // in milliseconds
+        QVector<QRgb> transitionSource; // colors when the transition started
+        QVector<QRgb> transitionTarget; // colors at the end
+        QVector<int> transitionSpans; // first and last changed column of each row, -1 if none
+        QVector<int> transitionOrder; // Dissolve: the changed LEDs, shuffled
+        int transitionPosition; // lines or LEDs done; Crossfade: next row of the pass
+        int transitionLevel; // Crossfade: blend level of the current pass
+        quint32 transitionSeed;
+        bool statsEnabled;
+        QTimer* statsTimer;
+        QElapsedTimer statsClock; // start of the current interval
+        QVector<qint64> paintTimes; // in nanoseconds, for the current interval
+        qint64 ledsDrawn; // since the last paint event
+        qint64 ledsDrawnTotal;
+        qint64 dirtyArea; // in pixels
+        int updateRequests;
+        QLedMatrixStats stats; // of the last complete interval
+};
+
+#endif // QLEDMATRIX_P_H
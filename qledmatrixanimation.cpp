@@ -0,0 +1,905 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include "qledmatrixanimation.h"
+
+#include <qdir.h>
+#include <qelapsedtimer.h>
+#include <qimage.h>
+#include <qmovie.h>
+#include <qpointer.h>
+#include <qstringlist.h>
+#include <qtimer.h>
+#include <qvector.h>
+
+#include <limits.h>
+#include <string.h>
+
+// Shortest delay between two frames, in milliseconds
+static const int MinFrameDelay = 10;
+
+// Unchanged LEDs between two changed ones of a row above which the changes
+// are stored in separate rectangles
+static const int MaxRectGap = 4;
+
+/**
+ * \internal
+ */
+class QLedMatrixAnimationPrivate
+{
+    public:
+        // Changes from a frame to the next one
+        struct Delta
+        {
+            QVector<QRect> rects; // LEDs that changed
+            QVector<QRgb> colors; // new colors of the rectangles, row by row
+        };
+
+        struct Keyframe
+        {
+            int frame;
+            QVector<QRgb> pixels;
+        };
+
+        QVector<QRgb> convert(const QImage& image, const QRect& rect) const;
+        void append(const QVector<QRgb>& pixels, int delay);
+        void encode(const QVector<QRgb>& from, const QVector<QRgb>& to, Delta& delta) const;
+        void apply(const Delta& delta, QVector<QRect>* dirty);
+        const Delta& delta(int frame);
+        int keyframe(int frame) const;
+        void moveTo(int frame);
+        void present(const QVector<QRect>& dirty);
+        void presentAll();
+
+        int rowCount;
+        int columnCount;
+        QVector<int> delays;
+        QVector<Delta> deltas; // deltas[i] leads from frame i - 1 to frame i
+        QVector<Keyframe> keyframes;
+        Delta loopDelta; // leads from the last frame to the first one
+        bool loopDeltaValid;
+        QVector<QRgb> lastFrame; // last frame added
+        int changesSinceKeyframe; // LEDs stored in deltas since the last keyframe
+        QVector<QRgb> current; // frame shown
+        int currentFrame;
+        QPointer<QLedMatrix> matrix;
+        QTimer* timer;
+        QElapsedTimer clock;
+        qint64 frameStart; // time at which the current frame was due
+        bool looping;
+        bool running;
+};
+
+/**
+ * \internal
+ * Returns the colors of a rectangle of an image, cropped or padded with
+ * QLedMatrix::NoColor to the size of the animation.
+ */
+QVector<QRgb> QLedMatrixAnimationPrivate::convert(const QImage& image, const QRect& rect) const
+{
+    QImage source = image;
+    if((source.format() != QImage::Format_ARGB32) &&
+       (source.format() != QImage::Format_RGB32))
+    {
+        source = source.convertToFormat(QImage::Format_ARGB32);
+    }
+
+    QVector<QRgb> pixels(rowCount * columnCount, QRgb(QLedMatrix::NoColor));
+    const int rows = qMin(rowCount, rect.height());
+    const int columns = qMin(columnCount, rect.width());
+    for(int row=0; row < rows; ++row)
+    {
+        const QRgb* line = reinterpret_cast<const QRgb*>(source.constScanLine(rect.y() + row));
+        memcpy(pixels.data() + row * columnCount, line + rect.x(), columns * sizeof(QRgb));
+    }
+    return pixels;
+}
+
+/**
+ * \internal
+ * Adds a frame at the end of the animation. A keyframe is stored when the
+ * changes stored since the previous one reach the size of a frame, so that
+ * seeking never applies more changes than there are LEDs.
+ */
+void QLedMatrixAnimationPrivate::append(const QVector<QRgb>& pixels, int delay)
+{
+    Delta delta;
+    if(!delays.isEmpty())
+    {
+        encode(lastFrame, pixels, delta);
+    }
+
+    changesSinceKeyframe += delta.colors.size();
+    if(delays.isEmpty() || (changesSinceKeyframe >= pixels.size()))
+    {
+        Keyframe keyframe;
+        keyframe.frame = delays.size();
+        keyframe.pixels = pixels;
+        keyframes.append(keyframe);
+        changesSinceKeyframe = 0;
+    }
+
+    deltas.append(delta);
+    delays.append(qMax(MinFrameDelay, delay));
+    lastFrame = pixels;
+    loopDeltaValid = false;
+}
+
+/**
+ * \internal
+ * Stores the LEDs that differ between two frames as rectangles. The changes
+ * of each row are grouped in spans, and spans at the same columns on
+ * consecutive rows are merged.
+ */
+void QLedMatrixAnimationPrivate::encode(const QVector<QRgb>& from, const QVector<QRgb>& to,
+                                        Delta& delta) const
+{
+    QVector<int> above; // rectangles ending on the previous row
+    QVector<int> below;
+    for(int row=0; row < rowCount; ++row)
+    {
+        const QRgb* a = from.constData() + row * columnCount;
+        const QRgb* b = to.constData() + row * columnCount;
+        below.clear();
+
+        int col = 0;
+        while(col < columnCount)
+        {
+            if(a[col] == b[col])
+            {
+                ++col;
+                continue;
+            }
+
+            // Extend the span over short runs of unchanged LEDs
+            const int first = col;
+            int last = col;
+            for(++col; (col < columnCount) && (col - last <= MaxRectGap); ++col)
+            {
+                if(a[col] != b[col])
+                {
+                    last = col;
+                }
+            }
+            col = last + 1;
+
+            int index = -1;
+            for(int i=0; i < above.size(); ++i)
+            {
+                const QRect& rect = delta.rects.at(above.at(i));
+                if((rect.left() == first) && (rect.right() == last))
+                {
+                    index = above.at(i);
+                    break;
+                }
+            }
+
+            if(index >= 0)
+            {
+                delta.rects[index].setBottom(row);
+            }
+            else
+            {
+                index = delta.rects.size();
+                delta.rects.append(QRect(first, row, last - first + 1, 1));
+            }
+            below.append(index);
+        }
+        above = below;
+    }
+
+    int size = 0;
+    for(int i=0; i < delta.rects.size(); ++i)
+    {
+        size += delta.rects.at(i).width() * delta.rects.at(i).height();
+    }
+
+    delta.colors.resize(size);
+    QRgb* colors = delta.colors.data();
+    for(int i=0; i < delta.rects.size(); ++i)
+    {
+        const QRect& rect = delta.rects.at(i);
+        for(int row=rect.top(); row <= rect.bottom(); ++row)
+        {
+            memcpy(colors, to.constData() + row * columnCount + rect.x(),
+                   rect.width() * sizeof(QRgb));
+            colors += rect.width();
+        }
+    }
+}
+
+/**
+ * \internal
+ * Applies changes to the current frame, and adds the changed rectangles to
+ * \a dirty if it is not 0.
+ */
+void QLedMatrixAnimationPrivate::apply(const Delta& delta, QVector<QRect>* dirty)
+{
+    QRgb* pixels = current.data();
+    const QRgb* colors = delta.colors.constData();
+    for(int i=0; i < delta.rects.size(); ++i)
+    {
+        const QRect& rect = delta.rects.at(i);
+        for(int row=rect.top(); row <= rect.bottom(); ++row)
+        {
+            memcpy(pixels + row * columnCount + rect.x(), colors,
+                   rect.width() * sizeof(QRgb));
+            colors += rect.width();
+        }
+        if(dirty != 0)
+        {
+            dirty->append(rect);
+        }
+    }
+}
+
+/**
+ * \internal
+ * Returns the changes leading to a frame from the previous one. The first
+ * frame follows the last one when the animation loops.
+ */
+const QLedMatrixAnimationPrivate::Delta& QLedMatrixAnimationPrivate::delta(int frame)
+{
+    if(frame > 0)
+    {
+        return deltas.at(frame);
+    }
+
+    if(!loopDeltaValid)
+    {
+        loopDelta = Delta();
+        encode(lastFrame, keyframes.first().pixels, loopDelta);
+        loopDeltaValid = true;
+    }
+    return loopDelta;
+}
+
+/**
+ * \internal
+ * Returns the index of the last keyframe at or before the given frame.
+ */
+int QLedMatrixAnimationPrivate::keyframe(int frame) const
+{
+    int index = 0;
+    for(int i=1; (i < keyframes.size()) && (keyframes.at(i).frame <= frame); ++i)
+    {
+        index = i;
+    }
+    return index;
+}
+
+/**
+ * \internal
+ * Makes \a frame the current frame and updates the matrix. The changes of
+ * the frames in between are applied in order and only the changed
+ * rectangles are repainted, unless starting from a keyframe costs less.
+ */
+void QLedMatrixAnimationPrivate::moveTo(int frame)
+{
+    if(frame == currentFrame)
+    {
+        return;
+    }
+
+    const int count = delays.size();
+    const Keyframe& key = keyframes.at(keyframe(frame));
+
+    // Cost of both ways, in LEDs
+    int seekCost = current.size();
+    for(int i=key.frame + 1; i <= frame; ++i)
+    {
+        seekCost += deltas.at(i).colors.size();
+    }
+
+    int stepCost = INT_MAX;
+    if(currentFrame >= 0)
+    {
+        stepCost = 0;
+        for(int i=currentFrame; (i != frame) && (stepCost < seekCost); )
+        {
+            i = (i + 1) % count;
+            stepCost += (i == 0) ? delta(0).colors.size() : deltas.at(i).colors.size();
+        }
+    }
+
+    if(stepCost < seekCost)
+    {
+        QVector<QRect> dirty;
+        for(int i=currentFrame; i != frame; )
+        {
+            i = (i + 1) % count;
+            apply(delta(i), &dirty);
+        }
+        currentFrame = frame;
+        present(dirty);
+    }
+    else
+    {
+        current = key.pixels;
+        for(int i=key.frame + 1; i <= frame; ++i)
+        {
+            apply(deltas.at(i), 0);
+        }
+        currentFrame = frame;
+        presentAll();
+    }
+}
+
+/**
+ * \internal
+ * Copies the changed rectangles of the current frame to the matrix.
+ */
+void QLedMatrixAnimationPrivate::present(const QVector<QRect>& dirty)
+{
+    if(!matrix)
+    {
+        return;
+    }
+
+    int area = 0;
+    for(int i=0; i < dirty.size(); ++i)
+    {
+        area += dirty.at(i).width() * dirty.at(i).height();
+    }
+    if(area >= current.size())
+    {
+        presentAll();
+        return;
+    }
+
+    for(int i=0; i < dirty.size(); ++i)
+    {
+        const QRect& rect = dirty.at(i);
+        matrix->setPixels(rect, current.constData() + rect.y() * columnCount + rect.x(),
+                          columnCount);
+    }
+}
+
+/**
+ * \internal
+ * Copies the whole current frame to the matrix.
+ */
+void QLedMatrixAnimationPrivate::presentAll()
+{
+    if(matrix && (currentFrame >= 0))
+    {
+        matrix->setPixels(QRect(0, 0, columnCount, rowCount), current.constData(),
+                          columnCount);
+    }
+}
+
+//////////////////////////////////
+
+/**
+ * \class QLedMatrixAnimation
+ *
+ * \brief The QLedMatrixAnimation class plays a sequence of frames on a
+ * QLedMatrix.
+ *
+ * The frames are loaded from a sprite sheet, a directory of images or a
+ * QMovie (for instance an animated GIF), and converted once to QRgb colors.
+ * Only the first frame is stored whole; each of the next ones is stored as
+ * the rectangles of LEDs that changed since the previous frame. Complete
+ * keyframes are added when the changes stored since the previous keyframe
+ * reach the size of a frame, which bounds the cost of seeking. The memory
+ * used grows with the number of LEDs that change, not with the number of
+ * frames.
+ *
+ * While playing, only the changed rectangles are copied to the matrix (see
+ * QLedMatrix::setPixels()), so only they are repainted. When the event loop
+ * is late, the frames whose time is over are skipped: their changes are
+ * merged and shown at once, to stay in sync with the wall clock.
+ *
+ * \code
+ * QLedMatrixAnimation* animation = new QLedMatrixAnimation(this);
+ * animation->loadMovie(QString::fromLatin1(":/fire.gif"));
+ * animation->setMatrix(matrix);
+ * animation->start();
+ * \endcode
+ *
+ * \sa QLedMatrix::setPixels()
+ */
+
+/**
+ * \fn void QLedMatrixAnimation::frameChanged(int frame)
+ *
+ * This signal is emitted when \a frame is shown. Skipped frames are not
+ * signaled.
+ */
+
+/**
+ * \fn void QLedMatrixAnimation::finished()
+ *
+ * This signal is emitted when an animation that does not loop has shown its
+ * last frame for its whole delay.
+ */
+
+/**
+ * Constructs an empty animation, which loops.
+ *
+ * \param parent parent QObject
+ */
+QLedMatrixAnimation::QLedMatrixAnimation(QObject* parent):
+    QObject(parent),
+    d_ptr(new QLedMatrixAnimationPrivate)
+{
+    Q_D(QLedMatrixAnimation);
+    d->rowCount = 0;
+    d->columnCount = 0;
+    d->loopDeltaValid = false;
+    d->changesSinceKeyframe = 0;
+    d->currentFrame = -1;
+    d->frameStart = 0;
+    d->looping = true;
+    d->running = false;
+
+    d->timer = new QTimer(this);
+    d->timer->setSingleShot(true);
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+    d->timer->setTimerType(Qt::PreciseTimer);
+#endif
+    connect(d->timer, SIGNAL(timeout()), this, SLOT(advance()));
+}
+
+/**
+ * Destroys the animation. The matrix keeps the frame shown.
+ */
+QLedMatrixAnimation::~QLedMatrixAnimation()
+{
+    delete d_ptr;
+}
+
+/**
+ * \brief Loads the frames of a sprite sheet.
+ *
+ * The sheet is cut in frames of \a frameSize pixels, from left to right and
+ * from top to bottom. The previous frames are removed.
+ *
+ * \param sheet the sprite sheet
+ * \param frameSize the size of each frame, which is the size of the
+ *        animation in LEDs
+ * \param frameDelay the time each frame is shown, in milliseconds
+ * \param frameCount the number of frames, or -1 for all the frames of the
+ *        sheet
+ *
+ * \return true if at least one frame was loaded
+ */
+bool QLedMatrixAnimation::loadSpriteSheet(const QImage& sheet, const QSize& frameSize,
+                                          int frameDelay, int frameCount)
+{
+    Q_D(QLedMatrixAnimation);
+    if(sheet.isNull() || frameSize.isEmpty())
+    {
+        qWarning("QLedMatrixAnimation::loadSpriteSheet: null sheet or frame size");
+        return false;
+    }
+
+    const int columns = sheet.width() / frameSize.width();
+    int count = columns * (sheet.height() / frameSize.height());
+    if(frameCount >= 0)
+    {
+        count = qMin(count, frameCount);
+    }
+    if(count == 0)
+    {
+        qWarning("QLedMatrixAnimation::loadSpriteSheet: the sheet is smaller than a frame");
+        return false;
+    }
+
+    clear();
+    d->rowCount = frameSize.height();
+    d->columnCount = frameSize.width();
+
+    const QImage source = sheet.convertToFormat(QImage::Format_ARGB32);
+    for(int i=0; i < count; ++i)
+    {
+        const QPoint origin((i % columns) * frameSize.width(), (i / columns) * frameSize.height());
+        d->append(d->convert(source, QRect(origin, frameSize)), frameDelay);
+    }
+    return true;
+}
+
+/**
+ * \brief Loads the frames from the images of a directory.
+ *
+ * The images are loaded in the order of their names, the files that are
+ * not images are ignored. The size of the animation is the size of the
+ * first image. The previous frames are removed.
+ *
+ * \param path the directory
+ * \param frameDelay the time each frame is shown, in milliseconds
+ *
+ * \return true if at least one frame was loaded
+ */
+bool QLedMatrixAnimation::loadDirectory(const QString& path, int frameDelay)
+{
+    Q_D(QLedMatrixAnimation);
+    const QDir dir(path);
+    const QStringList files = dir.entryList(QDir::Files, QDir::Name);
+
+    clear();
+    for(int i=0; i < files.size(); ++i)
+    {
+        const QImage image(dir.filePath(files.at(i)));
+        if(!image.isNull())
+        {
+            addFrame(image, frameDelay);
+        }
+    }
+
+    if(d->delays.isEmpty())
+    {
+        qWarning("QLedMatrixAnimation::loadDirectory: no image found");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \brief Loads the frames of a movie file, such as an animated GIF.
+ *
+ * \param fileName the file to load with QMovie
+ *
+ * \return true if at least one frame was loaded
+ *
+ * \sa loadMovie(QMovie*)
+ */
+bool QLedMatrixAnimation::loadMovie(const QString& fileName)
+{
+    QMovie movie(fileName);
+    return loadMovie(&movie);
+}
+
+/**
+ * \brief Loads the frames of a movie.
+ *
+ * All the frames are decoded once, with the delay of each frame. The size of
+ * the animation is the size of the first frame. The previous frames are
+ * removed. The movie is left on its last frame.
+ *
+ * \param movie the movie, which must not be running
+ *
+ * \return true if at least one frame was loaded
+ */
+bool QLedMatrixAnimation::loadMovie(QMovie* movie)
+{
+    Q_D(QLedMatrixAnimation);
+    if((movie == 0) || !movie->isValid() || !movie->jumpToFrame(0))
+    {
+        qWarning("QLedMatrixAnimation::loadMovie: invalid movie");
+        return false;
+    }
+
+    clear();
+    const int count = movie->frameCount(); // 0 if unknown
+    for(int i=0; ; ++i)
+    {
+        addFrame(movie->currentImage(), movie->nextFrameDelay());
+        if((count > 0) && (i + 1 >= count))
+        {
+            break;
+        }
+        // Stop when the movie loops back to its first frame
+        if(!movie->jumpToNextFrame() || (movie->currentFrameNumber() <= i))
+        {
+            break;
+        }
+    }
+    return !d->delays.isEmpty();
+}
+
+/**
+ * \brief Adds a frame at the end of the animation.
+ *
+ * The first frame sets the size of the animation; the next images are
+ * cropped, or padded with QLedMatrix::NoColor, to this size.
+ *
+ * \param image the frame
+ * \param delay the time the frame is shown, in milliseconds (at least 10)
+ */
+void QLedMatrixAnimation::addFrame(const QImage& image, int delay)
+{
+    Q_D(QLedMatrixAnimation);
+    if(image.isNull())
+    {
+        qWarning("QLedMatrixAnimation::addFrame: null image");
+        return;
+    }
+
+    if(d->delays.isEmpty())
+    {
+        d->rowCount = image.height();
+        d->columnCount = image.width();
+    }
+    d->append(d->convert(image, image.rect()), delay);
+}
+
+/**
+ * \brief Stops the animation and removes all the frames.
+ */
+void QLedMatrixAnimation::clear()
+{
+    Q_D(QLedMatrixAnimation);
+    stop();
+    d->rowCount = 0;
+    d->columnCount = 0;
+    d->delays.clear();
+    d->deltas.clear();
+    d->keyframes.clear();
+    d->loopDelta = QLedMatrixAnimationPrivate::Delta();
+    d->loopDeltaValid = false;
+    d->lastFrame.clear();
+    d->changesSinceKeyframe = 0;
+    d->current.clear();
+    d->currentFrame = -1;
+}
+
+/**
+ * \brief Returns the number of frames.
+ *
+ * \return the number of frames
+ */
+int QLedMatrixAnimation::frameCount() const
+{
+    Q_D(const QLedMatrixAnimation);
+    return d->delays.size();
+}
+
+/**
+ * \brief Returns the time a frame is shown.
+ *
+ * \param frame the index of the frame
+ *
+ * \return the delay of the frame in milliseconds, or 0 if there is no such
+ *         frame
+ */
+int QLedMatrixAnimation::frameDelay(int frame) const
+{
+    Q_D(const QLedMatrixAnimation);
+    return d->delays.value(frame);
+}
+
+/**
+ * \brief Returns the time it takes to show all the frames once.
+ *
+ * \return the duration of the animation in milliseconds
+ */
+int QLedMatrixAnimation::duration() const
+{
+    Q_D(const QLedMatrixAnimation);
+    int duration = 0;
+    for(int i=0; i < d->delays.size(); ++i)
+    {
+        duration += d->delays.at(i);
+    }
+    return duration;
+}
+
+/**
+ * \brief Returns the number of rows of the frames.
+ *
+ * \return the height of the animation in LEDs
+ */
+int QLedMatrixAnimation::rowCount() const
+{
+    Q_D(const QLedMatrixAnimation);
+    return d->rowCount;
+}
+
+/**
+ * \brief Returns the number of columns of the frames.
+ *
+ * \return the width of the animation in LEDs
+ */
+int QLedMatrixAnimation::columnCount() const
+{
+    Q_D(const QLedMatrixAnimation);
+    return d->columnCount;
+}
+
+/**
+ * \brief Returns the matrix showing the animation.
+ *
+ * \return the matrix, or 0 if there is none
+ *
+ * \sa setMatrix()
+ */
+QLedMatrix* QLedMatrixAnimation::matrix() const
+{
+    Q_D(const QLedMatrixAnimation);
+    return d->matrix;
+}
+
+/**
+ * \brief Sets the matrix showing the animation.
+ *
+ * The current frame, if any, is copied to the new matrix. The frames are
+ * drawn from the top left LED and cropped to the matrix.
+ *
+ * \param matrix the matrix, or 0
+ */
+void QLedMatrixAnimation::setMatrix(QLedMatrix* matrix)
+{
+    Q_D(QLedMatrixAnimation);
+    d->matrix = matrix;
+    d->presentAll();
+}
+
+/**
+ * \brief Returns true if the animation starts again after its last frame.
+ *
+ * \return true if the animation loops
+ *
+ * \sa setLooping()
+ */
+bool QLedMatrixAnimation::isLooping() const
+{
+    Q_D(const QLedMatrixAnimation);
+    return d->looping;
+}
+
+/**
+ * \brief Sets whether the animation starts again after its last frame.
+ *
+ * \param looping true to loop (the default), false to stop on the last
+ *        frame and emit finished()
+ */
+void QLedMatrixAnimation::setLooping(bool looping)
+{
+    Q_D(QLedMatrixAnimation);
+    d->looping = looping;
+}
+
+/**
+ * \brief Returns true while the animation is playing.
+ *
+ * \return true if the animation is playing
+ */
+bool QLedMatrixAnimation::isRunning() const
+{
+    Q_D(const QLedMatrixAnimation);
+    return d->running;
+}
+
+/**
+ * \brief Returns the frame shown.
+ *
+ * \return the index of the current frame, or -1 if no frame was shown yet
+ */
+int QLedMatrixAnimation::currentFrame() const
+{
+    Q_D(const QLedMatrixAnimation);
+    return d->currentFrame;
+}
+
+/**
+ * \brief Plays the animation from its first frame.
+ *
+ * The first frame is copied whole to the matrix.
+ *
+ * \sa stop(), setCurrentFrame()
+ */
+void QLedMatrixAnimation::start()
+{
+    Q_D(QLedMatrixAnimation);
+    if(d->delays.isEmpty())
+    {
+        qWarning("QLedMatrixAnimation::start: no frames");
+        return;
+    }
+
+    d->currentFrame = -1;
+    d->moveTo(0);
+    d->running = true;
+    d->clock.start();
+    d->frameStart = 0;
+    d->timer->start(d->delays.first());
+    Q_EMIT frameChanged(0);
+}
+
+/**
+ * \brief Stops the animation. The matrix keeps the frame shown.
+ *
+ * \sa start()
+ */
+void QLedMatrixAnimation::stop()
+{
+    Q_D(QLedMatrixAnimation);
+    d->running = false;
+    d->timer->stop();
+}
+
+/**
+ * \brief Shows the given frame.
+ *
+ * A running animation continues from this frame.
+ *
+ * \param frame the index of the frame
+ */
+void QLedMatrixAnimation::setCurrentFrame(int frame)
+{
+    Q_D(QLedMatrixAnimation);
+    if((frame < 0) || (frame >= d->delays.size()))
+    {
+        qWarning("QLedMatrixAnimation::setCurrentFrame: frame %d out of range", frame);
+        return;
+    }
+
+    d->moveTo(frame);
+    if(d->running)
+    {
+        d->frameStart = d->clock.elapsed();
+        d->timer->start(d->delays.at(frame));
+    }
+    Q_EMIT frameChanged(frame);
+}
+
+/**
+ * \internal
+ * Shows the frame due at the current time, skipping the ones whose time is
+ * over, and schedules the next step.
+ */
+void QLedMatrixAnimation::advance()
+{
+    Q_D(QLedMatrixAnimation);
+    if(!d->running)
+    {
+        return;
+    }
+
+    const qint64 now = d->clock.elapsed();
+    const int count = d->delays.size();
+    int frame = d->currentFrame;
+    qint64 start = d->frameStart;
+
+    // Drop whole loops after a long stall
+    const int loop = duration();
+    if(d->looping && (now - start > loop))
+    {
+        start += ((now - start) / loop) * loop;
+    }
+
+    bool ended = false;
+    while(now >= start + d->delays.at(frame))
+    {
+        if(!d->looping && (frame == count - 1))
+        {
+            ended = true;
+            break;
+        }
+        start += d->delays.at(frame);
+        frame = (frame + 1) % count;
+    }
+    d->frameStart = start;
+
+    if(frame != d->currentFrame)
+    {
+        d->moveTo(frame);
+        Q_EMIT frameChanged(frame);
+    }
+
+    if(ended)
+    {
+        d->running = false;
+        Q_EMIT finished();
+        return;
+    }
+    d->timer->start(int(start + d->delays.at(frame) - now));
+}
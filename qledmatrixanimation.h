@@ -0,0 +1,81 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef QLEDMATRIXANIMATION_H
+#define QLEDMATRIXANIMATION_H
+
+#include "qledmatrix.h"
+
+class QMovie;
+class QLedMatrixAnimationPrivate;
+class QDESIGNER_WIDGET_EXPORT QLedMatrixAnimation: public QObject
+{
+    Q_OBJECT
+
+    public:
+        QLedMatrixAnimation(QObject* parent = 0);
+        virtual ~QLedMatrixAnimation();
+
+        bool loadSpriteSheet(const QImage& sheet, const QSize& frameSize,
+                             int frameDelay, int frameCount = -1);
+        bool loadDirectory(const QString& path, int frameDelay);
+        bool loadMovie(const QString& fileName);
+        bool loadMovie(QMovie* movie);
+
+        void addFrame(const QImage& image, int delay);
+        void clear();
+
+        int frameCount() const;
+        int frameDelay(int frame) const;
+        int duration() const;
+
+        int rowCount() const;
+        int columnCount() const;
+
+        QLedMatrix* matrix() const;
+        void setMatrix(QLedMatrix* matrix);
+
+        bool isLooping() const;
+        void setLooping(bool looping);
+
+        bool isRunning() const;
+        int currentFrame() const;
+
+    public Q_SLOTS:
+        void start();
+        void stop();
+        void setCurrentFrame(int frame);
+
+    Q_SIGNALS:
+        void frameChanged(int frame);
+        void finished();
+
+    protected:
+        QLedMatrixAnimationPrivate* const d_ptr;
+
+    private Q_SLOTS:
+        void advance();
+
+    private:
+        Q_DISABLE_COPY(QLedMatrixAnimation)
+        Q_DECLARE_PRIVATE(QLedMatrixAnimation)
+};
+
+#endif // QLEDMATRIXANIMATION_H
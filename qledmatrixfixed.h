@@ -0,0 +1,290 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+#ifndef QLEDMATRIXFIXED_H
+#define QLEDMATRIXFIXED_H
+
+#include "qledmatrix.h"
+
+#include <string.h>
+
+/**
+ * \internal
+ * Type of the values stored by QLedMatrixFixed for a storage format.
+ */
+template <QLedMatrix::StorageFormat Format>
+struct QLedMatrixFixedValue
+{
+    typedef QRgb Type;
+};
+
+template <>
+struct QLedMatrixFixedValue<QLedMatrix::IndexedStorage>
+{
+    typedef uchar Type;
+};
+
+template <>
+struct QLedMatrixFixedValue<QLedMatrix::MonochromeStorage>
+{
+    typedef quint32 Type;
+};
+
+/**
+ * \class QLedMatrixFixed
+ *
+ * \brief The QLedMatrixFixed class is a LED matrix display whose size is
+ * known at compile time.
+ *
+ * Displays with a fixed hardware size (8x8, 16x32, 64x32, ...) can be
+ * declared with their size and storage format as template arguments. The
+ * LEDs are stored inline, in the layout of \a Format (see
+ * QLedMatrix::setFixedStorage()), and this storage is the only frame of the
+ * display: no frame buffer is allocated, and the widget draws the LEDs
+ * straight from it. The functions of QLedMatrix (setColorAt(), setFrame(),
+ * transitionTo(), ...) work as usual and write to the same storage.
+ *
+ * The LEDs can also be written with pixel(), setPixel(), frameLine() and
+ * fill(), whose positions are not checked (except by assertions in debug
+ * builds) and whose loops have a constant trip count. The changes are shown
+ * by present(), which repaints the display once.
+ *
+ * \code
+ * QLedMatrixFixed<8, 8> matrix;
+ * for(int i=0; i < 8; ++i)
+ * {
+ *     matrix.setPixel(i, i, QLedMatrix::Red);
+ * }
+ * matrix.present();
+ * \endcode
+ *
+ * The size and the storage format of the display can not be changed.
+ *
+ * \tparam Rows the number of rows of the display
+ * \tparam Columns the number of columns of the display
+ * \tparam Format the storage format of the display (see
+ *         QLedMatrix::setStorageFormat())
+ */
+template <int Rows, int Columns, QLedMatrix::StorageFormat Format = QLedMatrix::RgbStorage>
+class QLedMatrixFixed: public QLedMatrix
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+    Q_STATIC_ASSERT((Rows > 0) && (Columns > 0));
+#endif
+
+    public:
+        // QRgb, palette index or 32 bits of a row, see setFixedStorage()
+        typedef typename QLedMatrixFixedValue<Format>::Type Value;
+
+        enum
+        {
+            RowCount = Rows,
+            ColumnCount = Columns,
+            Stride = (Format == QLedMatrix::MonochromeStorage) ? (Columns + 31) / 32 : Columns
+        };
+
+        /**
+         * Constructs a display of \a Rows by \a Columns LEDs, all of the
+         * dark LED color.
+         *
+         * \param parent parent widget
+         */
+        explicit QLedMatrixFixed(QWidget* parent = 0): QLedMatrix(parent)
+        {
+            // Palette index 0 and cleared bits are the dark LED color
+            if(Format == QLedMatrix::RgbStorage)
+            {
+                const QRgb dark = darkLedColor().rgb();
+                for(int i=0; i < Rows * Stride; ++i)
+                {
+                    leds[i] = Value(dark);
+                }
+            }
+            else
+            {
+                memset(leds, 0, sizeof(leds));
+            }
+            setFixedStorage(Format, leds, Rows, Columns);
+        }
+
+        /**
+         * \brief Returns the color of a LED.
+         *
+         * \param row the row of the LED, from 0 to \a Rows - 1
+         * \param col the column of the LED, from 0 to \a Columns - 1
+         *
+         * \return the color of the LED (in QRgb format)
+         */
+        inline QRgb pixel(int row, int col) const
+        {
+            Q_ASSERT((row >= 0) && (row < Rows) && (col >= 0) && (col < Columns));
+            switch(Format)
+            {
+                case QLedMatrix::IndexedStorage:
+                    return paletteColor(leds[row * Stride + col]);
+                case QLedMatrix::MonochromeStorage:
+                    return testBit(row, col) ? litLedColor().rgb() : darkLedColor().rgb();
+                default:
+                    return QRgb(leds[row * Stride + col]);
+            }
+        }
+
+        /**
+         * \brief Sets the color of a LED.
+         *
+         * In QLedMatrix::MonochromeStorage, any color other than the dark
+         * LED color turns the LED on.
+         *
+         * \param row the row of the LED, from 0 to \a Rows - 1
+         * \param col the column of the LED, from 0 to \a Columns - 1
+         * \param rgb the new color of the LED (in QRgb format)
+         *
+         * \sa present()
+         */
+        inline void setPixel(int row, int col, QRgb rgb)
+        {
+            Q_ASSERT((row >= 0) && (row < Rows) && (col >= 0) && (col < Columns));
+            switch(Format)
+            {
+                case QLedMatrix::IndexedStorage:
+                    leds[row * Stride + col] = Value(colorIndex(rgb));
+                    break;
+                case QLedMatrix::MonochromeStorage:
+                    setBit(row, col, rgb != darkLedColor().rgb());
+                    break;
+                default:
+                    leds[row * Stride + col] = Value(rgb);
+                    break;
+            }
+        }
+
+        /**
+         * \brief Returns a row of the storage.
+         *
+         * \param row the row, from 0 to \a Rows - 1
+         *
+         * \return the \a Stride values of the row, in the layout of
+         *         \a Format
+         *
+         * \sa present()
+         */
+        inline Value* frameLine(int row)
+        {
+            Q_ASSERT((row >= 0) && (row < Rows));
+            return leds + row * Stride;
+        }
+
+        /**
+         * \brief Returns a row of the storage.
+         *
+         * \param row the row, from 0 to \a Rows - 1
+         *
+         * \return the \a Stride values of the row, in the layout of
+         *         \a Format
+         */
+        inline const Value* constFrameLine(int row) const
+        {
+            Q_ASSERT((row >= 0) && (row < Rows));
+            return leds + row * Stride;
+        }
+
+        /**
+         * \brief Sets all the LEDs to the given color.
+         *
+         * \param rgb the color (in QRgb format)
+         *
+         * \sa present()
+         */
+        void fill(QRgb rgb)
+        {
+            Value value;
+            switch(Format)
+            {
+                case QLedMatrix::IndexedStorage:
+                    value = Value(colorIndex(rgb));
+                    break;
+                case QLedMatrix::MonochromeStorage:
+                    value = (rgb != darkLedColor().rgb()) ? Value(~0u) : Value(0);
+                    break;
+                default:
+                    value = Value(rgb);
+                    break;
+            }
+            for(int i=0; i < Rows * Stride; ++i)
+            {
+                leds[i] = value;
+            }
+
+            // The bits past the last column stay cleared
+            if((Format == QLedMatrix::MonochromeStorage) && (Columns % 32 != 0))
+            {
+                for(int row=0; row < Rows; ++row)
+                {
+                    leds[row * Stride + Stride - 1] &= Value(~0u << ((32 - Columns % 32) % 32));
+                }
+            }
+        }
+
+        /**
+         * \brief Shows the LEDs written with setPixel(), frameLine() or
+         * fill().
+         *
+         * The display is repainted once.
+         */
+        void present()
+        {
+            updateLeds(QRect(0, 0, Columns, Rows));
+        }
+
+        /**
+         * \brief Shows the given rows of LEDs written with setPixel(),
+         * frameLine() or fill().
+         *
+         * Only the rows \a first to \a last are repainted.
+         *
+         * \param first the first row
+         * \param last the last row
+         */
+        void present(int first, int last)
+        {
+            first = qMax(0, first);
+            last = qMin(Rows - 1, last);
+            if(first <= last)
+            {
+                updateLeds(QRect(0, first, Columns, last - first + 1));
+            }
+        }
+
+    private:
+        inline bool testBit(int row, int col) const
+        {
+            return (leds[row * Stride + (col >> 5)] >> (31 - (col & 31))) & 1;
+        }
+
+        inline void setBit(int row, int col, bool on)
+        {
+            const Value mask = Value(1u << (31 - (col & 31)));
+            Value& word = leds[row * Stride + (col >> 5)];
+            word = on ? Value(word | mask) : Value(word & ~mask);
+        }
+
+        Value leds[Rows * Stride];
+};
+
+#endif // QLEDMATRIXFIXED_H
@@ -0,0 +1,612 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include "qledmatrixfont.h"
+
+#include <qglobal.h>
+#include <qstring.h>
+
+#include <string.h>
+
+// Glyphs are stored for the Latin-1 characters
+static const int GlyphCount = 256;
+
+/**
+ * \internal
+ */
+class QLedMatrixFontData: public QSharedData
+{
+    public:
+        int glyphIndex(uint ch) const;
+
+        inline int glyphWidth(int index) const
+        { return offsets[index + 1] - offsets[index]; }
+
+        int height;
+        int spacing;
+        QVector<quint32> columns; // all the glyphs, bit 0 is the top row
+        int offsets[GlyphCount + 1]; // glyph ch is columns[offsets[ch]] to columns[offsets[ch + 1] - 1]
+};
+
+/**
+ * \internal
+ * Returns the glyph used to draw a character: the glyph of the character,
+ * the glyph of '?' if the font has none, or -1.
+ */
+int QLedMatrixFontData::glyphIndex(uint ch) const
+{
+    if((ch < uint(GlyphCount)) && (glyphWidth(ch) > 0))
+    {
+        return ch;
+    }
+    return (glyphWidth('?') > 0) ? '?' : -1;
+}
+
+/**
+ * \internal
+ * Columns of the built-in 5x7 font, 5 per glyph from ' ' to '~'.
+ */
+static const uchar font5x7Columns[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, // space
+    0x00, 0x00, 0x5F, 0x00, 0x00, // !
+    0x00, 0x07, 0x00, 0x07, 0x00, // "
+    0x14, 0x7F, 0x14, 0x7F, 0x14, // #
+    0x24, 0x2A, 0x7F, 0x2A, 0x12, // $
+    0x23, 0x13, 0x08, 0x64, 0x62, // %
+    0x36, 0x49, 0x55, 0x22, 0x50, // &
+    0x00, 0x04, 0x03, 0x00, 0x00, // '
+    0x00, 0x1C, 0x22, 0x41, 0x00, // (
+    0x00, 0x41, 0x22, 0x1C, 0x00, // )
+    0x14, 0x08, 0x3E, 0x08, 0x14, // *
+    0x08, 0x08, 0x3E, 0x08, 0x08, // +
+    0x00, 0x50, 0x30, 0x00, 0x00, // ,
+    0x08, 0x08, 0x08, 0x08, 0x08, // -
+    0x00, 0x60, 0x60, 0x00, 0x00, // .
+    0x20, 0x10, 0x08, 0x04, 0x02, // /
+    0x3E, 0x51, 0x49, 0x45, 0x3E, // 0
+    0x00, 0x42, 0x7F, 0x40, 0x00, // 1
+    0x42, 0x61, 0x51, 0x49, 0x46, // 2
+    0x21, 0x41, 0x45, 0x4B, 0x31, // 3
+    0x18, 0x14, 0x12, 0x7F, 0x10, // 4
+    0x27, 0x45, 0x45, 0x45, 0x39, // 5
+    0x3C, 0x4A, 0x49, 0x49, 0x30, // 6
+    0x01, 0x71, 0x09, 0x05, 0x03, // 7
+    0x36, 0x49, 0x49, 0x49, 0x36, // 8
+    0x06, 0x49, 0x49, 0x29, 0x1E, // 9
+    0x00, 0x36, 0x36, 0x00, 0x00, // :
+    0x00, 0x56, 0x36, 0x00, 0x00, // ;
+    0x08, 0x14, 0x22, 0x41, 0x00, // <
+    0x14, 0x14, 0x14, 0x14, 0x14, // =
+    0x00, 0x41, 0x22, 0x14, 0x08, // >
+    0x02, 0x01, 0x51, 0x09, 0x06, // ?
+    0x32, 0x49, 0x79, 0x41, 0x3E, // @
+    0x7E, 0x11, 0x11, 0x11, 0x7E, // A
+    0x7F, 0x49, 0x49, 0x49, 0x36, // B
+    0x3E, 0x41, 0x41, 0x41, 0x22, // C
+    0x7F, 0x41, 0x41, 0x22, 0x1C, // D
+    0x7F, 0x49, 0x49, 0x49, 0x41, // E
+    0x7F, 0x09, 0x09, 0x09, 0x01, // F
+    0x3E, 0x41, 0x49, 0x49, 0x7A, // G
+    0x7F, 0x08, 0x08, 0x08, 0x7F, // H
+    0x00, 0x41, 0x7F, 0x41, 0x00, // I
+    0x20, 0x40, 0x41, 0x3F, 0x01, // J
+    0x7F, 0x08, 0x14, 0x22, 0x41, // K
+    0x7F, 0x40, 0x40, 0x40, 0x40, // L
+    0x7F, 0x02, 0x0C, 0x02, 0x7F, // M
+    0x7F, 0x04, 0x08, 0x10, 0x7F, // N
+    0x3E, 0x41, 0x41, 0x41, 0x3E, // O
+    0x7F, 0x09, 0x09, 0x09, 0x06, // P
+    0x3E, 0x41, 0x51, 0x21, 0x5E, // Q
+    0x7F, 0x09, 0x19, 0x29, 0x46, // R
+    0x46, 0x49, 0x49, 0x49, 0x31, // S
+    0x01, 0x01, 0x7F, 0x01, 0x01, // T
+    0x3F, 0x40, 0x40, 0x40, 0x3F, // U
+    0x1F, 0x20, 0x40, 0x20, 0x1F, // V
+    0x3F, 0x40, 0x38, 0x40, 0x3F, // W
+    0x63, 0x14, 0x08, 0x14, 0x63, // X
+    0x07, 0x08, 0x70, 0x08, 0x07, // Y
+    0x61, 0x51, 0x49, 0x45, 0x43, // Z
+    0x00, 0x7F, 0x41, 0x41, 0x00, // [
+    0x02, 0x04, 0x08, 0x10, 0x20, // backslash
+    0x00, 0x41, 0x41, 0x7F, 0x00, // ]
+    0x04, 0x02, 0x01, 0x02, 0x04, // ^
+    0x40, 0x40, 0x40, 0x40, 0x40, // _
+    0x00, 0x01, 0x02, 0x04, 0x00, // `
+    0x20, 0x54, 0x54, 0x54, 0x78, // a
+    0x7F, 0x48, 0x44, 0x44, 0x38, // b
+    0x38, 0x44, 0x44, 0x44, 0x20, // c
+    0x38, 0x44, 0x44, 0x48, 0x7F, // d
+    0x38, 0x54, 0x54, 0x54, 0x18, // e
+    0x08, 0x7E, 0x09, 0x01, 0x02, // f
+    0x0C, 0x52, 0x52, 0x52, 0x3E, // g
+    0x7F, 0x08, 0x04, 0x04, 0x78, // h
+    0x00, 0x44, 0x7D, 0x40, 0x00, // i
+    0x20, 0x40, 0x44, 0x3D, 0x00, // j
+    0x7F, 0x10, 0x28, 0x44, 0x00, // k
+    0x00, 0x41, 0x7F, 0x40, 0x00, // l
+    0x7C, 0x04, 0x18, 0x04, 0x78, // m
+    0x7C, 0x08, 0x04, 0x04, 0x78, // n
+    0x38, 0x44, 0x44, 0x44, 0x38, // o
+    0x7C, 0x14, 0x14, 0x14, 0x08, // p
+    0x08, 0x14, 0x14, 0x18, 0x7C, // q
+    0x7C, 0x08, 0x04, 0x04, 0x08, // r
+    0x48, 0x54, 0x54, 0x54, 0x20, // s
+    0x04, 0x3F, 0x44, 0x40, 0x20, // t
+    0x3C, 0x40, 0x40, 0x20, 0x7C, // u
+    0x1C, 0x20, 0x40, 0x20, 0x1C, // v
+    0x3C, 0x40, 0x30, 0x40, 0x3C, // w
+    0x44, 0x28, 0x10, 0x28, 0x44, // x
+    0x0C, 0x50, 0x50, 0x50, 0x3C, // y
+    0x44, 0x64, 0x54, 0x4C, 0x44, // z
+    0x00, 0x08, 0x36, 0x41, 0x00, // {
+    0x00, 0x00, 0x7F, 0x00, 0x00, // |
+    0x00, 0x41, 0x36, 0x08, 0x00, // }
+    0x08, 0x04, 0x08, 0x10, 0x08, // ~
+};
+
+/**
+ * \internal
+ * Columns of the built-in 8x16 font, 7 per glyph from ' ' to '~'. The
+ * spacing makes up the eighth column.
+ */
+static const quint16 font8x16Columns[] = {
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, // space
+    0x0000, 0x0000, 0x0070, 0x1BF8, 0x0070, 0x0000, 0x0000, // !
+    0x0000, 0x0058, 0x0038, 0x0000, 0x0058, 0x0038, 0x0000, // "
+    0x0240, 0x0240, 0x0FF0, 0x0240, 0x0FF0, 0x0240, 0x0240, // #
+    0x0260, 0x06F0, 0x0490, 0x1FF8, 0x0490, 0x07B0, 0x0320, // $
+    0x0430, 0x0230, 0x0100, 0x0080, 0x0040, 0x0C20, 0x0C10, // %
+    0x0700, 0x08B0, 0x08C8, 0x08C8, 0x0530, 0x0600, 0x0980, // &
+    0x0000, 0x0000, 0x0058, 0x0038, 0x0000, 0x0000, 0x0000, // '
+    0x0000, 0x0000, 0x07E0, 0x0810, 0x1008, 0x0000, 0x0000, // (
+    0x0000, 0x0000, 0x1008, 0x0810, 0x07E0, 0x0000, 0x0000, // )
+    0x0080, 0x02A0, 0x01C0, 0x0080, 0x01C0, 0x02A0, 0x0080, // *
+    0x0080, 0x0080, 0x0080, 0x03E0, 0x0080, 0x0080, 0x0080, // +
+    0x0000, 0x0000, 0x2C00, 0x1C00, 0x0000, 0x0000, 0x0000, // ,
+    0x0080, 0x0080, 0x0080, 0x0080, 0x0080, 0x0080, 0x0080, // -
+    0x0000, 0x0000, 0x1800, 0x1800, 0x0000, 0x0000, 0x0000, // .
+    0x0400, 0x0200, 0x0100, 0x0080, 0x0040, 0x0020, 0x0010, // /
+    0x07E0, 0x0C10, 0x1208, 0x1108, 0x1088, 0x0850, 0x07E0, // 0
+    0x0000, 0x1020, 0x1010, 0x1FF8, 0x1000, 0x1000, 0x0000, // 1
+    0x1C10, 0x1208, 0x1108, 0x1108, 0x1088, 0x1088, 0x1070, // 2
+    0x0810, 0x1008, 0x1088, 0x1088, 0x1088, 0x1088, 0x0F70, // 3
+    0x0300, 0x0280, 0x0240, 0x0220, 0x0210, 0x1FF8, 0x0200, // 4
+    0x08F8, 0x1088, 0x1088, 0x1088, 0x1088, 0x1088, 0x0F08, // 5
+    0x0FE0, 0x1090, 0x1088, 0x1088, 0x1088, 0x1088, 0x0F00, // 6
+    0x0008, 0x0008, 0x0008, 0x1F08, 0x0088, 0x0048, 0x0038, // 7
+    0x0F70, 0x1088, 0x1088, 0x1088, 0x1088, 0x1088, 0x0F70, // 8
+    0x00F0, 0x1108, 0x1108, 0x1108, 0x1108, 0x0908, 0x07F0, // 9
+    0x0000, 0x0000, 0x0C60, 0x0C60, 0x0000, 0x0000, 0x0000, // :
+    0x0000, 0x0000, 0x2C60, 0x1C60, 0x0000, 0x0000, 0x0000, // ;
+    0x0000, 0x0100, 0x0280, 0x0440, 0x0820, 0x1010, 0x0000, // <
+    0x0240, 0x0240, 0x0240, 0x0240, 0x0240, 0x0240, 0x0240, // =
+    0x0000, 0x1010, 0x0820, 0x0440, 0x0280, 0x0100, 0x0000, // >
+    0x0030, 0x0008, 0x0008, 0x1B08, 0x0088, 0x0048, 0x0030, // ?
+    0x0FE0, 0x1010, 0x1190, 0x1250, 0x1250, 0x1250, 0x03E0, // @
+    0x1FC0, 0x0120, 0x0110, 0x0108, 0x0110, 0x0120, 0x1FC0, // A
+    0x1008, 0x1FF8, 0x1088, 0x1088, 0x1088, 0x1088, 0x0F70, // B
+    0x07E0, 0x0810, 0x1008, 0x1008, 0x1008, 0x1008, 0x0810, // C
+    0x1008, 0x1FF8, 0x1008, 0x1008, 0x1008, 0x0810, 0x07E0, // D
+    0x1008, 0x1FF8, 0x1088, 0x1088, 0x11C8, 0x1008, 0x1818, // E
+    0x1008, 0x1FF8, 0x1088, 0x1088, 0x01C8, 0x0008, 0x0018, // F
+    0x07E0, 0x0810, 0x1008, 0x1108, 0x1108, 0x0908, 0x1F10, // G
+    0x1FF8, 0x0080, 0x0080, 0x0080, 0x0080, 0x0080, 0x1FF8, // H
+    0x0000, 0x1008, 0x1008, 0x1FF8, 0x1008, 0x1008, 0x0000, // I
+    0x0C00, 0x1000, 0x1000, 0x1008, 0x1008, 0x0FF8, 0x0008, // J
+    0x1008, 0x1FF8, 0x0180, 0x0240, 0x0420, 0x0810, 0x1008, // K
+    0x1008, 0x1FF8, 0x1008, 0x1008, 0x1000, 0x1000, 0x1800, // L
+    0x1FF8, 0x0010, 0x0020, 0x0040, 0x0020, 0x0010, 0x1FF8, // M
+    0x1FF8, 0x0010, 0x0020, 0x0040, 0x0080, 0x0100, 0x1FF8, // N
+    0x07E0, 0x0810, 0x1008, 0x1008, 0x1008, 0x0810, 0x07E0, // O
+    0x1008, 0x1FF8, 0x1088, 0x1088, 0x0088, 0x0088, 0x0070, // P
+    0x07E0, 0x0810, 0x1008, 0x1008, 0x1408, 0x0810, 0x17E0, // Q
+    0x1008, 0x1FF8, 0x1088, 0x0088, 0x0188, 0x0688, 0x1870, // R
+    0x0870, 0x1088, 0x1088, 0x1088, 0x1088, 0x1088, 0x0F10, // S
+    0x0018, 0x0008, 0x1008, 0x1FF8, 0x1008, 0x0008, 0x0018, // T
+    0x0FF8, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x0FF8, // U
+    0x01F8, 0x0600, 0x0800, 0x1000, 0x0800, 0x0600, 0x01F8, // V
+    0x1FF8, 0x0800, 0x0400, 0x0300, 0x0400, 0x0800, 0x1FF8, // W
+    0x1818, 0x0420, 0x0240, 0x0180, 0x0240, 0x0420, 0x1818, // X
+    0x0038, 0x0040, 0x1080, 0x1F00, 0x1080, 0x0040, 0x0038, // Y
+    0x1C18, 0x1208, 0x1108, 0x1088, 0x1048, 0x1028, 0x1818, // Z
+    0x0000, 0x0000, 0x1FF8, 0x1008, 0x1008, 0x1008, 0x0000, // [
+    0x0010, 0x0020, 0x0040, 0x0080, 0x0100, 0x0200, 0x0400, // backslash
+    0x0000, 0x1008, 0x1008, 0x1008, 0x1FF8, 0x0000, 0x0000, // ]
+    0x0040, 0x0020, 0x0010, 0x0008, 0x0010, 0x0020, 0x0040, // ^
+    0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, 0x4000, // _
+    0x0000, 0x0000, 0x0018, 0x0038, 0x0040, 0x0000, 0x0000, // `
+    0x0C00, 0x1240, 0x1240, 0x1240, 0x1240, 0x0F80, 0x1000, // a
+    0x1008, 0x0FF8, 0x1040, 0x1040, 0x1040, 0x1080, 0x0F00, // b
+    0x0F80, 0x1040, 0x1040, 0x1040, 0x1040, 0x1040, 0x0880, // c
+    0x0F00, 0x1080, 0x1040, 0x1040, 0x1048, 0x0FF8, 0x1000, // d
+    0x0F80, 0x1240, 0x1240, 0x1240, 0x1240, 0x1240, 0x0B80, // e
+    0x0080, 0x1080, 0x1FF0, 0x1088, 0x0088, 0x0008, 0x0010, // f
+    0x4F80, 0x9040, 0x9040, 0x9040, 0x8880, 0x7FC0, 0x0040, // g
+    0x1008, 0x1FF8, 0x0080, 0x0040, 0x0040, 0x0080, 0x1F00, // h
+    0x0000, 0x0000, 0x1040, 0x1FD8, 0x1000, 0x0000, 0x0000, // i
+    0x0000, 0x6000, 0x8000, 0x8000, 0x8040, 0x7FD8, 0x0000, // j
+    0x1008, 0x1FF8, 0x0200, 0x0500, 0x0880, 0x1040, 0x0000, // k
+    0x0000, 0x0000, 0x1008, 0x1FF8, 0x1000, 0x0000, 0x0000, // l
+    0x1FC0, 0x0040, 0x0040, 0x1F80, 0x0040, 0x0040, 0x1F80, // m
+    0x0040, 0x1F80, 0x0040, 0x0040, 0x0040, 0x1F80, 0x0000, // n
+    0x0F80, 0x1040, 0x1040, 0x1040, 0x1040, 0x1040, 0x0F80, // o
+    0x8040, 0xFF80, 0x9040, 0x9040, 0x1040, 0x1040, 0x0F80, // p
+    0x0F80, 0x1040, 0x1040, 0x1040, 0x9040, 0xFF80, 0x8040, // q
+    0x1040, 0x1F80, 0x10C0, 0x0040, 0x0040, 0x0080, 0x0000, // r
+    0x0980, 0x1240, 0x1240, 0x1240, 0x1240, 0x1240, 0x0C80, // s
+    0x0040, 0x0040, 0x0FF0, 0x1058, 0x1040, 0x0800, 0x0000, // t
+    0x0FC0, 0x1000, 0x1000, 0x1000, 0x1000, 0x0FC0, 0x1000, // u
+    0x01C0, 0x0600, 0x0800, 0x1000, 0x0800, 0x0600, 0x01C0, // v
+    0x0FC0, 0x1000, 0x1000, 0x0F00, 0x1000, 0x1000, 0x0FC0, // w
+    0x1040, 0x0880, 0x0500, 0x0200, 0x0500, 0x0880, 0x1040, // x
+    0x4FC0, 0x9000, 0x9000, 0x9000, 0x9000, 0x8800, 0x7FC0, // y
+    0x10C0, 0x1840, 0x1440, 0x1240, 0x1140, 0x10C0, 0x1840, // z
+    0x0000, 0x0080, 0x0080, 0x0F70, 0x1008, 0x1008, 0x1008, // {
+    0x0000, 0x0000, 0x0000, 0x3FF8, 0x0000, 0x0000, 0x0000, // |
+    0x1008, 0x1008, 0x1008, 0x0F70, 0x0080, 0x0080, 0x0000, // }
+    0x0030, 0x0008, 0x0008, 0x0010, 0x0020, 0x0020, 0x0018, // ~
+};
+
+/**
+ * \internal
+ * Builds a monospaced font from a table of glyph columns.
+ */
+template <typename T>
+static QLedMatrixFont builtinFont(const T* data, int height, int width)
+{
+    QLedMatrixFont font(height);
+    QVector<quint32> columns(width);
+    for(uint ch=' '; ch <= '~'; ++ch)
+    {
+        for(int i=0; i < width; ++i)
+        {
+            columns[i] = *data++;
+        }
+        font.setGlyph(ch, columns);
+    }
+    return font;
+}
+
+Q_GLOBAL_STATIC_WITH_ARGS(QLedMatrixFont, builtinFont5x7, (builtinFont(font5x7Columns, 7, 5)))
+Q_GLOBAL_STATIC_WITH_ARGS(QLedMatrixFont, builtinFont8x16, (builtinFont(font8x16Columns, 16, 7)))
+
+//////////////////////////////////
+
+/**
+ * \class QLedMatrixFont
+ *
+ * \brief The QLedMatrixFont class is a bitmap font for LED matrix displays.
+ *
+ * Each glyph is a list of columns, from left to right. A column is a bit
+ * mask of the LEDs that are on, bit 0 being the top row, so fonts can be up
+ * to 32 LEDs high. Glyphs can have different widths; spacing() blank
+ * columns are inserted between them. Glyphs are defined for the Latin-1
+ * characters, the others are drawn with the glyph of '?'.
+ *
+ * Two fonts covering the printable ASCII characters are built in:
+ * font5x7() and font8x16().
+ *
+ * render() converts a string to a glyph run, the columns of the whole text,
+ * which QLedMatrix::drawText() and QLedMatrix::scrollText() copy to the
+ * display without looking up the glyphs again.
+ *
+ * QLedMatrixFont is implicitly shared, copying a font is cheap.
+ *
+ * \code
+ * QLedMatrixFont font(3);
+ * QVector<quint32> columns;
+ * columns << 0x7 << 0x5 << 0x7;
+ * font.setGlyph('0', columns);
+ * matrix->setLedFont(font);
+ * \endcode
+ *
+ * \sa QLedMatrix::setLedFont()
+ */
+
+/**
+ * Constructs a null font, without glyphs.
+ *
+ * \sa isNull()
+ */
+QLedMatrixFont::QLedMatrixFont():
+    d(new QLedMatrixFontData)
+{
+    d->height = 0;
+    d->spacing = 0;
+    for(int i=0; i <= GlyphCount; ++i)
+    {
+        d->offsets[i] = 0;
+    }
+}
+
+/**
+ * Constructs a font without glyphs.
+ *
+ * \param height the number of rows of the glyphs, from 1 to 32
+ * \param spacing the number of blank columns between glyphs
+ *
+ * \sa setGlyph()
+ */
+QLedMatrixFont::QLedMatrixFont(int height, int spacing):
+    d(new QLedMatrixFontData)
+{
+    if((height < 1) || (height > 32))
+    {
+        qWarning("QLedMatrixFont: invalid height %d", height);
+        height = 0;
+    }
+
+    d->height = height;
+    d->spacing = qMax(0, spacing);
+    for(int i=0; i <= GlyphCount; ++i)
+    {
+        d->offsets[i] = 0;
+    }
+}
+
+/**
+ * Constructs a copy of \a other.
+ */
+QLedMatrixFont::QLedMatrixFont(const QLedMatrixFont& other):
+    d(other.d)
+{
+}
+
+/**
+ * Destroys the font.
+ */
+QLedMatrixFont::~QLedMatrixFont()
+{
+}
+
+/**
+ * Assigns \a other to this font.
+ */
+QLedMatrixFont& QLedMatrixFont::operator=(const QLedMatrixFont& other)
+{
+    d = other.d;
+    return *this;
+}
+
+/**
+ * \brief Returns the built-in 5x7 font.
+ *
+ * Glyphs are 5 columns wide and 7 rows high, with a blank column between
+ * them. This is the default font of QLedMatrix.
+ *
+ * \return the built-in 5x7 font
+ */
+QLedMatrixFont QLedMatrixFont::font5x7()
+{
+    return *builtinFont5x7();
+}
+
+/**
+ * \brief Returns the built-in 8x16 font.
+ *
+ * Glyphs are 7 columns wide and 16 rows high (3 rows above the capitals and
+ * 3 rows of descenders), with a blank column between them.
+ *
+ * \return the built-in 8x16 font
+ */
+QLedMatrixFont QLedMatrixFont::font8x16()
+{
+    return *builtinFont8x16();
+}
+
+/**
+ * \brief Returns true if the font has no height.
+ *
+ * \return true if the font is null
+ */
+bool QLedMatrixFont::isNull() const
+{
+    return d->height == 0;
+}
+
+/**
+ * \brief Returns the number of rows of the glyphs.
+ *
+ * \return the height of the font
+ */
+int QLedMatrixFont::height() const
+{
+    return d->height;
+}
+
+/**
+ * \brief Returns the number of blank columns between glyphs.
+ *
+ * \return the spacing of the font
+ *
+ * \sa setSpacing()
+ */
+int QLedMatrixFont::spacing() const
+{
+    return d->spacing;
+}
+
+/**
+ * \brief Sets the number of blank columns between glyphs.
+ *
+ * \param spacing the new spacing, 0 or more
+ *
+ * \sa spacing()
+ */
+void QLedMatrixFont::setSpacing(int spacing)
+{
+    d->spacing = qMax(0, spacing);
+}
+
+/**
+ * \brief Returns true if the font has a glyph for the given character.
+ *
+ * \param ch a Latin-1 character
+ *
+ * \return true if the character has a glyph
+ */
+bool QLedMatrixFont::hasGlyph(uint ch) const
+{
+    return (ch < uint(GlyphCount)) && (d->glyphWidth(ch) > 0);
+}
+
+/**
+ * \brief Returns the number of columns of a glyph.
+ *
+ * \param ch a Latin-1 character
+ *
+ * \return the width of the glyph, or 0 if the character has none
+ */
+int QLedMatrixFont::glyphWidth(uint ch) const
+{
+    return hasGlyph(ch) ? d->glyphWidth(ch) : 0;
+}
+
+/**
+ * \brief Returns the columns of a glyph.
+ *
+ * \param ch a Latin-1 character
+ *
+ * \return the columns of the glyph, empty if the character has none
+ *
+ * \sa setGlyph()
+ */
+QVector<quint32> QLedMatrixFont::glyph(uint ch) const
+{
+    QVector<quint32> columns;
+    if(hasGlyph(ch))
+    {
+        const int width = d->glyphWidth(ch);
+        columns.resize(width);
+        memcpy(columns.data(), d->columns.constData() + d->offsets[ch],
+               width * sizeof(quint32));
+    }
+    return columns;
+}
+
+/**
+ * \brief Sets the columns of a glyph.
+ *
+ * The bits past height() are ignored. An empty list of columns removes the
+ * glyph.
+ *
+ * \param ch a Latin-1 character
+ * \param columns the columns of the glyph, from left to right
+ *
+ * \sa glyph()
+ */
+void QLedMatrixFont::setGlyph(uint ch, const QVector<quint32>& columns)
+{
+    if(ch >= uint(GlyphCount))
+    {
+        qWarning("QLedMatrixFont::setGlyph: character %u is not a Latin-1 character", ch);
+        return;
+    }
+    if(isNull())
+    {
+        qWarning("QLedMatrixFont::setGlyph: the font is null");
+        return;
+    }
+
+    const quint32 mask = (d->height == 32) ? ~quint32(0) : ((quint32(1) << d->height) - 1);
+    const int offset = d->offsets[ch];
+    const int delta = columns.size() - d->glyphWidth(ch);
+    if(delta > 0)
+    {
+        d->columns.insert(offset, delta, 0);
+    }
+    else if(delta < 0)
+    {
+        d->columns.remove(offset, -delta);
+    }
+
+    quint32* dst = d->columns.data() + offset;
+    for(int i=0; i < columns.size(); ++i)
+    {
+        dst[i] = columns.at(i) & mask;
+    }
+    for(int i=ch + 1; i <= GlyphCount; ++i)
+    {
+        d->offsets[i] += delta;
+    }
+}
+
+/**
+ * \brief Returns the number of columns needed to draw a text.
+ *
+ * \param text the text
+ *
+ * \return the width of the text, including the spacing between glyphs
+ *
+ * \sa render()
+ */
+int QLedMatrixFont::textWidth(const QString& text) const
+{
+    int width = 0;
+    int glyphs = 0;
+    for(int i=0; i < text.size(); ++i)
+    {
+        const int index = d->glyphIndex(text.at(i).unicode());
+        if(index >= 0)
+        {
+            width += d->glyphWidth(index);
+            ++glyphs;
+        }
+    }
+    return (glyphs > 0) ? width + (glyphs - 1) * d->spacing : 0;
+}
+
+/**
+ * \brief Renders a text to a glyph run.
+ *
+ * The glyph run holds the columns of the whole text, in the format of
+ * glyph(), including the spacing between glyphs.
+ *
+ * \param text the text
+ *
+ * \return the columns of the text, textWidth() of them
+ *
+ * \sa QLedMatrix::drawText()
+ */
+QVector<quint32> QLedMatrixFont::render(const QString& text) const
+{
+    QVector<quint32> run(textWidth(text), 0);
+    quint32* dst = run.data();
+    bool first = true;
+    for(int i=0; i < text.size(); ++i)
+    {
+        const int index = d->glyphIndex(text.at(i).unicode());
+        if(index < 0)
+        {
+            continue;
+        }
+
+        if(!first)
+        {
+            dst += d->spacing;
+        }
+        first = false;
+
+        const int width = d->glyphWidth(index);
+        memcpy(dst, d->columns.constData() + d->offsets[index], width * sizeof(quint32));
+        dst += width;
+    }
+    return run;
+}
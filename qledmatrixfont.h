@@ -0,0 +1,63 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef QLEDMATRIXFONT_H
+#define QLEDMATRIXFONT_H
+
+#include "qledmatrix.h"
+
+#include <QSharedDataPointer>
+#include <QVector>
+
+class QString;
+class QLedMatrixFontData;
+class QDESIGNER_WIDGET_EXPORT QLedMatrixFont
+{
+    public:
+        QLedMatrixFont();
+        explicit QLedMatrixFont(int height, int spacing = 1);
+        QLedMatrixFont(const QLedMatrixFont& other);
+        ~QLedMatrixFont();
+
+        QLedMatrixFont& operator=(const QLedMatrixFont& other);
+
+        static QLedMatrixFont font5x7();
+        static QLedMatrixFont font8x16();
+
+        bool isNull() const;
+
+        int height() const;
+
+        int spacing() const;
+        void setSpacing(int spacing);
+
+        bool hasGlyph(uint ch) const;
+        int glyphWidth(uint ch) const;
+        QVector<quint32> glyph(uint ch) const;
+        void setGlyph(uint ch, const QVector<quint32>& columns);
+
+        int textWidth(const QString& text) const;
+        QVector<quint32> render(const QString& text) const;
+
+    private:
+        QSharedDataPointer<QLedMatrixFontData> d;
+};
+
+#endif // QLEDMATRIXFONT_H
@@ -0,0 +1,216 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include "qledmatrixframesink.h"
+
+#include <qatomic.h>
+#include <qvector.h>
+
+/**
+ * \internal
+ */
+class QLedMatrixFrameSinkPrivate
+{
+    public:
+        enum
+        {
+            IndexMask  = 0x3,
+            FreshFrame = 0x4
+        };
+
+        int loadState() const;
+
+        int rowCount;
+        int columnCount;
+        QVector<QRgb> buffers[3];
+        int back;  // only used by the producer
+        int front; // only used by the consumer
+        QAtomicInt state; // index of the pending buffer, plus FreshFrame
+};
+
+/**
+ * \internal
+ */
+int QLedMatrixFrameSinkPrivate::loadState() const
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+    return state.loadAcquire();
+#else
+    return state;
+#endif
+}
+
+//////////////////////////////////
+
+/**
+ * \class QLedMatrixFrameSink
+ *
+ * \brief The QLedMatrixFrameSink class passes complete frames from a worker
+ * thread to a QLedMatrix without locking.
+ *
+ * The sink holds three frame buffers. The producer (any thread) fills the
+ * back buffer returned by backBuffer() and hands it over with publish(),
+ * which swaps it atomically with the pending buffer and returns immediately.
+ * The consumer (the GUI thread) takes the newest pending frame with
+ * acquire(). Frames published while the consumer is busy replace each other,
+ * only the newest one is shown.
+ *
+ * Since the producer and the consumer never access the same buffer, a frame
+ * can not be shown while it is being written.
+ *
+ * \code
+ * QLedMatrixFrameSink* sink = new QLedMatrixFrameSink(32, 128);
+ * matrix->setFrameSink(sink);
+ *
+ * // In the worker thread
+ * QRgb* pixels = sink->backBuffer();
+ * decode(pixels, sink->rowCount(), sink->columnCount());
+ * sink->publish();
+ * \endcode
+ *
+ * \sa QLedMatrix::setFrameSink()
+ */
+
+/**
+ * \fn void QLedMatrixFrameSink::framePublished()
+ *
+ * This signal is emitted from the producer thread by publish() when a frame
+ * becomes available and the previous one was already acquired. Use a queued
+ * connection to react to it in another thread.
+ */
+
+/**
+ * Constructs a frame sink for frames of the given size. All the buffers are
+ * allocated here, publishing frames never allocates memory.
+ *
+ * \param rows the number of rows of each frame
+ * \param columns the number of columns of each frame
+ * \param parent parent QObject
+ */
+QLedMatrixFrameSink::QLedMatrixFrameSink(int rows, int columns, QObject* parent):
+    QObject(parent),
+    d_ptr(new QLedMatrixFrameSinkPrivate)
+{
+    Q_D(QLedMatrixFrameSink);
+    d->rowCount = qMax(0, rows);
+    d->columnCount = qMax(0, columns);
+    for(int i=0; i < 3; ++i)
+    {
+        d->buffers[i].fill(QLedMatrix::NoColor, d->rowCount * d->columnCount);
+    }
+    d->back = 0;
+    d->state = 1;
+    d->front = 2;
+}
+
+/**
+ * Destroys the frame sink.
+ */
+QLedMatrixFrameSink::~QLedMatrixFrameSink()
+{
+    delete d_ptr;
+}
+
+/**
+ * \brief Returns the number of rows of the frames.
+ *
+ * \return the number of rows of the frames
+ */
+int QLedMatrixFrameSink::rowCount() const
+{
+    Q_D(const QLedMatrixFrameSink);
+    return d->rowCount;
+}
+
+/**
+ * \brief Returns the number of columns of the frames.
+ *
+ * \return the number of columns of the frames, which is also the stride of
+ *         the buffers
+ */
+int QLedMatrixFrameSink::columnCount() const
+{
+    Q_D(const QLedMatrixFrameSink);
+    return d->columnCount;
+}
+
+/**
+ * \brief Returns the buffer of the frame being produced.
+ *
+ * The buffer holds rowCount() rows of columnCount() values in the QRgb
+ * format. It belongs to the producer until publish() is called, after which
+ * another buffer must be requested. Only one thread may produce frames.
+ *
+ * \return the back buffer
+ *
+ * \sa publish()
+ */
+QRgb* QLedMatrixFrameSink::backBuffer()
+{
+    Q_D(QLedMatrixFrameSink);
+    return d->buffers[d->back].data();
+}
+
+/**
+ * \brief Publishes the back buffer as the newest frame.
+ *
+ * This function never blocks. If the previously published frame was not
+ * acquired yet, it is dropped.
+ *
+ * \sa backBuffer(), acquire()
+ */
+void QLedMatrixFrameSink::publish()
+{
+    Q_D(QLedMatrixFrameSink);
+    const int previous = d->state.fetchAndStoreOrdered(
+                             d->back | QLedMatrixFrameSinkPrivate::FreshFrame);
+    d->back = previous & QLedMatrixFrameSinkPrivate::IndexMask;
+
+    // The consumer was already notified about a frame it did not acquire yet
+    if((previous & QLedMatrixFrameSinkPrivate::FreshFrame) == 0)
+    {
+        Q_EMIT framePublished();
+    }
+}
+
+/**
+ * \brief Takes the newest published frame.
+ *
+ * The returned buffer stays valid and unchanged until the next call to
+ * acquire(). Only one thread may consume frames.
+ *
+ * \return the newest frame, or 0 if no frame was published since the last
+ *         call
+ *
+ * \sa publish()
+ */
+const QRgb* QLedMatrixFrameSink::acquire()
+{
+    Q_D(QLedMatrixFrameSink);
+    if((d->loadState() & QLedMatrixFrameSinkPrivate::FreshFrame) == 0)
+    {
+        return 0;
+    }
+
+    // Only the producer can change the state meanwhile, and it keeps it fresh
+    const int previous = d->state.fetchAndStoreOrdered(d->front);
+    d->front = previous & QLedMatrixFrameSinkPrivate::IndexMask;
+    return d->buffers[d->front].constData();
+}
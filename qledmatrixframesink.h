@@ -0,0 +1,54 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef QLEDMATRIXFRAMESINK_H
+#define QLEDMATRIXFRAMESINK_H
+
+#include "qledmatrix.h"
+
+class QLedMatrixFrameSinkPrivate;
+class QDESIGNER_WIDGET_EXPORT QLedMatrixFrameSink: public QObject
+{
+    Q_OBJECT
+
+    public:
+        QLedMatrixFrameSink(int rows, int columns, QObject* parent = 0);
+        virtual ~QLedMatrixFrameSink();
+
+        int rowCount() const;
+        int columnCount() const;
+
+        QRgb* backBuffer();
+        void publish();
+
+        const QRgb* acquire();
+
+    Q_SIGNALS:
+        void framePublished();
+
+    protected:
+        QLedMatrixFrameSinkPrivate* const d_ptr;
+
+    private:
+        Q_DISABLE_COPY(QLedMatrixFrameSink)
+        Q_DECLARE_PRIVATE(QLedMatrixFrameSink)
+};
+
+#endif // QLEDMATRIXFRAMESINK_H
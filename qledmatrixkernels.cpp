@@ -0,0 +1,388 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include "qledmatrixkernels_p.h"
+
+// SSE2 is part of the x86-64 baseline, AVX2 is enabled per function and
+// only used when the CPU reports it.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define QLEDMATRIX_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(QLEDMATRIX_HAVE_SSE2) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__)) && !defined(QLEDMATRIX_NO_AVX2)
+#define QLEDMATRIX_HAVE_AVX2
+#include <immintrin.h>
+#define QLEDMATRIX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+//////////////////////////////////
+// Scalar
+
+static void fill_scalar(QRgb* dst, int count, QRgb value)
+{
+    for(int i=0; i < count; ++i)
+    {
+        dst[i] = value;
+    }
+}
+
+static void replace_scalar(QRgb* dst, int count, QRgb before, QRgb after)
+{
+    for(int i=0; i < count; ++i)
+    {
+        if(dst[i] == before)
+        {
+            dst[i] = after;
+        }
+    }
+}
+
+static void threshold_scalar(QRgb* dst, const QRgb* src, int count, int level,
+                             QRgb on, QRgb off)
+{
+    for(int i=0; i < count; ++i)
+    {
+        dst[i] = (qGray(src[i]) >= level) ? on : off;
+    }
+}
+
+static void expandGray_scalar(QRgb* dst, const uchar* src, int count)
+{
+    for(int i=0; i < count; ++i)
+    {
+        dst[i] = qRgb(src[i], src[i], src[i]);
+    }
+}
+
+static void expandRgb888_scalar(QRgb* dst, const uchar* src, int count)
+{
+    for(int i=0; i < count; ++i, src += 3)
+    {
+        dst[i] = qRgb(src[0], src[1], src[2]);
+    }
+}
+
+static void blend_scalar(QRgb* dst, const QRgb* from, const QRgb* to, int count, int level)
+{
+    const int inverse = 256 - level;
+    for(int i=0; i < count; ++i)
+    {
+        const QRgb f = from[i];
+        const QRgb t = to[i];
+        QRgb v = 0;
+        for(int shift=0; shift < 32; shift += 8)
+        {
+            const QRgb c = (((f >> shift) & 0xFF) * inverse + ((t >> shift) & 0xFF) * level) >> 8;
+            v |= c << shift;
+        }
+        dst[i] = v;
+    }
+}
+
+//////////////////////////////////
+// SSE2
+
+#ifdef QLEDMATRIX_HAVE_SSE2
+static void fill_sse2(QRgb* dst, int count, QRgb value)
+{
+    const __m128i v = _mm_set1_epi32(int(value));
+    int i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+    fill_scalar(dst + i, count - i, value);
+}
+
+static void replace_sse2(QRgb* dst, int count, QRgb before, QRgb after)
+{
+    const __m128i b = _mm_set1_epi32(int(before));
+    const __m128i a = _mm_set1_epi32(int(after));
+    int i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+        const __m128i v = _mm_loadu_si128(p);
+        const __m128i mask = _mm_cmpeq_epi32(v, b);
+        _mm_storeu_si128(p, _mm_or_si128(_mm_andnot_si128(mask, v),
+                                         _mm_and_si128(mask, a)));
+    }
+    replace_scalar(dst + i, count - i, before, after);
+}
+
+static void threshold_sse2(QRgb* dst, const QRgb* src, int count, int level,
+                           QRgb on, QRgb off)
+{
+    // The channels are multiplied as 16-bit values: the upper half of each
+    // 32-bit lane is zero and the weighted sum never exceeds 255 * 32.
+    const __m128i channel = _mm_set1_epi32(0xFF);
+    const __m128i redWeight = _mm_set1_epi32(11);
+    const __m128i greenWeight = _mm_set1_epi32(16);
+    const __m128i blueWeight = _mm_set1_epi32(5);
+    const __m128i limit = _mm_set1_epi32(level - 1);
+    const __m128i onColor = _mm_set1_epi32(int(on));
+    const __m128i offColor = _mm_set1_epi32(int(off));
+    int i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i r = _mm_and_si128(_mm_srli_epi32(v, 16), channel);
+        const __m128i g = _mm_and_si128(_mm_srli_epi32(v, 8), channel);
+        const __m128i b = _mm_and_si128(v, channel);
+        const __m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi16(r, redWeight),
+                                                        _mm_mullo_epi16(g, greenWeight)),
+                                          _mm_mullo_epi16(b, blueWeight));
+        const __m128i mask = _mm_cmpgt_epi32(_mm_srli_epi32(sum, 5), limit);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_or_si128(_mm_and_si128(mask, onColor),
+                                      _mm_andnot_si128(mask, offColor)));
+    }
+    threshold_scalar(dst + i, src + i, count - i, level, on, off);
+}
+
+static void expandGray_sse2(QRgb* dst, const uchar* src, int count)
+{
+    // Interleaving (g, g) with (g, 0xFF) gives the bytes of 0xFFgggggg
+    const __m128i alpha = _mm_set1_epi8(char(0xFF));
+    int i = 0;
+    for(; i + 16 <= count; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i gg0 = _mm_unpacklo_epi8(v, v);
+        const __m128i ga0 = _mm_unpacklo_epi8(v, alpha);
+        const __m128i gg1 = _mm_unpackhi_epi8(v, v);
+        const __m128i ga1 = _mm_unpackhi_epi8(v, alpha);
+        __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+        _mm_storeu_si128(p, _mm_unpacklo_epi16(gg0, ga0));
+        _mm_storeu_si128(p + 1, _mm_unpackhi_epi16(gg0, ga0));
+        _mm_storeu_si128(p + 2, _mm_unpacklo_epi16(gg1, ga1));
+        _mm_storeu_si128(p + 3, _mm_unpackhi_epi16(gg1, ga1));
+    }
+    expandGray_scalar(dst + i, src + i, count - i);
+}
+
+static void blend_sse2(QRgb* dst, const QRgb* from, const QRgb* to, int count, int level)
+{
+    // The channels are widened to 16 bits: f * (256 - level) + t * level
+    // never exceeds 255 * 256
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weight = _mm_set1_epi16(short(level));
+    const __m128i inverse = _mm_set1_epi16(short(256 - level));
+    int i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        const __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i));
+        const __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(to + i));
+        const __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(f, zero), inverse),
+                                          _mm_mullo_epi16(_mm_unpacklo_epi8(t, zero), weight));
+        const __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(f, zero), inverse),
+                                           _mm_mullo_epi16(_mm_unpackhi_epi8(t, zero), weight));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8)));
+    }
+    blend_scalar(dst + i, from + i, to + i, count - i, level);
+}
+#endif
+
+//////////////////////////////////
+// AVX2
+
+#ifdef QLEDMATRIX_HAVE_AVX2
+QLEDMATRIX_TARGET_AVX2
+static void fill_avx2(QRgb* dst, int count, QRgb value)
+{
+    const __m256i v = _mm256_set1_epi32(int(value));
+    int i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+    fill_scalar(dst + i, count - i, value);
+}
+
+QLEDMATRIX_TARGET_AVX2
+static void replace_avx2(QRgb* dst, int count, QRgb before, QRgb after)
+{
+    const __m256i b = _mm256_set1_epi32(int(before));
+    const __m256i a = _mm256_set1_epi32(int(after));
+    int i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256i* p = reinterpret_cast<__m256i*>(dst + i);
+        const __m256i v = _mm256_loadu_si256(p);
+        const __m256i mask = _mm256_cmpeq_epi32(v, b);
+        _mm256_storeu_si256(p, _mm256_blendv_epi8(v, a, mask));
+    }
+    replace_scalar(dst + i, count - i, before, after);
+}
+
+QLEDMATRIX_TARGET_AVX2
+static void threshold_avx2(QRgb* dst, const QRgb* src, int count, int level,
+                           QRgb on, QRgb off)
+{
+    const __m256i channel = _mm256_set1_epi32(0xFF);
+    const __m256i redWeight = _mm256_set1_epi32(11);
+    const __m256i greenWeight = _mm256_set1_epi32(16);
+    const __m256i blueWeight = _mm256_set1_epi32(5);
+    const __m256i limit = _mm256_set1_epi32(level - 1);
+    const __m256i onColor = _mm256_set1_epi32(int(on));
+    const __m256i offColor = _mm256_set1_epi32(int(off));
+    int i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        const __m256i r = _mm256_and_si256(_mm256_srli_epi32(v, 16), channel);
+        const __m256i g = _mm256_and_si256(_mm256_srli_epi32(v, 8), channel);
+        const __m256i b = _mm256_and_si256(v, channel);
+        const __m256i sum = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi16(r, redWeight),
+                                                              _mm256_mullo_epi16(g, greenWeight)),
+                                             _mm256_mullo_epi16(b, blueWeight));
+        const __m256i mask = _mm256_cmpgt_epi32(_mm256_srli_epi32(sum, 5), limit);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                            _mm256_blendv_epi8(offColor, onColor, mask));
+    }
+    threshold_scalar(dst + i, src + i, count - i, level, on, off);
+}
+
+QLEDMATRIX_TARGET_AVX2
+static void expandGray_avx2(QRgb* dst, const uchar* src, int count)
+{
+    const __m256i spread = _mm256_set1_epi32(0x010101);
+    const __m256i alpha = _mm256_set1_epi32(int(0xFF000000));
+    int i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+        const __m256i v = _mm256_mullo_epi32(_mm256_cvtepu8_epi32(bytes), spread);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(v, alpha));
+    }
+    expandGray_scalar(dst + i, src + i, count - i);
+}
+
+QLEDMATRIX_TARGET_AVX2
+static void expandRgb888_avx2(QRgb* dst, const uchar* src, int count)
+{
+    // Each 128-bit lane holds 4 pixels (12 bytes), reordered to B, G, R and
+    // an alpha byte set by the or
+    const __m256i order = _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+                                           2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m256i alpha = _mm256_set1_epi32(int(0xFF000000));
+    int i = 0;
+
+    // The second lane reads 16 bytes from the fifth pixel: stop early
+    // enough to stay inside the source
+    for(; i + 10 <= count; i += 8)
+    {
+        const uchar* p = src + i * 3;
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12));
+        const __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                            _mm256_or_si256(_mm256_shuffle_epi8(v, order), alpha));
+    }
+    expandRgb888_scalar(dst + i, src + i * 3, count - i);
+}
+
+QLEDMATRIX_TARGET_AVX2
+static void blend_avx2(QRgb* dst, const QRgb* from, const QRgb* to, int count, int level)
+{
+    // Unpacking and packing both work within 128-bit lanes, the order of the
+    // pixels is kept
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i weight = _mm256_set1_epi16(short(level));
+    const __m256i inverse = _mm256_set1_epi16(short(256 - level));
+    int i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const __m256i f = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + i));
+        const __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(to + i));
+        const __m256i low = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(f, zero), inverse),
+                                             _mm256_mullo_epi16(_mm256_unpacklo_epi8(t, zero), weight));
+        const __m256i high = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(f, zero), inverse),
+                                              _mm256_mullo_epi16(_mm256_unpackhi_epi8(t, zero), weight));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                            _mm256_packus_epi16(_mm256_srli_epi16(low, 8),
+                                                _mm256_srli_epi16(high, 8)));
+    }
+    blend_scalar(dst + i, from + i, to + i, count - i, level);
+}
+#endif
+
+//////////////////////////////////
+
+/**
+ * \internal
+ * Returns the kernels of the given implementation, or of the best supported
+ * one below it if the CPU or the compiler does not support it.
+ */
+QLedMatrixKernels QLedMatrixKernels::select(Implementation implementation)
+{
+    QLedMatrixKernels kernels;
+
+#ifdef QLEDMATRIX_HAVE_AVX2
+    if((implementation >= AVX2) && __builtin_cpu_supports("avx2"))
+    {
+        kernels.fill = fill_avx2;
+        kernels.replace = replace_avx2;
+        kernels.threshold = threshold_avx2;
+        kernels.expandGray = expandGray_avx2;
+        kernels.expandRgb888 = expandRgb888_avx2;
+        kernels.blend = blend_avx2;
+        kernels.implementation = AVX2;
+        return kernels;
+    }
+#endif
+
+#ifdef QLEDMATRIX_HAVE_SSE2
+    if(implementation >= SSE2)
+    {
+        kernels.fill = fill_sse2;
+        kernels.replace = replace_sse2;
+        kernels.threshold = threshold_sse2;
+        kernels.expandGray = expandGray_sse2;
+        kernels.expandRgb888 = expandRgb888_scalar;
+        kernels.blend = blend_sse2;
+        kernels.implementation = SSE2;
+        return kernels;
+    }
+#endif
+
+    Q_UNUSED(implementation);
+    kernels.fill = fill_scalar;
+    kernels.replace = replace_scalar;
+    kernels.threshold = threshold_scalar;
+    kernels.expandGray = expandGray_scalar;
+    kernels.expandRgb888 = expandRgb888_scalar;
+    kernels.blend = blend_scalar;
+    kernels.implementation = Scalar;
+    return kernels;
+}
+
+/**
+ * \internal
+ * Returns the best kernels for the running CPU.
+ */
+const QLedMatrixKernels& QLedMatrixKernels::instance()
+{
+    static const QLedMatrixKernels kernels = select(AVX2);
+    return kernels;
+}
@@ -0,0 +1,78 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef QLEDMATRIXKERNELS_P_H
+#define QLEDMATRIXKERNELS_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QLedMatrix API. It exists for the convenience
+// of the QLedMatrix implementation and may change without notice.
+//
+
+#include <qglobal.h>
+#include <qrgb.h>
+
+/**
+ * \internal
+ * Loops over QRgb buffers used by the hot paths of QLedMatrix. The best
+ * implementation for the running CPU (AVX2, SSE2 or plain C++) is selected
+ * the first time instance() is called.
+ */
+struct QLedMatrixKernels
+{
+    enum Implementation
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    // Sets count values of dst to value
+    void (*fill)(QRgb* dst, int count, QRgb value);
+
+    // Replaces the values of dst equal to before with after
+    void (*replace)(QRgb* dst, int count, QRgb before, QRgb after);
+
+    // Sets dst to on where the gray level (see qGray()) of src is at least
+    // level, and to off elsewhere
+    void (*threshold)(QRgb* dst, const QRgb* src, int count, int level,
+                      QRgb on, QRgb off);
+
+    // Converts count gray levels of one byte each to opaque QRgb values
+    void (*expandGray)(QRgb* dst, const uchar* src, int count);
+
+    // Converts count pixels of three bytes each (red, green, blue) to opaque
+    // QRgb values
+    void (*expandRgb888)(QRgb* dst, const uchar* src, int count);
+
+    // Sets dst to from blended with to, channel by channel, with a weight of
+    // level (0 to 256) for to; dst may be from or to
+    void (*blend)(QRgb* dst, const QRgb* from, const QRgb* to, int count, int level);
+
+    Implementation implementation;
+
+    static const QLedMatrixKernels& instance();
+    static QLedMatrixKernels select(Implementation implementation);
+};
+
+#endif // QLEDMATRIXKERNELS_P_H
@@ -0,0 +1,1018 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include "qledmatrixrecorder.h"
+
+#include <qelapsedtimer.h>
+#include <qendian.h>
+#include <qfile.h>
+#include <qmutex.h>
+#include <qqueue.h>
+#include <qthread.h>
+#include <qvector.h>
+#include <qwaitcondition.h>
+
+#include <string.h>
+
+// Header of a recording file, all values are little-endian:
+//   0  char[4]  magic "QLMR"
+//   4  quint16  version (1)
+//   6  quint16  size of the header in bytes (24), the records follow it
+//   8  qint64   start time, in milliseconds since the epoch (UTC)
+//  16  quint32  keyframe interval
+//  20  quint32  reserved (0)
+//
+// Each recorded frame is a 24-byte record header followed by its payload:
+//   0  quint32  size of the payload in bytes
+//   4  quint16  record type (KeyframeRecord or DeltaRecord)
+//   6  quint16  reserved (0)
+//   8  qint64   timestamp, in milliseconds since the start time
+//  16  quint16  columns
+//  18  quint16  rows
+//  20  quint32  reserved (0)
+//
+// The payload holds the QRgb values of the frame, row by row (keyframes), or
+// their XOR with the values of the previous frame (deltas), as runs:
+//   0x00-0x7F  n + 1 values follow (literal run)
+//   0x80-0xBF  (n & 0x3F) + 1 copies of the value that follows (fill run)
+//   0xC0-0xFF  ((n & 0x3F) << 8 | next byte) + 1 zeros (zero run)
+// In a delta, a zero is an unchanged LED.
+static const char RecordingMagic[4] = { 'Q', 'L', 'M', 'R' };
+static const quint16 RecordingVersion = 1;
+static const int RecordingHeaderSize = 24;
+static const int RecordHeaderSize = 24;
+static const quint16 KeyframeRecord = 0;
+static const quint16 DeltaRecord = 1;
+
+static const int MaxLiteralRun = 128;
+static const int MaxFillRun = 64;
+static const int MaxZeroRun = 16384;
+
+/**
+ * \internal
+ * Encodes \a count values as runs in \a out, which must hold
+ * maxEncodedSize() bytes. Returns the number of bytes written.
+ */
+static int encodeRuns(const quint32* values, int count, uchar* out)
+{
+    uchar* const begin = out;
+    int i = 0;
+    while(i < count)
+    {
+        const quint32 value = values[i];
+        int n = 1;
+        if(value == 0)
+        {
+            while((i + n < count) && (n < MaxZeroRun) && (values[i + n] == 0))
+            {
+                ++n;
+            }
+            *out++ = uchar(0xC0 | ((n - 1) >> 8));
+            *out++ = uchar((n - 1) & 0xFF);
+        }
+        else if((i + 1 < count) && (values[i + 1] == value))
+        {
+            while((i + n < count) && (n < MaxFillRun) && (values[i + n] == value))
+            {
+                ++n;
+            }
+            *out++ = uchar(0x80 | (n - 1));
+            qToLittleEndian<quint32>(value, out);
+            out += 4;
+        }
+        else
+        {
+            // Up to the next zero or the next repeated value
+            while((i + n < count) && (n < MaxLiteralRun) && (values[i + n] != 0) &&
+                  ((i + n + 1 == count) || (values[i + n + 1] != values[i + n])))
+            {
+                ++n;
+            }
+            *out++ = uchar(n - 1);
+            for(int k=0; k < n; ++k)
+            {
+                qToLittleEndian<quint32>(values[i + k], out);
+                out += 4;
+            }
+        }
+        i += n;
+    }
+    return int(out - begin);
+}
+
+/**
+ * \internal
+ * Returns the largest size of \a count values encoded by encodeRuns().
+ */
+static inline int maxEncodedSize(int count)
+{
+    return count * 4 + (count + MaxLiteralRun - 1) / MaxLiteralRun;
+}
+
+/**
+ * \internal
+ * Decodes the runs of \a size bytes to \a count values. With \a delta, the
+ * values are combined with the current ones by XOR. Returns false if the
+ * data is corrupt.
+ */
+static bool decodeRuns(const uchar* data, int size, quint32* values, int count, bool delta)
+{
+    const uchar* const end = data + size;
+    int i = 0;
+    while(data < end)
+    {
+        const uchar op = *data++;
+        if(op >= 0xC0)
+        {
+            if(data == end)
+            {
+                return false;
+            }
+            const int n = (((op & 0x3F) << 8) | *data++) + 1;
+            if(n > count - i)
+            {
+                return false;
+            }
+            if(!delta)
+            {
+                memset(values + i, 0, n * sizeof(quint32));
+            }
+            i += n;
+        }
+        else if(op >= 0x80)
+        {
+            const int n = (op & 0x3F) + 1;
+            if((end - data < 4) || (n > count - i))
+            {
+                return false;
+            }
+            const quint32 value = qFromLittleEndian<quint32>(data);
+            data += 4;
+            for(int k=0; k < n; ++k, ++i)
+            {
+                values[i] = delta ? (values[i] ^ value) : value;
+            }
+        }
+        else
+        {
+            const int n = op + 1;
+            if((end - data < 4 * n) || (n > count - i))
+            {
+                return false;
+            }
+            for(int k=0; k < n; ++k, ++i, data += 4)
+            {
+                const quint32 value = qFromLittleEndian<quint32>(data);
+                values[i] = delta ? (values[i] ^ value) : value;
+            }
+        }
+    }
+    return i == count;
+}
+
+class QLedMatrixRecorderPrivate;
+
+/**
+ * \internal
+ * Encodes and writes the queued frames.
+ */
+class QLedMatrixRecorderThread: public QThread
+{
+    public:
+        QLedMatrixRecorderThread(QLedMatrixRecorderPrivate* d, QObject* parent):
+            QThread(parent), d(d) {}
+
+    protected:
+        void run();
+
+    private:
+        QLedMatrixRecorderPrivate* const d;
+};
+
+/**
+ * \internal
+ */
+class QLedMatrixRecorderPrivate
+{
+    public:
+        struct Entry
+        {
+            QImage frame;
+            qint64 timestamp;
+        };
+
+        void writeFrame(const Entry& entry, int interval);
+
+        QFile file;
+        QLedMatrixRecorderThread* thread;
+        QElapsedTimer clock;
+
+        // Shared with the writer thread, guarded by mutex
+        mutable QMutex mutex;
+        QWaitCondition queueChanged;
+        QQueue<Entry> queue;
+        bool closing;
+        int capacity;
+        int keyframeInterval;
+        int recorded;
+        int dropped;
+
+        // Writer thread only
+        QVector<quint32> previous; // last frame written
+        QVector<quint32> delta;
+        QByteArray record;
+        int previousRows;
+        int previousColumns;
+        int sinceKeyframe; // frames written since the last keyframe
+        bool failed;
+};
+
+/**
+ * \internal
+ * Writes a frame as a keyframe or as a delta against the previous one.
+ * Frames identical to the previous one are not written.
+ */
+void QLedMatrixRecorderPrivate::writeFrame(const Entry& entry, int interval)
+{
+    QImage image = entry.frame;
+    if((image.format() != QImage::Format_ARGB32) && (image.format() != QImage::Format_RGB32))
+    {
+        image = image.convertToFormat(QImage::Format_ARGB32);
+    }
+
+    const int rows = image.height();
+    const int columns = image.width();
+    const int count = rows * columns;
+    // 32-bit scanlines are never padded
+    const quint32* values = reinterpret_cast<const quint32*>(image.constBits());
+
+    const bool keyframe = (rows != previousRows) || (columns != previousColumns) ||
+                          (sinceKeyframe >= interval);
+    if(!keyframe && (memcmp(values, previous.constData(), count * sizeof(quint32)) == 0))
+    {
+        return;
+    }
+
+    const quint32* runs = values;
+    if(!keyframe)
+    {
+        delta.resize(count);
+        const quint32* last = previous.constData();
+        quint32* out = delta.data();
+        for(int i=0; i < count; ++i)
+        {
+            out[i] = values[i] ^ last[i];
+        }
+        runs = out;
+    }
+
+    record.resize(RecordHeaderSize + maxEncodedSize(count));
+    uchar* header = reinterpret_cast<uchar*>(record.data());
+    const int size = encodeRuns(runs, count, header + RecordHeaderSize);
+    memset(header, 0, RecordHeaderSize);
+    qToLittleEndian<quint32>(size, header);
+    qToLittleEndian<quint16>(keyframe ? KeyframeRecord : DeltaRecord, header + 4);
+    qToLittleEndian<qint64>(entry.timestamp, header + 8);
+    qToLittleEndian<quint16>(columns, header + 16);
+    qToLittleEndian<quint16>(rows, header + 18);
+
+    if(file.write(record.constData(), RecordHeaderSize + size) != RecordHeaderSize + size)
+    {
+        qWarning("QLedMatrixRecorder: write error, recording stopped");
+        failed = true;
+        return;
+    }
+
+    previous.resize(count);
+    memcpy(previous.data(), values, count * sizeof(quint32));
+    previousRows = rows;
+    previousColumns = columns;
+    sinceKeyframe = keyframe ? 1 : sinceKeyframe + 1;
+}
+
+/**
+ * \internal
+ * Writes the queued frames until the recorder is closed. The file is
+ * flushed each time the queue is empty.
+ */
+void QLedMatrixRecorderThread::run()
+{
+    bool flushed = true;
+    d->mutex.lock();
+    for(;;)
+    {
+        if(d->queue.isEmpty())
+        {
+            if(!flushed)
+            {
+                d->mutex.unlock();
+                d->file.flush();
+                flushed = true;
+                d->mutex.lock();
+                continue;
+            }
+            if(d->closing)
+            {
+                break;
+            }
+            d->queueChanged.wait(&d->mutex);
+            continue;
+        }
+
+        const QLedMatrixRecorderPrivate::Entry entry = d->queue.dequeue();
+        const int interval = d->keyframeInterval;
+        d->mutex.unlock();
+
+        if(!d->failed)
+        {
+            d->writeFrame(entry, interval);
+        }
+        flushed = false;
+        d->mutex.lock();
+    }
+    d->mutex.unlock();
+}
+
+//////////////////////////////////
+
+/**
+ * \class QLedMatrixRecorder
+ *
+ * \brief The QLedMatrixRecorder class records the frames shown by a
+ * QLedMatrix to a file.
+ *
+ * Each recorded frame is stored with its time, as the changes from the
+ * previous frame compressed in runs, and every keyframeInterval() frames as
+ * a whole frame. A display that only changes a few LEDs at a time, or none,
+ * costs a few bytes per frame.
+ *
+ * The frames are queued by recordFrame() and compressed and written by a
+ * background thread, so the GUI thread never waits for the disk. When the
+ * disk falls behind and the queue is full, the new frames are dropped (see
+ * droppedFrames()); the next frame recorded still holds all the changes.
+ *
+ * The recordings are read back with QLedMatrixRecording.
+ *
+ * \code
+ * QLedMatrixRecorder* recorder = new QLedMatrixRecorder(this);
+ * if(recorder->open(QString::fromLatin1("/var/log/signage/board.qlmr")))
+ * {
+ *     matrix->setRecorder(recorder);
+ * }
+ * \endcode
+ *
+ * \sa QLedMatrix::setRecorder(), QLedMatrixRecording
+ */
+
+/**
+ * Constructs a recorder without a file.
+ *
+ * \param parent parent QObject
+ */
+QLedMatrixRecorder::QLedMatrixRecorder(QObject* parent):
+    QObject(parent),
+    d_ptr(new QLedMatrixRecorderPrivate)
+{
+    Q_D(QLedMatrixRecorder);
+    d->thread = new QLedMatrixRecorderThread(d, this);
+    d->closing = false;
+    d->capacity = 16;
+    d->keyframeInterval = 100;
+    d->recorded = 0;
+    d->dropped = 0;
+    d->previousRows = 0;
+    d->previousColumns = 0;
+    d->sinceKeyframe = 0;
+    d->failed = false;
+}
+
+/**
+ * Destroys the recorder. The queued frames are written first.
+ */
+QLedMatrixRecorder::~QLedMatrixRecorder()
+{
+    close();
+    delete d_ptr;
+}
+
+/**
+ * \brief Starts a recording.
+ *
+ * The previous recording is closed. The file is created, or truncated, and
+ * the current time is stored as the start time of the recording.
+ *
+ * \param fileName the recording file
+ *
+ * \return true if the file was created
+ */
+bool QLedMatrixRecorder::open(const QString& fileName)
+{
+    Q_D(QLedMatrixRecorder);
+    close();
+
+    d->file.setFileName(fileName);
+    if(!d->file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qWarning("QLedMatrixRecorder::open: can not create the file");
+        return false;
+    }
+
+    uchar header[RecordingHeaderSize];
+    memset(header, 0, sizeof(header));
+    memcpy(header, RecordingMagic, sizeof(RecordingMagic));
+    qToLittleEndian<quint16>(RecordingVersion, header + 4);
+    qToLittleEndian<quint16>(RecordingHeaderSize, header + 6);
+    qToLittleEndian<qint64>(QDateTime::currentMSecsSinceEpoch(), header + 8);
+    qToLittleEndian<quint32>(d->keyframeInterval, header + 16);
+    if(d->file.write(reinterpret_cast<const char*>(header), RecordingHeaderSize) != RecordingHeaderSize)
+    {
+        qWarning("QLedMatrixRecorder::open: can not write the file");
+        d->file.close();
+        return false;
+    }
+
+    d->clock.start();
+    d->closing = false;
+    d->recorded = 0;
+    d->dropped = 0;
+    d->previous.clear();
+    d->previousRows = 0;
+    d->previousColumns = 0;
+    d->sinceKeyframe = 0;
+    d->failed = false;
+    d->thread->start();
+    return true;
+}
+
+/**
+ * \brief Ends the recording.
+ *
+ * Waits until the queued frames are written, then closes the file.
+ */
+void QLedMatrixRecorder::close()
+{
+    Q_D(QLedMatrixRecorder);
+    if(!d->file.isOpen())
+    {
+        return;
+    }
+
+    d->mutex.lock();
+    d->closing = true;
+    d->queueChanged.wakeOne();
+    d->mutex.unlock();
+
+    d->thread->wait();
+    d->file.close();
+}
+
+/**
+ * \brief Returns true while recording.
+ *
+ * \return true if a recording file is open
+ */
+bool QLedMatrixRecorder::isOpen() const
+{
+    Q_D(const QLedMatrixRecorder);
+    return d->file.isOpen();
+}
+
+/**
+ * \brief Returns the name of the recording file.
+ *
+ * \return the name of the file given to open()
+ */
+QString QLedMatrixRecorder::fileName() const
+{
+    Q_D(const QLedMatrixRecorder);
+    return d->file.fileName();
+}
+
+/**
+ * \brief Returns the number of frames between two keyframes.
+ *
+ * \return the keyframe interval
+ *
+ * \sa setKeyframeInterval()
+ */
+int QLedMatrixRecorder::keyframeInterval() const
+{
+    Q_D(const QLedMatrixRecorder);
+    QMutexLocker locker(&d->mutex);
+    return d->keyframeInterval;
+}
+
+/**
+ * \brief Sets the number of frames between two keyframes.
+ *
+ * QLedMatrixRecording rebuilds a frame from the keyframe before it, so at
+ * most \a frames frames are decoded to show any frame. Smaller intervals
+ * make larger files. A keyframe is also written when the size of the frames
+ * changes.
+ *
+ * \param frames the keyframe interval, 100 by default
+ */
+void QLedMatrixRecorder::setKeyframeInterval(int frames)
+{
+    Q_D(QLedMatrixRecorder);
+    if(frames < 1)
+    {
+        qWarning("QLedMatrixRecorder::setKeyframeInterval: invalid interval %d", frames);
+        return;
+    }
+
+    QMutexLocker locker(&d->mutex);
+    d->keyframeInterval = frames;
+}
+
+/**
+ * \brief Returns the maximum number of frames waiting to be written.
+ *
+ * \return the capacity of the queue
+ *
+ * \sa setQueueCapacity()
+ */
+int QLedMatrixRecorder::queueCapacity() const
+{
+    Q_D(const QLedMatrixRecorder);
+    QMutexLocker locker(&d->mutex);
+    return d->capacity;
+}
+
+/**
+ * \brief Sets the maximum number of frames waiting to be written.
+ *
+ * Each queued frame holds a copy of the LED colors, 4 bytes per LED.
+ *
+ * \param frames the capacity of the queue, 16 by default
+ */
+void QLedMatrixRecorder::setQueueCapacity(int frames)
+{
+    Q_D(QLedMatrixRecorder);
+    if(frames < 1)
+    {
+        qWarning("QLedMatrixRecorder::setQueueCapacity: invalid capacity %d", frames);
+        return;
+    }
+
+    QMutexLocker locker(&d->mutex);
+    d->capacity = frames;
+}
+
+/**
+ * \brief Returns the number of frames queued since the recording started.
+ *
+ * \return the number of recorded frames
+ */
+int QLedMatrixRecorder::recordedFrames() const
+{
+    Q_D(const QLedMatrixRecorder);
+    QMutexLocker locker(&d->mutex);
+    return d->recorded;
+}
+
+/**
+ * \brief Returns the number of frames dropped because the queue was full.
+ *
+ * \return the number of dropped frames
+ *
+ * \sa setQueueCapacity()
+ */
+int QLedMatrixRecorder::droppedFrames() const
+{
+    Q_D(const QLedMatrixRecorder);
+    QMutexLocker locker(&d->mutex);
+    return d->dropped;
+}
+
+/**
+ * \brief Queues a frame, stamped with the current time.
+ *
+ * The image is shared with the queue, not copied; it is compressed by the
+ * writer thread.
+ *
+ * \param frame the colors of the LEDs, one pixel per LED
+ *
+ * \return true if the frame was queued, false if nothing is recorded or the
+ *         queue is full
+ */
+bool QLedMatrixRecorder::recordFrame(const QImage& frame)
+{
+    Q_D(QLedMatrixRecorder);
+    if(!d->file.isOpen() || frame.isNull())
+    {
+        return false;
+    }
+    if((frame.width() > 0xFFFF) || (frame.height() > 0xFFFF))
+    {
+        qWarning("QLedMatrixRecorder::recordFrame: frame too large");
+        return false;
+    }
+
+    QLedMatrixRecorderPrivate::Entry entry;
+    entry.frame = frame;
+    entry.timestamp = d->clock.elapsed();
+
+    QMutexLocker locker(&d->mutex);
+    if(d->queue.size() >= d->capacity)
+    {
+        ++d->dropped;
+        return false;
+    }
+    d->queue.enqueue(entry);
+    ++d->recorded;
+    d->queueChanged.wakeOne();
+    return true;
+}
+
+/**
+ * \brief Queues the frame of a display, stamped with the current time.
+ *
+ * QLedMatrix calls it when a display with this recorder paints changed
+ * LEDs. The frame is only copied when the queue has room for it, a dropped
+ * frame costs nothing.
+ *
+ * \param display the display to record
+ *
+ * \return true if the frame was queued, false if nothing is recorded or the
+ *         queue is full
+ *
+ * \sa QLedMatrix::frame()
+ */
+bool QLedMatrixRecorder::recordFrame(const QLedMatrix* display)
+{
+    Q_D(QLedMatrixRecorder);
+    if(!d->file.isOpen() || (display == 0))
+    {
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&d->mutex);
+        if(d->queue.size() >= d->capacity)
+        {
+            ++d->dropped;
+            return false;
+        }
+    }
+    // The writer thread only empties the queue: unless another thread
+    // records as well, the frame still has room once copied
+    return recordFrame(display->frame());
+}
+
+//////////////////////////////////
+
+/**
+ * \internal
+ */
+class QLedMatrixRecordingPrivate
+{
+    public:
+        struct Record
+        {
+            qint64 offset; // of the payload
+            qint64 timestamp;
+            int size;
+            int rows;
+            int columns;
+            int keyframe; // index of the keyframe the record depends on
+        };
+
+        bool scan();
+
+        QFile file;
+        qint64 startTime;
+        QVector<Record> records;
+        QVector<quint32> values; // colors of decodedFrame
+        QByteArray payload;
+        int decodedFrame;
+};
+
+/**
+ * \internal
+ * Reads the header and indexes the records. A truncated last record, left
+ * by a recording that was not closed, is ignored.
+ */
+bool QLedMatrixRecordingPrivate::scan()
+{
+    uchar header[RecordHeaderSize];
+    if(file.read(reinterpret_cast<char*>(header), RecordingHeaderSize) != RecordingHeaderSize)
+    {
+        qWarning("QLedMatrixRecording::open: truncated header");
+        return false;
+    }
+    if((memcmp(header, RecordingMagic, sizeof(RecordingMagic)) != 0) ||
+       (qFromLittleEndian<quint16>(header + 4) != RecordingVersion))
+    {
+        qWarning("QLedMatrixRecording::open: not a recording file");
+        return false;
+    }
+
+    const int headerSize = qFromLittleEndian<quint16>(header + 6);
+    if(headerSize < RecordingHeaderSize)
+    {
+        qWarning("QLedMatrixRecording::open: invalid header size");
+        return false;
+    }
+    startTime = qFromLittleEndian<qint64>(header + 8);
+
+    const qint64 fileSize = file.size();
+    qint64 offset = headerSize;
+    while(fileSize - offset >= RecordHeaderSize)
+    {
+        if(!file.seek(offset) ||
+           (file.read(reinterpret_cast<char*>(header), RecordHeaderSize) != RecordHeaderSize))
+        {
+            break;
+        }
+
+        Record record;
+        record.offset = offset + RecordHeaderSize;
+        record.size = qFromLittleEndian<quint32>(header);
+        record.timestamp = qFromLittleEndian<qint64>(header + 8);
+        record.columns = qFromLittleEndian<quint16>(header + 16);
+        record.rows = qFromLittleEndian<quint16>(header + 18);
+        const quint16 type = qFromLittleEndian<quint16>(header + 4);
+        if((record.size < 0) || (fileSize - record.offset < record.size))
+        {
+            break;
+        }
+
+        if(type == KeyframeRecord)
+        {
+            record.keyframe = records.size();
+        }
+        else if((type == DeltaRecord) && !records.isEmpty() &&
+                (records.last().rows == record.rows) &&
+                (records.last().columns == record.columns))
+        {
+            record.keyframe = records.last().keyframe;
+        }
+        else
+        {
+            qWarning("QLedMatrixRecording::open: invalid record at %lld", offset);
+            break;
+        }
+
+        records.append(record);
+        offset = record.offset + record.size;
+    }
+    return true;
+}
+
+/**
+ * \class QLedMatrixRecording
+ *
+ * \brief The QLedMatrixRecording class reads the frames recorded by
+ * QLedMatrixRecorder.
+ *
+ * Opening a recording only reads the headers of its frames. A frame is
+ * rebuilt from the keyframe before it; reading the frames in order decodes
+ * each of them once.
+ *
+ * \code
+ * QLedMatrixRecording recording(fileName);
+ * const QDateTime when = QDateTime::fromString(QString::fromLatin1("2026-10-17T14:03:00"), Qt::ISODate);
+ * const int index = recording.frameAt(recording.startTime().msecsTo(when));
+ * if(index >= 0)
+ * {
+ *     matrix->setFrame(recording.frame(index));
+ * }
+ * \endcode
+ *
+ * \sa QLedMatrixRecorder
+ */
+
+/**
+ * Constructs a reader without a file.
+ */
+QLedMatrixRecording::QLedMatrixRecording():
+    d_ptr(new QLedMatrixRecordingPrivate)
+{
+    Q_D(QLedMatrixRecording);
+    d->startTime = 0;
+    d->decodedFrame = -1;
+}
+
+/**
+ * Constructs a reader and opens the given recording.
+ *
+ * \param fileName the recording file
+ */
+QLedMatrixRecording::QLedMatrixRecording(const QString& fileName):
+    d_ptr(new QLedMatrixRecordingPrivate)
+{
+    Q_D(QLedMatrixRecording);
+    d->startTime = 0;
+    d->decodedFrame = -1;
+    open(fileName);
+}
+
+/**
+ * Destroys the reader.
+ */
+QLedMatrixRecording::~QLedMatrixRecording()
+{
+    delete d_ptr;
+}
+
+/**
+ * \brief Opens a recording.
+ *
+ * The previous recording is closed. A recording still being written can be
+ * opened: the frames written so far are read.
+ *
+ * \param fileName the recording file
+ *
+ * \return true if the file was opened
+ */
+bool QLedMatrixRecording::open(const QString& fileName)
+{
+    Q_D(QLedMatrixRecording);
+    close();
+
+    d->file.setFileName(fileName);
+    if(!d->file.open(QIODevice::ReadOnly))
+    {
+        qWarning("QLedMatrixRecording::open: can not open the file");
+        return false;
+    }
+    if(!d->scan())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \brief Closes the recording.
+ */
+void QLedMatrixRecording::close()
+{
+    Q_D(QLedMatrixRecording);
+    d->file.close();
+    d->records.clear();
+    d->values.clear();
+    d->decodedFrame = -1;
+    d->startTime = 0;
+}
+
+/**
+ * \brief Returns true if a recording is open.
+ *
+ * \return true if a file is open
+ */
+bool QLedMatrixRecording::isOpen() const
+{
+    Q_D(const QLedMatrixRecording);
+    return d->file.isOpen();
+}
+
+/**
+ * \brief Returns the time the recording started.
+ *
+ * \return the start time, in UTC
+ */
+QDateTime QLedMatrixRecording::startTime() const
+{
+    Q_D(const QLedMatrixRecording);
+    return QDateTime::fromMSecsSinceEpoch(d->startTime).toUTC();
+}
+
+/**
+ * \brief Returns the number of recorded frames.
+ *
+ * \return the number of frames
+ */
+int QLedMatrixRecording::frameCount() const
+{
+    Q_D(const QLedMatrixRecording);
+    return d->records.size();
+}
+
+/**
+ * \brief Returns the time a frame was shown.
+ *
+ * \param frame the index of the frame
+ *
+ * \return the time, in milliseconds since startTime(), or -1 if the frame
+ *         does not exist
+ */
+qint64 QLedMatrixRecording::timestamp(int frame) const
+{
+    Q_D(const QLedMatrixRecording);
+    if((frame < 0) || (frame >= d->records.size()))
+    {
+        return -1;
+    }
+    return d->records.at(frame).timestamp;
+}
+
+/**
+ * \brief Returns the frame shown at the given time.
+ *
+ * \param msecs the time, in milliseconds since startTime()
+ *
+ * \return the index of the last frame shown at or before \a msecs, or -1 if
+ *         the time is before the first frame
+ */
+int QLedMatrixRecording::frameAt(qint64 msecs) const
+{
+    Q_D(const QLedMatrixRecording);
+    int first = 0;
+    int last = d->records.size();
+    while(first < last)
+    {
+        const int middle = first + (last - first) / 2;
+        if(d->records.at(middle).timestamp <= msecs)
+        {
+            first = middle + 1;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+    return first - 1;
+}
+
+/**
+ * \brief Returns a recorded frame.
+ *
+ * The frame is rebuilt from the keyframe before it, or from the last frame
+ * returned when it is on the way.
+ *
+ * \param frame the index of the frame
+ *
+ * \return the colors of the LEDs, one pixel per LED, or a null image if the
+ *         frame does not exist or can not be read
+ */
+QImage QLedMatrixRecording::frame(int frame)
+{
+    Q_D(QLedMatrixRecording);
+    if((frame < 0) || (frame >= d->records.size()))
+    {
+        qWarning("QLedMatrixRecording::frame: frame %d out of range", frame);
+        return QImage();
+    }
+
+    const QLedMatrixRecordingPrivate::Record& target = d->records.at(frame);
+    const int count = target.rows * target.columns;
+    int next = target.keyframe;
+    if((d->decodedFrame >= target.keyframe) && (d->decodedFrame <= frame))
+    {
+        next = d->decodedFrame + 1;
+    }
+    else
+    {
+        d->values.resize(count);
+    }
+
+    for(; next <= frame; ++next)
+    {
+        const QLedMatrixRecordingPrivate::Record& record = d->records.at(next);
+        d->decodedFrame = -1;
+        if(!d->file.seek(record.offset))
+        {
+            break;
+        }
+        d->payload = d->file.read(record.size);
+        if((d->payload.size() != record.size) ||
+           !decodeRuns(reinterpret_cast<const uchar*>(d->payload.constData()), record.size,
+                       d->values.data(), count, next != record.keyframe))
+        {
+            break;
+        }
+        d->decodedFrame = next;
+    }
+    if(d->decodedFrame != frame)
+    {
+        qWarning("QLedMatrixRecording::frame: can not read frame %d", frame);
+        return QImage();
+    }
+
+    QImage image(target.columns, target.rows, QImage::Format_ARGB32);
+    if(!image.isNull())
+    {
+        memcpy(image.bits(), d->values.constData(), count * sizeof(quint32));
+    }
+    return image;
+}
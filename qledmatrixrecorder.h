@@ -0,0 +1,90 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef QLEDMATRIXRECORDER_H
+#define QLEDMATRIXRECORDER_H
+
+#include "qledmatrix.h"
+
+#include <QDateTime>
+#include <QImage>
+
+class QLedMatrixRecorderPrivate;
+class QDESIGNER_WIDGET_EXPORT QLedMatrixRecorder: public QObject
+{
+    Q_OBJECT
+
+    public:
+        QLedMatrixRecorder(QObject* parent = 0);
+        virtual ~QLedMatrixRecorder();
+
+        bool open(const QString& fileName);
+        void close();
+        bool isOpen() const;
+        QString fileName() const;
+
+        int keyframeInterval() const;
+        void setKeyframeInterval(int frames);
+
+        int queueCapacity() const;
+        void setQueueCapacity(int frames);
+
+        int recordedFrames() const;
+        int droppedFrames() const;
+
+        bool recordFrame(const QImage& frame);
+        bool recordFrame(const QLedMatrix* display);
+
+    protected:
+        QLedMatrixRecorderPrivate* const d_ptr;
+
+    private:
+        Q_DISABLE_COPY(QLedMatrixRecorder)
+        Q_DECLARE_PRIVATE(QLedMatrixRecorder)
+};
+
+class QLedMatrixRecordingPrivate;
+class QDESIGNER_WIDGET_EXPORT QLedMatrixRecording
+{
+    public:
+        QLedMatrixRecording();
+        explicit QLedMatrixRecording(const QString& fileName);
+        ~QLedMatrixRecording();
+
+        bool open(const QString& fileName);
+        void close();
+        bool isOpen() const;
+
+        QDateTime startTime() const;
+        int frameCount() const;
+        qint64 timestamp(int frame) const;
+        int frameAt(qint64 msecs) const;
+
+        QImage frame(int frame);
+
+    protected:
+        QLedMatrixRecordingPrivate* const d_ptr;
+
+    private:
+        Q_DISABLE_COPY(QLedMatrixRecording)
+        Q_DECLARE_PRIVATE(QLedMatrixRecording)
+};
+
+#endif // QLEDMATRIXRECORDER_H
@@ -0,0 +1,606 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include "qledmatrixrenderer.h"
+#include "qledmatrixrenderer_p.h"
+
+#include <qcache.h>
+#include <qmath.h>
+#include <qmutex.h>
+#include <qpainter.h>
+#include <qvarlengtharray.h>
+
+/**
+ * \internal
+ * Sets the placement of the LEDs, without panels, and chooses their level of
+ * detail: at a pixel per LED or less the frame is drawn as a scaled image,
+ * below \a detailThreshold (or when \a squares is true) the LEDs are drawn
+ * as squares, and as round sprites otherwise. The pitches are in pixels.
+ */
+QLedMatrixGeometry::QLedMatrixGeometry(const QPointF& topLeft, qreal columnPitch,
+                                       qreal rowPitch, qreal ledDiameter,
+                                       qreal detailThreshold, bool squares):
+    origin(topLeft),
+    pitchX(columnPitch),
+    pitchY(rowPitch),
+    diameter(ledDiameter),
+    panelColumns(0),
+    panelRows(0),
+    panelSpacing(0.0)
+{
+    if(qMax(pitchX, pitchY) <= 1.0)
+    {
+        detail = ImageDetail;
+    }
+    else if(squares || (diameter < detailThreshold))
+    {
+        detail = SquareDetail;
+    }
+    else
+    {
+        detail = SpriteDetail;
+    }
+}
+
+/**
+ * \internal
+ * Stores the positions of \a count columns from \a first.
+ */
+void QLedMatrixGeometry::columnPositions(int first, int count, int* positions) const
+{
+    for(int col=first; col < first + count; ++col)
+    {
+        *positions++ = x(col);
+    }
+}
+
+//////////////////////////////////
+
+/**
+ * \internal
+ * LED sprites shared by all the renderers and displays of the process.
+ */
+struct QLedMatrixSpriteCache
+{
+    QLedMatrixSpriteCache(): images(10240) {}
+
+    QMutex mutex;
+    QCache<quint64, QImage> images; // cost in kilobytes
+};
+
+Q_GLOBAL_STATIC(QLedMatrixSpriteCache, spriteCache)
+
+/**
+ * \internal
+ * Returns the antialiased sprite of a round LED of the given color and
+ * diameter, in pixels. The diameter is keyed with a 1/16th pixel precision.
+ */
+QImage QLedMatrixRendererPrivate::sprite(QRgb rgb, qreal diameter)
+{
+    const quint64 key = (quint64(rgb) << 32) | quint32(qRound(diameter * 16.0));
+    QLedMatrixSpriteCache* cache = spriteCache();
+    {
+        QMutexLocker locker(&cache->mutex);
+        const QImage* image = cache->images.object(key);
+        if(image != 0)
+        {
+            return *image;
+        }
+    }
+
+    // Rendered unlocked: two threads may render the same sprite, the second
+    // one replaces the first in the cache
+    const int side = qMax(1, qCeil(diameter));
+    QImage image(side, side, QImage::Format_ARGB32_Premultiplied);
+    image.fill(0);
+
+    QPainter painter(&image);
+    painter.setPen(Qt::NoPen);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setBrush(QColor(rgb));
+    painter.drawEllipse(QRectF(0.0, 0.0, diameter, diameter));
+    painter.end();
+
+    QMutexLocker locker(&cache->mutex);
+    cache->images.insert(key, new QImage(image), qMax(1, side * side * 4 / 1024));
+    return image;
+}
+
+/**
+ * \internal
+ * Adds the sprites of the given colors missing from \a sprites.
+ */
+void QLedMatrixRendererPrivate::addSprites(QHash<QRgb, QImage>& sprites, const QRgb* colors,
+                                           int count, qreal diameter)
+{
+    QRgb previous = 0;
+    for(int i=0; i < count; ++i)
+    {
+        // Neighbouring LEDs often share the same color
+        if(((i > 0) && (colors[i] == previous)) || sprites.contains(colors[i]))
+        {
+            previous = colors[i];
+            continue;
+        }
+        previous = colors[i];
+        sprites.insert(previous, sprite(previous, diameter));
+    }
+}
+
+/**
+ * \internal
+ * Draws \a count LEDs of a row at the positions \a x and \a y with the
+ * sprites of \a sprites, which must hold their colors. It only reads the
+ * hash, several threads can share it.
+ */
+void QLedMatrixRendererPrivate::drawSprites(QPainter& painter, const QHash<QRgb, QImage>& sprites,
+                                            const QRgb* colors, const int* x, int count, int y)
+{
+    QHash<QRgb, QImage>::const_iterator it = sprites.constEnd();
+    for(int i=0; i < count; ++i)
+    {
+        if((it == sprites.constEnd()) || (it.key() != colors[i]))
+        {
+            it = sprites.constFind(colors[i]);
+            if(it == sprites.constEnd())
+            {
+                continue;
+            }
+        }
+        painter.drawImage(QPoint(x[i], y), it.value());
+    }
+}
+
+/**
+ * \internal
+ * Draws \a count LEDs of a row as squares, for LEDs too small for their
+ * round shape to show.
+ */
+void QLedMatrixRendererPrivate::drawSquares(QPainter& painter, const QRgb* colors, const int* x,
+                                            int count, int y, int side)
+{
+    QRgb previous = 0;
+    QColor color;
+    for(int i=0; i < count; ++i)
+    {
+        if(!color.isValid() || (colors[i] != previous))
+        {
+            previous = colors[i];
+            color = QColor(previous);
+        }
+        painter.fillRect(QRect(x[i], y, side, side), color);
+    }
+}
+
+/**
+ * \internal
+ * Draws \a count LEDs of a \a row at the positions \a x, at the level of
+ * detail of \a geometry, which must not be QLedMatrixGeometry::ImageDetail.
+ * Round LEDs are drawn with the sprites of \a sprites, which must hold their
+ * colors (see addSprites()).
+ */
+void QLedMatrixRendererPrivate::drawRow(QPainter& painter, const QLedMatrixGeometry& geometry,
+                                        const QHash<QRgb, QImage>& sprites, const QRgb* colors,
+                                        const int* x, int count, int row)
+{
+    if(geometry.detail == QLedMatrixGeometry::SquareDetail)
+    {
+        drawSquares(painter, colors, x, count, geometry.y(row), qMax(1, qCeil(geometry.diameter)));
+    }
+    else
+    {
+        drawSprites(painter, sprites, colors, x, count, geometry.y(row));
+    }
+}
+
+//////////////////////////////////
+
+/**
+ * \class QLedMatrixRenderer
+ *
+ * \brief The QLedMatrixRenderer class draws LED matrix frames on any paint
+ * device.
+ *
+ * It draws the frames as a QLedMatrix does, with the same LED placement and
+ * level of detail, without a widget: it only uses QImage and QPainter, so it
+ * works in any thread, under a QGuiApplication or a QCoreApplication, or
+ * without an application at all. A frame is an image with a pixel per LED;
+ * the frames of a display are given by QLedMatrix::frame().
+ *
+ * The LED sprites are kept in a cache shared by all the renderers and the
+ * QLedMatrix displays of the process (see setSpriteCacheLimit()). A renderer
+ * can be used by several threads at once.
+ *
+ * \code
+ * QLedMatrixRenderer renderer;
+ * renderer.setScale(2.0);
+ * foreach(const QString& name, names)
+ * {
+ *     renderer.renderImage(QImage(name)).save(thumbnailName(name));
+ * }
+ * \endcode
+ *
+ * \sa QLedMatrix::frame()
+ */
+
+/**
+ * \enum QLedMatrixRenderer::LedShape
+ *
+ * This type defines the shape of the LEDs.
+ */
+
+/**
+ * \var QLedMatrixRenderer::LedShape QLedMatrixRenderer::RoundLeds
+ * Antialiased discs, drawn as squares below the detail threshold
+ **/
+
+/**
+ * \var QLedMatrixRenderer::LedShape QLedMatrixRenderer::SquareLeds
+ * Squares
+ **/
+
+/**
+ * Constructs a renderer drawing round LEDs of 8 pixels every 10 pixels on a
+ * black background, as a QLedMatrix does by default.
+ */
+QLedMatrixRenderer::QLedMatrixRenderer():
+    d_ptr(new QLedMatrixRendererPrivate)
+{
+    Q_D(QLedMatrixRenderer);
+    d->shape = RoundLeds;
+    d->ledSize = 0.8;
+    d->scale = 10.0;
+    d->backgroundColor = Qt::black;
+    d->backgroundMode = Qt::OpaqueMode;
+    d->detailThreshold = 4.0;
+    d->smoothScaling = false;
+}
+
+/**
+ * Destroys the renderer.
+ */
+QLedMatrixRenderer::~QLedMatrixRenderer()
+{
+    delete d_ptr;
+}
+
+/**
+ * \brief Returns the shape of the LEDs.
+ *
+ * \return the shape of the LEDs
+ *
+ * \sa setLedShape()
+ */
+QLedMatrixRenderer::LedShape QLedMatrixRenderer::ledShape() const
+{
+    Q_D(const QLedMatrixRenderer);
+    return d->shape;
+}
+
+/**
+ * \brief Sets the shape of the LEDs.
+ *
+ * \param shape the shape of the LEDs, QLedMatrixRenderer::RoundLeds by
+ *        default
+ */
+void QLedMatrixRenderer::setLedShape(LedShape shape)
+{
+    Q_D(QLedMatrixRenderer);
+    d->shape = shape;
+}
+
+/**
+ * \brief Returns the size of the LEDs, relative to their spacing.
+ *
+ * \return the size of the LEDs
+ *
+ * \sa setLedSize()
+ */
+qreal QLedMatrixRenderer::ledSize() const
+{
+    Q_D(const QLedMatrixRenderer);
+    return d->ledSize;
+}
+
+/**
+ * \brief Sets the size of the LEDs, relative to their spacing.
+ *
+ * \param size the diameter of a LED divided by the distance between two
+ *        LEDs, from 0 to 1 (0.8 by default); at 1 the LEDs touch
+ */
+void QLedMatrixRenderer::setLedSize(qreal size)
+{
+    Q_D(QLedMatrixRenderer);
+    d->ledSize = qBound(qreal(0.0), size, qreal(1.0));
+}
+
+/**
+ * \brief Returns the distance between two LEDs, in pixels.
+ *
+ * \return the scale of the rendering
+ *
+ * \sa setScale()
+ */
+qreal QLedMatrixRenderer::scale() const
+{
+    Q_D(const QLedMatrixRenderer);
+    return d->scale;
+}
+
+/**
+ * \brief Sets the distance between two LEDs, in pixels.
+ *
+ * At a pixel per LED or less, the frame is drawn as a scaled image (see
+ * setSmoothScaling()).
+ *
+ * \param pixelsPerLed the scale of the rendering, 10 by default
+ */
+void QLedMatrixRenderer::setScale(qreal pixelsPerLed)
+{
+    Q_D(QLedMatrixRenderer);
+    if(pixelsPerLed <= 0.0)
+    {
+        qWarning("QLedMatrixRenderer::setScale: invalid scale");
+        return;
+    }
+    d->scale = pixelsPerLed;
+}
+
+/**
+ * \brief Returns the background color.
+ *
+ * \return the background color
+ *
+ * \sa setBackgroundColor()
+ */
+QColor QLedMatrixRenderer::backgroundColor() const
+{
+    Q_D(const QLedMatrixRenderer);
+    return d->backgroundColor;
+}
+
+/**
+ * \brief Sets the background color, drawn in opaque mode.
+ *
+ * \param color the background color, black by default
+ */
+void QLedMatrixRenderer::setBackgroundColor(const QColor& color)
+{
+    Q_D(QLedMatrixRenderer);
+    d->backgroundColor = color;
+}
+
+/**
+ * \brief Returns the background mode.
+ *
+ * \return the background mode
+ *
+ * \sa setBackgroundMode()
+ */
+Qt::BGMode QLedMatrixRenderer::backgroundMode() const
+{
+    Q_D(const QLedMatrixRenderer);
+    return d->backgroundMode;
+}
+
+/**
+ * \brief Sets the background mode.
+ *
+ * \param mode Qt::OpaqueMode (the default) to fill the rendering with the
+ *        background color, Qt::TransparentMode to only draw the LEDs
+ */
+void QLedMatrixRenderer::setBackgroundMode(Qt::BGMode mode)
+{
+    Q_D(QLedMatrixRenderer);
+    d->backgroundMode = mode;
+}
+
+/**
+ * \brief Returns the smallest LED size drawn round.
+ *
+ * \return the detail threshold, in pixels
+ *
+ * \sa setDetailThreshold(), QLedMatrix::setDetailThreshold()
+ */
+qreal QLedMatrixRenderer::detailThreshold() const
+{
+    Q_D(const QLedMatrixRenderer);
+    return d->detailThreshold;
+}
+
+/**
+ * \brief Sets the smallest LED size drawn round.
+ *
+ * \param pixels round LEDs smaller than this diameter are drawn as squares
+ *        (4 by default)
+ */
+void QLedMatrixRenderer::setDetailThreshold(qreal pixels)
+{
+    Q_D(QLedMatrixRenderer);
+    d->detailThreshold = qMax(qreal(0.0), pixels);
+}
+
+/**
+ * \brief Returns true if the LEDs are smoothed when a LED takes a pixel or
+ * less.
+ *
+ * \return true if smooth scaling is used
+ *
+ * \sa setSmoothScaling()
+ */
+bool QLedMatrixRenderer::isSmoothScaling() const
+{
+    Q_D(const QLedMatrixRenderer);
+    return d->smoothScaling;
+}
+
+/**
+ * \brief Sets how the frames are scaled down when a LED takes a pixel or
+ * less.
+ *
+ * \param smooth true to average the colors of the LEDs sharing a pixel,
+ *        false (the default) to show one of them
+ */
+void QLedMatrixRenderer::setSmoothScaling(bool smooth)
+{
+    Q_D(QLedMatrixRenderer);
+    d->smoothScaling = smooth;
+}
+
+/**
+ * \brief Returns the size of the rendering of a frame.
+ *
+ * \param leds the size of the frame, in LEDs (columns by rows)
+ *
+ * \return the size of the rendering, in pixels
+ */
+QSize QLedMatrixRenderer::imageSize(const QSize& leds) const
+{
+    Q_D(const QLedMatrixRenderer);
+    return QSize(qCeil(leds.width() * d->scale), qCeil(leds.height() * d->scale));
+}
+
+/**
+ * \brief Draws a frame with the given painter.
+ *
+ * \param painter the painter, active
+ * \param frame the colors of the LEDs, a pixel per LED; as on a display, the
+ *        alpha channel is ignored
+ * \param position the top left corner of the rendering, in the painter
+ *        coordinates
+ *
+ * \sa imageSize()
+ */
+void QLedMatrixRenderer::render(QPainter* painter, const QImage& frame,
+                                const QPointF& position) const
+{
+    Q_D(const QLedMatrixRenderer);
+    if((painter == 0) || !painter->isActive() || frame.isNull())
+    {
+        return;
+    }
+
+    const QImage colors = (frame.format() == QImage::Format_RGB32) ||
+                          (frame.format() == QImage::Format_ARGB32)
+                          ? frame : frame.convertToFormat(QImage::Format_RGB32);
+    const int rows = colors.height();
+    const int columns = colors.width();
+    const qreal pitch = d->scale;
+
+    if(d->backgroundMode == Qt::OpaqueMode)
+    {
+        painter->fillRect(QRectF(position, QSizeF(imageSize(colors.size()))), d->backgroundColor);
+    }
+
+    const qreal diameter = pitch * d->ledSize;
+    const qreal offset = (pitch - diameter) / 2.0;
+    const QLedMatrixGeometry geometry(position + QPointF(offset, offset), pitch, pitch, diameter,
+                                      d->detailThreshold, d->shape == SquareLeds);
+    if(geometry.detail == QLedMatrixGeometry::ImageDetail)
+    {
+        // Same pixels as in RGB32, without converting the frame
+        const QImage opaque(colors.constBits(), columns, rows, colors.bytesPerLine(),
+                            QImage::Format_RGB32);
+        painter->save();
+        painter->setRenderHint(QPainter::SmoothPixmapTransform, d->smoothScaling);
+        painter->drawImage(QRectF(position, QSizeF(columns * pitch, rows * pitch)),
+                           opaque, QRectF(opaque.rect()));
+        painter->restore();
+        return;
+    }
+
+    QVarLengthArray<int, 256> x(columns);
+    geometry.columnPositions(0, columns, x.data());
+
+    QHash<QRgb, QImage> sprites;
+    for(int row=0; row < rows; ++row)
+    {
+        const QRgb* line = reinterpret_cast<const QRgb*>(colors.constScanLine(row));
+        if(geometry.detail == QLedMatrixGeometry::SpriteDetail)
+        {
+            QLedMatrixRendererPrivate::addSprites(sprites, line, columns, diameter);
+        }
+        QLedMatrixRendererPrivate::drawRow(*painter, geometry, sprites, line, x.constData(),
+                                           columns, row);
+    }
+}
+
+/**
+ * \brief Draws a frame on the given paint device, from its top left corner.
+ *
+ * \param device the paint device, not already painted on
+ * \param frame the colors of the LEDs, a pixel per LED
+ */
+void QLedMatrixRenderer::render(QPaintDevice* device, const QImage& frame) const
+{
+    QPainter painter(device);
+    render(&painter, frame);
+}
+
+/**
+ * \brief Returns the rendering of a frame.
+ *
+ * \param frame the colors of the LEDs, a pixel per LED
+ *
+ * \return an image of imageSize() pixels, transparent around the LEDs in
+ *         Qt::TransparentMode
+ */
+QImage QLedMatrixRenderer::renderImage(const QImage& frame) const
+{
+    if(frame.isNull())
+    {
+        return QImage();
+    }
+
+    QImage image(imageSize(frame.size()), QImage::Format_ARGB32_Premultiplied);
+    image.fill(0);
+    render(&image, frame);
+    return image;
+}
+
+/**
+ * \brief Returns the size of the shared LED sprite cache.
+ *
+ * \return the limit of the cache, in kilobytes
+ *
+ * \sa setSpriteCacheLimit()
+ */
+int QLedMatrixRenderer::spriteCacheLimit()
+{
+    QLedMatrixSpriteCache* cache = spriteCache();
+    QMutexLocker locker(&cache->mutex);
+    return cache->images.maxCost();
+}
+
+/**
+ * \brief Sets the size of the LED sprite cache shared by the renderers and
+ * the displays.
+ *
+ * A sprite is rendered once per color and size. When the cache is full, the
+ * sprites used the least recently are dropped.
+ *
+ * \param kilobytes the limit of the cache, 10240 by default
+ */
+void QLedMatrixRenderer::setSpriteCacheLimit(int kilobytes)
+{
+    QLedMatrixSpriteCache* cache = spriteCache();
+    QMutexLocker locker(&cache->mutex);
+    cache->images.setMaxCost(qMax(0, kilobytes));
+}
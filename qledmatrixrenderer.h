@@ -0,0 +1,81 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef QLEDMATRIXRENDERER_H
+#define QLEDMATRIXRENDERER_H
+
+#include "qledmatrix.h"
+
+#include <QImage>
+
+class QPainter;
+class QLedMatrixRendererPrivate;
+class QDESIGNER_WIDGET_EXPORT QLedMatrixRenderer
+{
+    public:
+        enum LedShape
+        {
+            RoundLeds,
+            SquareLeds
+        };
+
+        QLedMatrixRenderer();
+        ~QLedMatrixRenderer();
+
+        LedShape ledShape() const;
+        void setLedShape(LedShape shape);
+
+        qreal ledSize() const;
+        void setLedSize(qreal size);
+
+        qreal scale() const;
+        void setScale(qreal pixelsPerLed);
+
+        QColor backgroundColor() const;
+        void setBackgroundColor(const QColor& color);
+
+        Qt::BGMode backgroundMode() const;
+        void setBackgroundMode(Qt::BGMode mode);
+
+        qreal detailThreshold() const;
+        void setDetailThreshold(qreal pixels);
+
+        bool isSmoothScaling() const;
+        void setSmoothScaling(bool smooth);
+
+        QSize imageSize(const QSize& leds) const;
+
+        void render(QPainter* painter, const QImage& frame,
+                    const QPointF& position = QPointF()) const;
+        void render(QPaintDevice* device, const QImage& frame) const;
+        QImage renderImage(const QImage& frame) const;
+
+        static int spriteCacheLimit();
+        static void setSpriteCacheLimit(int kilobytes);
+
+    protected:
+        QLedMatrixRendererPrivate* const d_ptr;
+
+    private:
+        Q_DISABLE_COPY(QLedMatrixRenderer)
+        Q_DECLARE_PRIVATE(QLedMatrixRenderer)
+};
+
+#endif // QLEDMATRIXRENDERER_H
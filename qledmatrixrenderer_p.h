@@ -0,0 +1,102 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef QLEDMATRIXRENDERER_P_H
+#define QLEDMATRIXRENDERER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QLedMatrix API. It is shared by
+// QLedMatrixRenderer and QLedMatrix and may change without notice.
+//
+
+#include "qledmatrixrenderer.h"
+
+#include <qhash.h>
+#include <qpoint.h>
+
+/**
+ * \internal
+ * Placement and level of detail of the LEDs of a rendering, in device
+ * pixels. QLedMatrixRenderer and QLedMatrix both draw through it, so a frame
+ * is drawn the same by both at the same scale.
+ */
+struct QLedMatrixGeometry
+{
+    enum Detail
+    {
+        ImageDetail,  // a pixel per LED or less, the frame is drawn scaled
+        SquareDetail, // LEDs below the detail threshold, or square LEDs
+        SpriteDetail  // round LEDs drawn from sprites
+    };
+
+    QLedMatrixGeometry(const QPointF& topLeft, qreal columnPitch, qreal rowPitch,
+                       qreal ledDiameter, qreal detailThreshold, bool squares);
+
+    inline int x(int col) const
+    { return qRound(origin.x() + pitchX * (col + panelOffset(col, panelColumns))); }
+    inline int y(int row) const
+    { return qRound(origin.y() + pitchY * (row + panelOffset(row, panelRows))); }
+    inline qreal panelOffset(int index, int panel) const
+    { return (panel > 0) ? panelSpacing * (index / panel) : 0.0; }
+    void columnPositions(int first, int count, int* positions) const;
+
+    QPointF origin; // top left corner of the first LED
+    qreal pitchX; // distance between two columns, panel spacing excluded
+    qreal pitchY; // distance between two rows, panel spacing excluded
+    qreal diameter; // of a LED
+    int panelColumns; // 0 without panels
+    int panelRows; // 0 without panels
+    qreal panelSpacing; // between panels, in LEDs
+    Detail detail;
+};
+
+/**
+ * \internal
+ * Options of a QLedMatrixRenderer, and the rasterization routines it shares
+ * with QLedMatrix. The routines only use QImage and QPainter, they work in
+ * any thread and without a QGuiApplication.
+ */
+class QLedMatrixRendererPrivate
+{
+    public:
+        static QImage sprite(QRgb rgb, qreal diameter);
+        static void addSprites(QHash<QRgb, QImage>& sprites, const QRgb* colors,
+                               int count, qreal diameter);
+        static void drawSprites(QPainter& painter, const QHash<QRgb, QImage>& sprites,
+                                const QRgb* colors, const int* x, int count, int y);
+        static void drawSquares(QPainter& painter, const QRgb* colors, const int* x,
+                                int count, int y, int side);
+        static void drawRow(QPainter& painter, const QLedMatrixGeometry& geometry,
+                            const QHash<QRgb, QImage>& sprites, const QRgb* colors,
+                            const int* x, int count, int row);
+
+        QLedMatrixRenderer::LedShape shape;
+        qreal ledSize; // diameter of a LED, relative to the pitch
+        qreal scale; // pitch, in pixels
+        QColor backgroundColor;
+        Qt::BGMode backgroundMode;
+        qreal detailThreshold;
+        bool smoothScaling;
+};
+
+#endif // QLEDMATRIXRENDERER_P_H
@@ -0,0 +1,838 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+#include "qledmatrixsharedfeed.h"
+
+#ifndef QT_NO_SHAREDMEMORY
+
+#include "qledmatrixstream_p.h"
+
+#include <qatomic.h>
+#include <qelapsedtimer.h>
+#include <qpointer.h>
+#include <qsharedmemory.h>
+#include <qtimer.h>
+#include <qvector.h>
+
+#include <limits.h>
+#include <string.h>
+
+// Header of a feed segment, in the byte order of the host:
+//   0  char[4]  magic "QLMF", written last by the producer
+//   4  quint16  version (1)
+//   6  quint16  size of the header in bytes (64), the slots follow it
+//   8  quint32  columns
+//  12  quint32  rows
+//  16  quint32  pixel format (QLedMatrixStream::PixelFormat)
+//  20  quint32  slot count, at least 3
+//  24  quint32  slot size in bytes, a multiple of 16
+//  28  qint32   latest slot, the newest complete frame, -1 before the first
+//  32  qint32   reader slot, the slot claimed by the consumer, -1 if none
+//  36           reserved (0)
+// Each slot starts with a 16-byte header holding its frame number (quint32,
+// from 1), followed by a frame in the layout of QLedMatrixStream::frameBytes().
+static const char FeedMagic[4] = { 'Q', 'L', 'M', 'F' };
+static const quint16 FeedVersion = 1;
+static const int FeedHeaderSize = 64;
+static const int LatestOffset = 28;
+static const int ReaderOffset = 32;
+static const int SlotHeaderSize = 16;
+static const int MinSlotCount = 3;
+
+/**
+ * \internal
+ */
+class QLedMatrixSharedFeedPrivate
+{
+    public:
+        bool readHeader();
+        QAtomicInt* latest() const;
+        QAtomicInt* reader() const;
+        uchar* slot(int index) const;
+        void release();
+
+        static int loadAcquire(const QAtomicInt* value);
+
+        QSharedMemory memory;
+        uchar* base; // 0 when not attached
+        bool producer;
+        int rowCount;
+        int columnCount;
+        QLedMatrixStream::PixelFormat format;
+        int slotCount;
+        int slotSize;
+        int writeSlot; // producer: slot being written
+        int readSlot; // consumer: slot claimed, -1 if none
+        quint32 frameNumber; // last frame published or shown
+        int droppedFrames;
+        QVector<QRgb> colors; // converted frame
+        QPointer<QLedMatrix> matrix;
+        QTimer* timer;
+        QElapsedTimer clock; // since the last frame
+        int stallTimeout;
+        bool stalled;
+};
+
+/**
+ * \internal
+ * Reads and checks the header of the attached segment. The values are
+ * checked against the size of the segment, a broken producer can not make
+ * the consumer read outside of it.
+ */
+bool QLedMatrixSharedFeedPrivate::readHeader()
+{
+    if(memory.size() < FeedHeaderSize)
+    {
+        return false;
+    }
+    if(memcmp(base, FeedMagic, sizeof(FeedMagic)) != 0)
+    {
+        return false;
+    }
+
+    quint16 version;
+    quint16 headerSize;
+    quint32 header[5]; // columns, rows, format, slot count, slot size
+    memcpy(&version, base + 4, sizeof(version));
+    memcpy(&headerSize, base + 6, sizeof(headerSize));
+    memcpy(header, base + 8, sizeof(header));
+    if((version != FeedVersion) || (headerSize != FeedHeaderSize))
+    {
+        return false;
+    }
+
+    const quint32 columns = header[0];
+    const quint32 rows = header[1];
+    const quint32 pixelFormat = header[2];
+    const quint32 slots = header[3];
+    const quint32 size = header[4];
+    if((columns == 0) || (columns > 65535) || (rows == 0) || (rows > 65535) ||
+       (pixelFormat > QLedMatrixStream::Mono) || (slots < quint32(MinSlotCount)) ||
+       (size % 16 != 0))
+    {
+        return false;
+    }
+    const QLedMatrixStream::PixelFormat pixels = QLedMatrixStream::PixelFormat(pixelFormat);
+    const qint64 frameSize = QLedMatrixStream::frameBytes(rows, columns, pixels);
+    if((frameSize > INT_MAX) || (qint64(rows) * columns > INT_MAX) ||
+       (SlotHeaderSize + frameSize > size) ||
+       (FeedHeaderSize + qint64(slots) * size > memory.size()))
+    {
+        return false;
+    }
+
+    rowCount = rows;
+    columnCount = columns;
+    format = pixels;
+    slotCount = slots;
+    slotSize = size;
+    return true;
+}
+
+/**
+ * \internal
+ */
+QAtomicInt* QLedMatrixSharedFeedPrivate::latest() const
+{
+    return reinterpret_cast<QAtomicInt*>(base + LatestOffset);
+}
+
+/**
+ * \internal
+ */
+QAtomicInt* QLedMatrixSharedFeedPrivate::reader() const
+{
+    return reinterpret_cast<QAtomicInt*>(base + ReaderOffset);
+}
+
+/**
+ * \internal
+ * Returns the header of a slot, its frame follows SlotHeaderSize bytes later.
+ */
+uchar* QLedMatrixSharedFeedPrivate::slot(int index) const
+{
+    return base + FeedHeaderSize + index * slotSize;
+}
+
+/**
+ * \internal
+ * Gives the claimed slot back to the producer.
+ */
+void QLedMatrixSharedFeedPrivate::release()
+{
+    if((base != 0) && (readSlot >= 0))
+    {
+        reader()->testAndSetOrdered(readSlot, -1);
+    }
+    readSlot = -1;
+}
+
+/**
+ * \internal
+ */
+int QLedMatrixSharedFeedPrivate::loadAcquire(const QAtomicInt* value)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+    return value->loadAcquire();
+#else
+    return *value;
+#endif
+}
+
+//////////////////////////////////
+
+/**
+ * \class QLedMatrixSharedFeed
+ *
+ * \brief The QLedMatrixSharedFeed class shows on a QLedMatrix the frames
+ * written by another process to a shared memory segment.
+ *
+ * The segment holds a small header (the size and pixel format of the
+ * frames) and a ring of at least three frame slots. The producer creates it
+ * with create(), writes each frame to frameBuffer() and hands it over with
+ * publish(). The consumer attaches to it with attach(), and when running,
+ * polls it every pollInterval() milliseconds: a few reads of the header tell
+ * whether a new frame is there, so polling costs almost nothing while the
+ * producer is idle. poll() can also be called directly, for example when the producer
+ * signals a frame on a local socket.
+ *
+ * Frames are never copied between the processes: the newest complete frame
+ * is read from its slot straight into the matrix. The consumer claims that
+ * slot, and the producer writes the next frames to the other slots, so a
+ * frame can not change while it is shown. Frames published while the
+ * consumer was busy are skipped and counted by droppedFrameCount().
+ *
+ * The segment is never locked: publishing and polling only use atomic
+ * operations on the header and never wait for the other process. A
+ * producer that stops or crashes leaves the last frame shown; the feed
+ * emits stalled() when no frame was published for stallTimeout()
+ * milliseconds and resumed() when frames come back. A producer restarted
+ * with create() on the same key reuses the segment.
+ *
+ * Producers not using Qt can write the segment directly; its layout, in
+ * the byte order of the host:
+ *
+ * \code
+ *  0  char[4]  magic "QLMF", written last
+ *  4  quint16  version (1)
+ *  6  quint16  size of the header (64), the slots follow it
+ *  8  quint32  columns
+ * 12  quint32  rows
+ * 16  quint32  pixel format (QLedMatrixStream::PixelFormat)
+ * 20  quint32  slot count, at least 3
+ * 24  quint32  slot size, a multiple of 16
+ * 28  qint32   latest slot, -1 before the first frame (atomic)
+ * 32  qint32   slot claimed by the consumer, -1 if none (atomic)
+ * \endcode
+ *
+ * Each slot starts with its frame number (quint32, from 1), followed 16
+ * bytes later by a frame laid out as in a stream file (see
+ * QLedMatrixStream::frameBytes()). To publish a frame, the producer writes
+ * it and its number to a slot which is neither the latest slot nor the
+ * claimed slot, atomically exchanges the latest slot with it (a full
+ * barrier), then reads the claimed slot to choose the next one.
+ *
+ * \code
+ * // In the display
+ * QLedMatrixSharedFeed* feed = new QLedMatrixSharedFeed(this);
+ * if(feed->attach(QString::fromLatin1("signage")))
+ * {
+ *     feed->setMatrix(matrix);
+ *     feed->start();
+ * }
+ *
+ * // In the producer
+ * QLedMatrixSharedFeed feed;
+ * feed.create(QString::fromLatin1("signage"), 32, 128);
+ * render(feed.frameBuffer());
+ * feed.publish();
+ * \endcode
+ *
+ * A segment has a single producer and a single consumer.
+ *
+ * \sa QLedMatrixStream, QLedMatrixFrameSink
+ */
+
+/**
+ * \fn void QLedMatrixSharedFeed::frameShown(quint32 frame)
+ *
+ * This signal is emitted when the consumer shows the frame numbered
+ * \a frame.
+ */
+
+/**
+ * \fn void QLedMatrixSharedFeed::stalled()
+ *
+ * This signal is emitted when the producer did not publish any frame for
+ * stallTimeout() milliseconds.
+ */
+
+/**
+ * \fn void QLedMatrixSharedFeed::resumed()
+ *
+ * This signal is emitted when a stalled producer publishes a frame again.
+ */
+
+/**
+ * Constructs a feed attached to no segment.
+ *
+ * \param parent parent QObject
+ */
+QLedMatrixSharedFeed::QLedMatrixSharedFeed(QObject* parent):
+    QObject(parent),
+    d_ptr(new QLedMatrixSharedFeedPrivate)
+{
+    Q_D(QLedMatrixSharedFeed);
+    d->base = 0;
+    d->producer = false;
+    d->rowCount = 0;
+    d->columnCount = 0;
+    d->format = QLedMatrixStream::Argb32;
+    d->slotCount = 0;
+    d->slotSize = 0;
+    d->writeSlot = 0;
+    d->readSlot = -1;
+    d->frameNumber = 0;
+    d->droppedFrames = 0;
+    d->stallTimeout = 1000;
+    d->stalled = false;
+
+    d->timer = new QTimer(this);
+    d->timer->setInterval(10);
+    connect(d->timer, SIGNAL(timeout()), this, SLOT(poll()));
+}
+
+/**
+ * Destroys the feed. The matrix keeps the frame shown.
+ */
+QLedMatrixSharedFeed::~QLedMatrixSharedFeed()
+{
+    detach();
+    delete d_ptr;
+}
+
+/**
+ * \brief Creates the segment and attaches to it as the producer.
+ *
+ * When a segment already exists with the key, left by a producer which
+ * crashed for example, it is reused if it is large enough; the frame
+ * numbers continue from its latest frame.
+ *
+ * \param key the key of the segment, shared with the consumer
+ * \param rows the number of rows of the frames
+ * \param columns the number of columns of the frames
+ * \param format the pixel format of the frames
+ * \param slotCount the number of frame slots, at least 3
+ *
+ * \return true if the segment was created
+ */
+bool QLedMatrixSharedFeed::create(const QString& key, int rows, int columns,
+                                  QLedMatrixStream::PixelFormat format, int slotCount)
+{
+    Q_D(QLedMatrixSharedFeed);
+    detach();
+
+    if((rows <= 0) || (rows > 65535) || (columns <= 0) || (columns > 65535) ||
+       (slotCount < MinSlotCount))
+    {
+        qWarning("QLedMatrixSharedFeed::create: invalid size");
+        return false;
+    }
+    const qint64 frameSize = QLedMatrixStream::frameBytes(rows, columns, format);
+    const qint64 slotSize = (SlotHeaderSize + frameSize + 15) & ~qint64(15);
+    const qint64 totalSize = FeedHeaderSize + slotCount * slotSize;
+    if((frameSize > INT_MAX) || (qint64(rows) * columns > INT_MAX) || (totalSize > INT_MAX))
+    {
+        qWarning("QLedMatrixSharedFeed::create: frames too large");
+        return false;
+    }
+
+    d->memory.setKey(key);
+    bool reused = false;
+    if(!d->memory.create(int(totalSize)))
+    {
+        if((d->memory.error() != QSharedMemory::AlreadyExists) || !d->memory.attach() ||
+           (d->memory.size() < totalSize))
+        {
+            qWarning("QLedMatrixSharedFeed::create: %s",
+                     qPrintable(d->memory.errorString()));
+            d->memory.detach();
+            return false;
+        }
+        reused = true;
+    }
+    d->base = static_cast<uchar*>(d->memory.data());
+    d->producer = true;
+
+    // Continue the numbering of a previous producer
+    d->frameNumber = 0;
+    if(reused && d->readHeader())
+    {
+        const int latest = QLedMatrixSharedFeedPrivate::loadAcquire(d->latest());
+        if((latest >= 0) && (latest < d->slotCount))
+        {
+            memcpy(&d->frameNumber, d->slot(latest), sizeof(quint32));
+        }
+    }
+
+    // Hide the segment from new consumers while it is changed
+    memset(d->base, 0, sizeof(FeedMagic));
+    const quint16 version = FeedVersion;
+    const quint16 headerSize = FeedHeaderSize;
+    const quint32 header[5] = { quint32(columns), quint32(rows), quint32(format),
+                                quint32(slotCount), quint32(slotSize) };
+    memcpy(d->base + 4, &version, sizeof(version));
+    memcpy(d->base + 6, &headerSize, sizeof(headerSize));
+    memcpy(d->base + 8, header, sizeof(header));
+    memset(d->base + 36, 0, FeedHeaderSize - 36);
+    if(!reused)
+    {
+        d->reader()->fetchAndStoreOrdered(-1);
+    }
+    d->latest()->fetchAndStoreOrdered(-1);
+    memcpy(d->base, FeedMagic, sizeof(FeedMagic));
+
+    d->rowCount = rows;
+    d->columnCount = columns;
+    d->format = format;
+    d->slotCount = slotCount;
+    d->slotSize = int(slotSize);
+    d->writeSlot = (QLedMatrixSharedFeedPrivate::loadAcquire(d->reader()) == 0) ? 1 : 0;
+    return true;
+}
+
+/**
+ * \brief Attaches to the segment of a producer as the consumer.
+ *
+ * \param key the key given to create() by the producer
+ *
+ * \return true if the segment exists and holds a valid header
+ */
+bool QLedMatrixSharedFeed::attach(const QString& key)
+{
+    Q_D(QLedMatrixSharedFeed);
+    detach();
+
+    d->memory.setKey(key);
+    if(!d->memory.attach())
+    {
+        qWarning("QLedMatrixSharedFeed::attach: %s",
+                 qPrintable(d->memory.errorString()));
+        return false;
+    }
+    d->base = static_cast<uchar*>(d->memory.data());
+    if(!d->readHeader())
+    {
+        qWarning("QLedMatrixSharedFeed::attach: not a feed segment");
+        d->memory.detach();
+        d->base = 0;
+        return false;
+    }
+
+    d->frameNumber = 0;
+    d->droppedFrames = 0;
+    d->stalled = false;
+    d->clock.start();
+    return true;
+}
+
+/**
+ * \brief Stops polling and detaches from the segment.
+ *
+ * The segment is destroyed by the system when no process is attached to it
+ * any more. The matrix keeps the frame shown.
+ */
+void QLedMatrixSharedFeed::detach()
+{
+    Q_D(QLedMatrixSharedFeed);
+    stop();
+    d->release();
+    if(d->memory.isAttached())
+    {
+        d->memory.detach();
+    }
+    d->base = 0;
+    d->producer = false;
+    d->rowCount = 0;
+    d->columnCount = 0;
+    d->slotCount = 0;
+    d->slotSize = 0;
+}
+
+/**
+ * \brief Returns true if the feed is attached to a segment.
+ *
+ * \return true after a successful create() or attach()
+ */
+bool QLedMatrixSharedFeed::isAttached() const
+{
+    Q_D(const QLedMatrixSharedFeed);
+    return d->base != 0;
+}
+
+/**
+ * \brief Returns true if the feed is the producer of its segment.
+ *
+ * \return true if the segment was created with create()
+ */
+bool QLedMatrixSharedFeed::isProducer() const
+{
+    Q_D(const QLedMatrixSharedFeed);
+    return d->producer;
+}
+
+/**
+ * \brief Returns the key of the segment.
+ *
+ * \return the key given to create() or attach()
+ */
+QString QLedMatrixSharedFeed::key() const
+{
+    Q_D(const QLedMatrixSharedFeed);
+    return d->memory.key();
+}
+
+/**
+ * \brief Returns the number of rows of the frames.
+ *
+ * \return the height of the frames in LEDs, 0 when not attached
+ */
+int QLedMatrixSharedFeed::rowCount() const
+{
+    Q_D(const QLedMatrixSharedFeed);
+    return d->rowCount;
+}
+
+/**
+ * \brief Returns the number of columns of the frames.
+ *
+ * \return the width of the frames in LEDs, 0 when not attached
+ */
+int QLedMatrixSharedFeed::columnCount() const
+{
+    Q_D(const QLedMatrixSharedFeed);
+    return d->columnCount;
+}
+
+/**
+ * \brief Returns the pixel format of the frames.
+ *
+ * \return the pixel format of the frames
+ */
+QLedMatrixStream::PixelFormat QLedMatrixSharedFeed::pixelFormat() const
+{
+    Q_D(const QLedMatrixSharedFeed);
+    return d->format;
+}
+
+/**
+ * \brief Returns the number of frame slots of the segment.
+ *
+ * \return the number of slots, 0 when not attached
+ */
+int QLedMatrixSharedFeed::slotCount() const
+{
+    Q_D(const QLedMatrixSharedFeed);
+    return d->slotCount;
+}
+
+/**
+ * \brief Returns the buffer of the frame being produced.
+ *
+ * The buffer holds QLedMatrixStream::frameBytes() bytes in the pixel format
+ * of the feed. It belongs to the producer until publish() is called, after
+ * which another buffer must be requested.
+ *
+ * \return the frame buffer, or 0 if the feed is not the producer
+ *
+ * \sa publish()
+ */
+uchar* QLedMatrixSharedFeed::frameBuffer()
+{
+    Q_D(QLedMatrixSharedFeed);
+    if(!d->producer)
+    {
+        return 0;
+    }
+    return d->slot(d->writeSlot) + SlotHeaderSize;
+}
+
+/**
+ * \brief Publishes the frame buffer as the newest frame.
+ *
+ * This function never blocks, whatever the consumer does. If the previous
+ * frame was not shown yet, it is dropped.
+ *
+ * \sa frameBuffer()
+ */
+void QLedMatrixSharedFeed::publish()
+{
+    Q_D(QLedMatrixSharedFeed);
+    if(!d->producer)
+    {
+        qWarning("QLedMatrixSharedFeed::publish: not the producer");
+        return;
+    }
+
+    if(++d->frameNumber == 0)
+    {
+        d->frameNumber = 1;
+    }
+    memcpy(d->slot(d->writeSlot), &d->frameNumber, sizeof(quint32));
+    const int published = d->writeSlot;
+    d->latest()->fetchAndStoreOrdered(published);
+
+    // The next frame goes to a slot which is neither published nor claimed
+    const int claimed = QLedMatrixSharedFeedPrivate::loadAcquire(d->reader());
+    do
+    {
+        d->writeSlot = (d->writeSlot + 1) % d->slotCount;
+    }
+    while((d->writeSlot == published) || (d->writeSlot == claimed));
+}
+
+/**
+ * \brief Returns the matrix showing the frames.
+ *
+ * \return the matrix, or 0
+ *
+ * \sa setMatrix()
+ */
+QLedMatrix* QLedMatrixSharedFeed::matrix() const
+{
+    Q_D(const QLedMatrixSharedFeed);
+    return d->matrix;
+}
+
+/**
+ * \brief Sets the matrix showing the frames.
+ *
+ * The frames are drawn from the top left LED and cropped to the matrix.
+ *
+ * \param matrix the matrix, or 0
+ */
+void QLedMatrixSharedFeed::setMatrix(QLedMatrix* matrix)
+{
+    Q_D(QLedMatrixSharedFeed);
+    d->matrix = matrix;
+}
+
+/**
+ * \brief Returns the interval between two polls of the segment.
+ *
+ * \return the interval in milliseconds, 10 by default
+ *
+ * \sa setPollInterval()
+ */
+int QLedMatrixSharedFeed::pollInterval() const
+{
+    Q_D(const QLedMatrixSharedFeed);
+    return d->timer->interval();
+}
+
+/**
+ * \brief Sets the interval between two polls of the segment.
+ *
+ * A frame is shown at most this long after it was published.
+ *
+ * \param msec the interval in milliseconds
+ *
+ * \sa pollInterval()
+ */
+void QLedMatrixSharedFeed::setPollInterval(int msec)
+{
+    Q_D(QLedMatrixSharedFeed);
+    d->timer->setInterval(qMax(0, msec));
+}
+
+/**
+ * \brief Returns the time after which a silent producer is stalled.
+ *
+ * \return the timeout in milliseconds, 1000 by default
+ *
+ * \sa setStallTimeout(), stalled()
+ */
+int QLedMatrixSharedFeed::stallTimeout() const
+{
+    Q_D(const QLedMatrixSharedFeed);
+    return d->stallTimeout;
+}
+
+/**
+ * \brief Sets the time after which a silent producer is stalled.
+ *
+ * \param msec the timeout in milliseconds
+ *
+ * \sa stallTimeout(), stalled()
+ */
+void QLedMatrixSharedFeed::setStallTimeout(int msec)
+{
+    Q_D(QLedMatrixSharedFeed);
+    d->stallTimeout = qMax(0, msec);
+}
+
+/**
+ * \brief Returns true if the segment is polled.
+ *
+ * \return true between start() and stop()
+ */
+bool QLedMatrixSharedFeed::isRunning() const
+{
+    Q_D(const QLedMatrixSharedFeed);
+    return d->timer->isActive();
+}
+
+/**
+ * \brief Returns true if the producer did not publish any frame for
+ * stallTimeout() milliseconds.
+ *
+ * \return true if the producer is stalled
+ */
+bool QLedMatrixSharedFeed::isStalled() const
+{
+    Q_D(const QLedMatrixSharedFeed);
+    return d->stalled;
+}
+
+/**
+ * \brief Returns the number of the last frame.
+ *
+ * \return the number of the last frame shown by the consumer or published
+ *         by the producer, 0 if there is none
+ */
+quint32 QLedMatrixSharedFeed::frameNumber() const
+{
+    Q_D(const QLedMatrixSharedFeed);
+    return d->frameNumber;
+}
+
+/**
+ * \brief Returns the number of frames published but never shown.
+ *
+ * \return the number of frames dropped since attach()
+ */
+int QLedMatrixSharedFeed::droppedFrameCount() const
+{
+    Q_D(const QLedMatrixSharedFeed);
+    return d->droppedFrames;
+}
+
+/**
+ * \brief Starts polling the segment.
+ *
+ * \sa stop(), pollInterval()
+ */
+void QLedMatrixSharedFeed::start()
+{
+    Q_D(QLedMatrixSharedFeed);
+    if((d->base == 0) || d->producer)
+    {
+        qWarning("QLedMatrixSharedFeed::start: not attached as a consumer");
+        return;
+    }
+    d->clock.start();
+    d->timer->start();
+    poll();
+}
+
+/**
+ * \brief Stops polling the segment. The matrix keeps the frame shown.
+ *
+ * \sa start()
+ */
+void QLedMatrixSharedFeed::stop()
+{
+    Q_D(QLedMatrixSharedFeed);
+    d->timer->stop();
+}
+
+/**
+ * \brief Shows the newest frame of the segment, if it was not shown yet.
+ *
+ * \return true if a frame was shown
+ */
+bool QLedMatrixSharedFeed::poll()
+{
+    Q_D(QLedMatrixSharedFeed);
+    if((d->base == 0) || d->producer)
+    {
+        return false;
+    }
+
+    // A producer restarted with another frame size changed the header
+    if((memcmp(d->base, FeedMagic, sizeof(FeedMagic)) != 0) || !d->readHeader())
+    {
+        return false;
+    }
+
+    // The claimed slot can not be written, it holds no new frame
+    int latest = QLedMatrixSharedFeedPrivate::loadAcquire(d->latest());
+    int tries = 0;
+    while((latest != d->readSlot) && (latest >= 0) && (latest < d->slotCount))
+    {
+        // The claim holds once the slot is still the latest after it: the
+        // producer reads the claim after publishing, before choosing a slot
+        d->reader()->fetchAndStoreOrdered(latest);
+        d->readSlot = latest;
+        latest = QLedMatrixSharedFeedPrivate::loadAcquire(d->latest());
+        if((latest != d->readSlot) && (++tries == 4))
+        {
+            // The producer outpaces the claims, try again at the next poll
+            return false;
+        }
+    }
+
+    quint32 frame = 0;
+    if((latest >= 0) && (latest == d->readSlot))
+    {
+        memcpy(&frame, d->slot(latest), sizeof(quint32));
+    }
+    if((frame == 0) || (frame == d->frameNumber))
+    {
+        if(!d->stalled && (d->clock.elapsed() > d->stallTimeout))
+        {
+            d->stalled = true;
+            Q_EMIT stalled();
+        }
+        return false;
+    }
+
+    // Frame numbers going back come from a restarted producer
+    if((d->frameNumber != 0) && (frame > d->frameNumber))
+    {
+        d->droppedFrames += int(frame - d->frameNumber - 1);
+    }
+    d->frameNumber = frame;
+    d->clock.start();
+    if(d->matrix)
+    {
+        QLedMatrixStreamPrivate::showFrame(d->matrix, d->slot(latest) + SlotHeaderSize,
+                                           d->rowCount, d->columnCount, d->format,
+                                           d->colors);
+    }
+    if(d->stalled)
+    {
+        d->stalled = false;
+        Q_EMIT resumed();
+    }
+    Q_EMIT frameShown(frame);
+    return true;
+}
+
+#endif // QT_NO_SHAREDMEMORY
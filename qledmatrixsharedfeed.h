@@ -0,0 +1,86 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+#ifndef QLEDMATRIXSHAREDFEED_H
+#define QLEDMATRIXSHAREDFEED_H
+
+#include "qledmatrixstream.h"
+
+#ifndef QT_NO_SHAREDMEMORY
+
+class QLedMatrixSharedFeedPrivate;
+class QDESIGNER_WIDGET_EXPORT QLedMatrixSharedFeed: public QObject
+{
+    Q_OBJECT
+
+    public:
+        QLedMatrixSharedFeed(QObject* parent = 0);
+        virtual ~QLedMatrixSharedFeed();
+
+        bool create(const QString& key, int rows, int columns,
+                    QLedMatrixStream::PixelFormat format = QLedMatrixStream::Argb32,
+                    int slotCount = 3);
+        bool attach(const QString& key);
+        void detach();
+        bool isAttached() const;
+        bool isProducer() const;
+        QString key() const;
+
+        int rowCount() const;
+        int columnCount() const;
+        QLedMatrixStream::PixelFormat pixelFormat() const;
+        int slotCount() const;
+
+        uchar* frameBuffer();
+        void publish();
+
+        QLedMatrix* matrix() const;
+        void setMatrix(QLedMatrix* matrix);
+
+        int pollInterval() const;
+        void setPollInterval(int msec);
+        int stallTimeout() const;
+        void setStallTimeout(int msec);
+
+        bool isRunning() const;
+        bool isStalled() const;
+        quint32 frameNumber() const;
+        int droppedFrameCount() const;
+
+    public Q_SLOTS:
+        void start();
+        void stop();
+        bool poll();
+
+    Q_SIGNALS:
+        void frameShown(quint32 frame);
+        void stalled();
+        void resumed();
+
+    protected:
+        QLedMatrixSharedFeedPrivate* const d_ptr;
+
+    private:
+        Q_DISABLE_COPY(QLedMatrixSharedFeed)
+        Q_DECLARE_PRIVATE(QLedMatrixSharedFeed)
+};
+
+#endif // QT_NO_SHAREDMEMORY
+
+#endif // QLEDMATRIXSHAREDFEED_H
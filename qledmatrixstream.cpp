@@ -0,0 +1,724 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include "qledmatrixstream_p.h"
+#include "qledmatrixkernels_p.h"
+
+#include <qendian.h>
+#include <qfile.h>
+#include <qimage.h>
+#include <qmath.h>
+#include <qtimer.h>
+#include <qvector.h>
+
+#include <limits.h>
+#include <string.h>
+
+// Header of a stream file, all values are little-endian:
+//   0  char[4]  magic "QLMS"
+//   4  quint16  version (1)
+//   6  quint16  size of the header in bytes (32), the frames follow it
+//   8  quint32  columns
+//  12  quint32  rows
+//  16  quint32  pixel format (QLedMatrixStream::PixelFormat)
+//  20  quint32  frame rate in frames per 1000 seconds
+//  24  quint32  frame count, 0 to use all the frames of the file
+//  28  quint32  reserved (0)
+static const char StreamMagic[4] = { 'Q', 'L', 'M', 'S' };
+static const quint16 StreamVersion = 1;
+static const int StreamHeaderSize = 32;
+
+/**
+ * \internal
+ * Reads and checks the header of the open file.
+ */
+bool QLedMatrixStreamPrivate::readHeader()
+{
+    uchar header[StreamHeaderSize];
+    if(file.read(reinterpret_cast<char*>(header), StreamHeaderSize) != StreamHeaderSize)
+    {
+        qWarning("QLedMatrixStream::open: truncated header");
+        return false;
+    }
+    if(memcmp(header, StreamMagic, sizeof(StreamMagic)) != 0)
+    {
+        qWarning("QLedMatrixStream::open: not a stream file");
+        return false;
+    }
+
+    const quint16 version = qFromLittleEndian<quint16>(header + 4);
+    const quint16 headerSize = qFromLittleEndian<quint16>(header + 6);
+    const quint32 columns = qFromLittleEndian<quint32>(header + 8);
+    const quint32 rows = qFromLittleEndian<quint32>(header + 12);
+    const quint32 pixelFormat = qFromLittleEndian<quint32>(header + 16);
+    const quint32 rate = qFromLittleEndian<quint32>(header + 20);
+    const quint32 count = qFromLittleEndian<quint32>(header + 24);
+    if((version != StreamVersion) || (headerSize < StreamHeaderSize))
+    {
+        qWarning("QLedMatrixStream::open: unsupported version %u", uint(version));
+        return false;
+    }
+    if((columns == 0) || (columns > 65535) || (rows == 0) || (rows > 65535) ||
+       (pixelFormat > QLedMatrixStream::Mono) || (rate == 0))
+    {
+        qWarning("QLedMatrixStream::open: invalid header");
+        return false;
+    }
+
+    rowCount = rows;
+    columnCount = columns;
+    format = QLedMatrixStream::PixelFormat(pixelFormat);
+    frameRate = rate / 1000.0;
+    frameSize = QLedMatrixStream::frameBytes(rowCount, columnCount, format);
+    dataOffset = headerSize;
+
+    // Each frame is mapped and converted as a whole, its size and number of
+    // LEDs must fit in an int
+    if((frameSize <= 0) || (frameSize > INT_MAX) ||
+       (qint64(rowCount) * columnCount > INT_MAX) ||
+       (frameSize > file.size() - dataOffset))
+    {
+        qWarning("QLedMatrixStream::open: invalid frame size");
+        return false;
+    }
+
+    const qint64 available = (file.size() - dataOffset) / frameSize;
+    frameCount = int(qMin<qint64>(available, (count > 0) ? qint64(count) : qint64(INT_MAX)));
+    if(frameCount <= 0)
+    {
+        qWarning("QLedMatrixStream::open: no frames");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \internal
+ * Returns the data of a frame. When the file could not be mapped whole,
+ * which happens with large files in a 32-bit address space, the frames are
+ * mapped one at a time.
+ */
+const uchar* QLedMatrixStreamPrivate::frameData(int frame)
+{
+    const qint64 offset = dataOffset + frame * frameSize;
+    if(fileMap != 0)
+    {
+        return fileMap + offset;
+    }
+
+    if(frameMap != 0)
+    {
+        file.unmap(frameMap);
+    }
+    frameMap = file.map(offset, frameSize);
+    if(frameMap == 0)
+    {
+        qWarning("QLedMatrixStream: can not map frame %d", frame);
+    }
+    return frameMap;
+}
+
+/**
+ * \internal
+ * Shows a frame of the file on the matrix.
+ */
+void QLedMatrixStreamPrivate::show(int frame)
+{
+    currentFrame = frame;
+    if(!matrix)
+    {
+        return;
+    }
+
+    const uchar* data = frameData(frame);
+    if(data != 0)
+    {
+        showFrame(matrix, data, rowCount, columnCount, format, colors);
+    }
+}
+
+/**
+ * \internal
+ * Copies a frame in the given format to the matrix. 32-bit frames are copied
+ * directly from \a data; the other formats are converted in a single pass
+ * first, to \a colors. Monochrome frames are copied 32 LEDs at a time to a
+ * matrix in QLedMatrix::MonochromeStorage.
+ */
+void QLedMatrixStreamPrivate::showFrame(QLedMatrix* matrix, const uchar* data,
+                                        int rowCount, int columnCount,
+                                        QLedMatrixStream::PixelFormat format,
+                                        QVector<QRgb>& colors)
+{
+    const int bytesPerLine = int(QLedMatrixStream::frameBytes(1, columnCount, format));
+    const qint64 ledCount = qint64(rowCount) * columnCount;
+    if(ledCount > INT_MAX)
+    {
+        qWarning("QLedMatrixStream: frame too large");
+        return;
+    }
+    const int count = int(ledCount);
+    const QRect rect(0, 0, columnCount, rowCount);
+    const QLedMatrixKernels& kernels = QLedMatrixKernels::instance();
+    colors.resize(count);
+    switch(format)
+    {
+        case QLedMatrixStream::Argb32:
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+            if((quintptr(data) % sizeof(QRgb)) == 0)
+            {
+                matrix->setPixels(rect, reinterpret_cast<const QRgb*>(data), columnCount);
+                return;
+            }
+#endif
+            for(int i=0; i < count; ++i)
+            {
+                colors[i] = qFromLittleEndian<quint32>(data + i * sizeof(QRgb));
+            }
+            break;
+        case QLedMatrixStream::Rgb888:
+            kernels.expandRgb888(colors.data(), data, count);
+            break;
+        case QLedMatrixStream::Grayscale8:
+            kernels.expandGray(colors.data(), data, count);
+            break;
+        case QLedMatrixStream::Mono:
+        {
+            if(matrix->storageFormat() == QLedMatrix::MonochromeStorage)
+            {
+                // A read-only image over the mapped file, nothing is copied
+                matrix->setFrame(QImage(data, columnCount, rowCount, bytesPerLine,
+                                        QImage::Format_Mono));
+                return;
+            }
+
+            const QRgb on = matrix->litLedColor().rgb();
+            const QRgb off = matrix->darkLedColor().rgb();
+            for(int row=0; row < rowCount; ++row)
+            {
+                const uchar* bits = data + row * bytesPerLine;
+                QRgb* line = colors.data() + row * columnCount;
+                for(int col=0; col < columnCount; ++col)
+                {
+                    line[col] = ((bits[col >> 3] >> (7 - (col & 7))) & 1) ? on : off;
+                }
+            }
+            break;
+        }
+    }
+    matrix->setPixels(rect, colors.constData(), columnCount);
+}
+
+/**
+ * \internal
+ */
+void QLedMatrixStreamPrivate::unmap()
+{
+    if(fileMap != 0)
+    {
+        file.unmap(fileMap);
+        fileMap = 0;
+    }
+    if(frameMap != 0)
+    {
+        file.unmap(frameMap);
+        frameMap = 0;
+    }
+}
+
+//////////////////////////////////
+
+/**
+ * \class QLedMatrixStream
+ *
+ * \brief The QLedMatrixStream class plays a file of raw frames on a
+ * QLedMatrix.
+ *
+ * A stream file starts with a 32-byte header (see writeHeader()) giving the
+ * size of the frames, their pixel format and the frame rate, followed by the
+ * frames, packed. The rows of a frame are packed too, except in the
+ * QLedMatrixStream::Mono format where each row is padded to 32 bits.
+ *
+ * The file is mapped in memory with QFile::map(): the system reads the
+ * frames when they are shown, the file is never loaded whole. Frames in the
+ * QLedMatrixStream::Argb32 format are copied from the mapping to the matrix,
+ * the other formats are converted in a single pass (with SSE2 or AVX2 when
+ * available).
+ *
+ * \code
+ * QLedMatrixStream* stream = new QLedMatrixStream(this);
+ * if(stream->open(QString::fromLatin1("/var/signage/replay.qlms")))
+ * {
+ *     stream->setMatrix(matrix);
+ *     stream->start();
+ * }
+ * \endcode
+ *
+ * \sa QLedMatrix::setPixels()
+ */
+
+/**
+ * \enum QLedMatrixStream::PixelFormat
+ *
+ * This type defines the format of the frames of a stream file.
+ */
+
+/**
+ * \var QLedMatrixStream::PixelFormat QLedMatrixStream::Argb32
+ * 4 bytes per LED, a little-endian QRgb value
+ **/
+
+/**
+ * \var QLedMatrixStream::PixelFormat QLedMatrixStream::Rgb888
+ * 3 bytes per LED: red, green and blue
+ **/
+
+/**
+ * \var QLedMatrixStream::PixelFormat QLedMatrixStream::Grayscale8
+ * 1 byte per LED, a gray level
+ **/
+
+/**
+ * \var QLedMatrixStream::PixelFormat QLedMatrixStream::Mono
+ * 1 bit per LED, most significant bit first, shown with the lit and dark LED
+ * colors of the matrix
+ **/
+
+/**
+ * \fn void QLedMatrixStream::frameChanged(int frame)
+ *
+ * This signal is emitted when \a frame is shown. Frames skipped to keep up
+ * with the frame rate are not signaled.
+ */
+
+/**
+ * \fn void QLedMatrixStream::finished()
+ *
+ * This signal is emitted when a stream that does not loop has shown its last
+ * frame.
+ */
+
+/**
+ * Constructs a stream without a file, which loops.
+ *
+ * \param parent parent QObject
+ */
+QLedMatrixStream::QLedMatrixStream(QObject* parent):
+    QObject(parent),
+    d_ptr(new QLedMatrixStreamPrivate)
+{
+    Q_D(QLedMatrixStream);
+    d->fileMap = 0;
+    d->frameMap = 0;
+    d->dataOffset = 0;
+    d->frameSize = 0;
+    d->rowCount = 0;
+    d->columnCount = 0;
+    d->format = Argb32;
+    d->frameRate = 0.0;
+    d->frameCount = 0;
+    d->startFrame = 0;
+    d->currentFrame = -1;
+    d->looping = true;
+    d->running = false;
+
+    d->timer = new QTimer(this);
+    d->timer->setSingleShot(true);
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+    d->timer->setTimerType(Qt::PreciseTimer);
+#endif
+    connect(d->timer, SIGNAL(timeout()), this, SLOT(advance()));
+}
+
+/**
+ * Destroys the stream. The matrix keeps the frame shown.
+ */
+QLedMatrixStream::~QLedMatrixStream()
+{
+    close();
+    delete d_ptr;
+}
+
+/**
+ * \brief Opens a stream file.
+ *
+ * The previous file is closed. The header is checked and the file is mapped
+ * in memory.
+ *
+ * \param fileName the stream file
+ *
+ * \return true if the file was opened
+ */
+bool QLedMatrixStream::open(const QString& fileName)
+{
+    Q_D(QLedMatrixStream);
+    close();
+
+    d->file.setFileName(fileName);
+    if(!d->file.open(QIODevice::ReadOnly))
+    {
+        qWarning("QLedMatrixStream::open: can not open the file");
+        return false;
+    }
+    if(!d->readHeader())
+    {
+        d->file.close();
+        return false;
+    }
+
+    // Mapping the whole file only reserves address space, the frames are read
+    // when they are shown. frameData() maps them one at a time if it fails.
+    d->fileMap = d->file.map(0, d->dataOffset + d->frameCount * d->frameSize);
+    return true;
+}
+
+/**
+ * \brief Stops the stream and closes its file.
+ */
+void QLedMatrixStream::close()
+{
+    Q_D(QLedMatrixStream);
+    stop();
+    d->unmap();
+    d->file.close();
+    d->rowCount = 0;
+    d->columnCount = 0;
+    d->frameCount = 0;
+    d->currentFrame = -1;
+}
+
+/**
+ * \brief Returns true if a stream file is open.
+ *
+ * \return true if a file is open
+ */
+bool QLedMatrixStream::isOpen() const
+{
+    Q_D(const QLedMatrixStream);
+    return d->file.isOpen();
+}
+
+/**
+ * \brief Returns the name of the stream file.
+ *
+ * \return the name of the file given to open()
+ */
+QString QLedMatrixStream::fileName() const
+{
+    Q_D(const QLedMatrixStream);
+    return d->file.fileName();
+}
+
+/**
+ * \brief Returns the number of rows of the frames.
+ *
+ * \return the height of the frames in LEDs
+ */
+int QLedMatrixStream::rowCount() const
+{
+    Q_D(const QLedMatrixStream);
+    return d->rowCount;
+}
+
+/**
+ * \brief Returns the number of columns of the frames.
+ *
+ * \return the width of the frames in LEDs
+ */
+int QLedMatrixStream::columnCount() const
+{
+    Q_D(const QLedMatrixStream);
+    return d->columnCount;
+}
+
+/**
+ * \brief Returns the pixel format of the frames.
+ *
+ * \return the pixel format of the frames
+ */
+QLedMatrixStream::PixelFormat QLedMatrixStream::pixelFormat() const
+{
+    Q_D(const QLedMatrixStream);
+    return d->format;
+}
+
+/**
+ * \brief Returns the number of frames shown per second.
+ *
+ * \return the frame rate of the stream
+ */
+qreal QLedMatrixStream::frameRate() const
+{
+    Q_D(const QLedMatrixStream);
+    return d->frameRate;
+}
+
+/**
+ * \brief Returns the number of frames of the stream.
+ *
+ * \return the number of frames
+ */
+int QLedMatrixStream::frameCount() const
+{
+    Q_D(const QLedMatrixStream);
+    return d->frameCount;
+}
+
+/**
+ * \brief Returns the matrix showing the stream.
+ *
+ * \return the matrix, or 0 if there is none
+ *
+ * \sa setMatrix()
+ */
+QLedMatrix* QLedMatrixStream::matrix() const
+{
+    Q_D(const QLedMatrixStream);
+    return d->matrix;
+}
+
+/**
+ * \brief Sets the matrix showing the stream.
+ *
+ * The current frame, if any, is copied to the new matrix. The frames are
+ * drawn from the top left LED and cropped to the matrix.
+ *
+ * \param matrix the matrix, or 0
+ */
+void QLedMatrixStream::setMatrix(QLedMatrix* matrix)
+{
+    Q_D(QLedMatrixStream);
+    d->matrix = matrix;
+    if(d->currentFrame >= 0)
+    {
+        d->show(d->currentFrame);
+    }
+}
+
+/**
+ * \brief Returns true if the stream starts again after its last frame.
+ *
+ * \return true if the stream loops
+ *
+ * \sa setLooping()
+ */
+bool QLedMatrixStream::isLooping() const
+{
+    Q_D(const QLedMatrixStream);
+    return d->looping;
+}
+
+/**
+ * \brief Sets whether the stream starts again after its last frame.
+ *
+ * \param looping true to loop (the default), false to stop on the last
+ *        frame and emit finished()
+ */
+void QLedMatrixStream::setLooping(bool looping)
+{
+    Q_D(QLedMatrixStream);
+    d->looping = looping;
+}
+
+/**
+ * \brief Returns true while the stream is playing.
+ *
+ * \return true if the stream is playing
+ */
+bool QLedMatrixStream::isRunning() const
+{
+    Q_D(const QLedMatrixStream);
+    return d->running;
+}
+
+/**
+ * \brief Returns the frame shown.
+ *
+ * \return the index of the current frame, or -1 if no frame was shown yet
+ */
+int QLedMatrixStream::currentFrame() const
+{
+    Q_D(const QLedMatrixStream);
+    return d->currentFrame;
+}
+
+/**
+ * \brief Returns the size of a frame in a stream file.
+ *
+ * \param rows the number of rows of the frames
+ * \param columns the number of columns of the frames
+ * \param format the pixel format of the frames
+ *
+ * \return the size of a frame in bytes
+ */
+qint64 QLedMatrixStream::frameBytes(int rows, int columns, PixelFormat format)
+{
+    switch(format)
+    {
+        case Rgb888:
+            return qint64(rows) * columns * 3;
+        case Grayscale8:
+            return qint64(rows) * columns;
+        case Mono:
+            return qint64(rows) * ((columns + 31) / 32) * 4;
+        default:
+            return qint64(rows) * columns * 4;
+    }
+}
+
+/**
+ * \brief Writes the header of a stream file.
+ *
+ * The frames, frameBytes() each, are then written after the header.
+ *
+ * \param device the device to write to, open for writing
+ * \param rows the number of rows of the frames
+ * \param columns the number of columns of the frames
+ * \param format the pixel format of the frames
+ * \param frameRate the number of frames shown per second
+ * \param frameCount the number of frames, or 0 to use all the frames found
+ *        in the file
+ *
+ * \return true if the header was written
+ */
+bool QLedMatrixStream::writeHeader(QIODevice* device, int rows, int columns,
+                                   PixelFormat format, qreal frameRate,
+                                   int frameCount)
+{
+    if((device == 0) || (rows <= 0) || (columns <= 0) || (frameRate <= 0.0))
+    {
+        qWarning("QLedMatrixStream::writeHeader: invalid parameters");
+        return false;
+    }
+
+    uchar header[StreamHeaderSize];
+    memset(header, 0, sizeof(header));
+    memcpy(header, StreamMagic, sizeof(StreamMagic));
+    qToLittleEndian<quint16>(StreamVersion, header + 4);
+    qToLittleEndian<quint16>(StreamHeaderSize, header + 6);
+    qToLittleEndian<quint32>(columns, header + 8);
+    qToLittleEndian<quint32>(rows, header + 12);
+    qToLittleEndian<quint32>(format, header + 16);
+    qToLittleEndian<quint32>(qRound(frameRate * 1000.0), header + 20);
+    qToLittleEndian<quint32>(qMax(0, frameCount), header + 24);
+    return device->write(reinterpret_cast<const char*>(header), StreamHeaderSize) == StreamHeaderSize;
+}
+
+/**
+ * \brief Plays the stream from its first frame.
+ *
+ * Frames are shown at the frame rate of the file, on the wall clock: when
+ * the event loop is late, the frames whose time is over are skipped.
+ *
+ * \sa stop(), seek()
+ */
+void QLedMatrixStream::start()
+{
+    Q_D(QLedMatrixStream);
+    if(!isOpen())
+    {
+        qWarning("QLedMatrixStream::start: no file");
+        return;
+    }
+
+    d->running = true;
+    seek(0);
+}
+
+/**
+ * \brief Stops the stream. The matrix keeps the frame shown.
+ *
+ * \sa start()
+ */
+void QLedMatrixStream::stop()
+{
+    Q_D(QLedMatrixStream);
+    d->running = false;
+    d->timer->stop();
+}
+
+/**
+ * \brief Shows the given frame.
+ *
+ * A running stream continues from this frame.
+ *
+ * \param frame the index of the frame
+ *
+ * \return true if the frame exists
+ */
+bool QLedMatrixStream::seek(int frame)
+{
+    Q_D(QLedMatrixStream);
+    if((frame < 0) || (frame >= d->frameCount))
+    {
+        qWarning("QLedMatrixStream::seek: frame %d out of range", frame);
+        return false;
+    }
+
+    d->show(frame);
+    Q_EMIT frameChanged(frame);
+    if(d->running)
+    {
+        d->startFrame = frame;
+        d->clock.start();
+        d->timer->start(qCeil(1000.0 / d->frameRate));
+    }
+    return true;
+}
+
+/**
+ * \internal
+ * Shows the frame due at the current time and schedules the next one.
+ */
+void QLedMatrixStream::advance()
+{
+    Q_D(QLedMatrixStream);
+    if(!d->running)
+    {
+        return;
+    }
+
+    const qint64 now = d->clock.elapsed();
+    const qint64 step = qint64(now * d->frameRate / 1000.0);
+    qint64 frame = d->startFrame + step;
+    if(frame >= d->frameCount)
+    {
+        if(!d->looping)
+        {
+            if(d->currentFrame != d->frameCount - 1)
+            {
+                d->show(d->frameCount - 1);
+                Q_EMIT frameChanged(d->currentFrame);
+            }
+            d->running = false;
+            Q_EMIT finished();
+            return;
+        }
+        frame %= d->frameCount;
+    }
+
+    if(frame != d->currentFrame)
+    {
+        d->show(int(frame));
+        Q_EMIT frameChanged(d->currentFrame);
+    }
+
+    const qint64 next = qCeil((step + 1) * 1000.0 / d->frameRate);
+    d->timer->start(int(qMax<qint64>(0, next - now)));
+}
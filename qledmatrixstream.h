@@ -0,0 +1,90 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef QLEDMATRIXSTREAM_H
+#define QLEDMATRIXSTREAM_H
+
+#include "qledmatrix.h"
+
+class QIODevice;
+class QLedMatrixStreamPrivate;
+class QDESIGNER_WIDGET_EXPORT QLedMatrixStream: public QObject
+{
+    Q_OBJECT
+    Q_ENUMS(PixelFormat)
+
+    public:
+        QLedMatrixStream(QObject* parent = 0);
+        virtual ~QLedMatrixStream();
+
+        enum PixelFormat
+        {
+            Argb32,
+            Rgb888,
+            Grayscale8,
+            Mono
+        };
+
+        bool open(const QString& fileName);
+        void close();
+        bool isOpen() const;
+        QString fileName() const;
+
+        int rowCount() const;
+        int columnCount() const;
+        PixelFormat pixelFormat() const;
+        qreal frameRate() const;
+        int frameCount() const;
+
+        QLedMatrix* matrix() const;
+        void setMatrix(QLedMatrix* matrix);
+
+        bool isLooping() const;
+        void setLooping(bool looping);
+
+        bool isRunning() const;
+        int currentFrame() const;
+
+        static qint64 frameBytes(int rows, int columns, PixelFormat format);
+        static bool writeHeader(QIODevice* device, int rows, int columns,
+                                PixelFormat format, qreal frameRate,
+                                int frameCount = 0);
+
+    public Q_SLOTS:
+        void start();
+        void stop();
+        bool seek(int frame);
+
+    Q_SIGNALS:
+        void frameChanged(int frame);
+        void finished();
+
+    protected:
+        QLedMatrixStreamPrivate* const d_ptr;
+
+    private Q_SLOTS:
+        void advance();
+
+    private:
+        Q_DISABLE_COPY(QLedMatrixStream)
+        Q_DECLARE_PRIVATE(QLedMatrixStream)
+};
+
+#endif // QLEDMATRIXSTREAM_H
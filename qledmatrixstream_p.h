@@ -0,0 +1,78 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef QLEDMATRIXSTREAM_P_H
+#define QLEDMATRIXSTREAM_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QLedMatrix API. It is shared by
+// QLedMatrixStream and QLedMatrixSharedFeed and may change without notice.
+//
+
+#include "qledmatrixstream.h"
+
+#include <qelapsedtimer.h>
+#include <qfile.h>
+#include <qpointer.h>
+#include <qvector.h>
+
+class QTimer;
+
+/**
+ * \internal
+ * State of a QLedMatrixStream. The frame conversion is shared with
+ * QLedMatrixSharedFeed.
+ */
+class QLedMatrixStreamPrivate
+{
+    public:
+        bool readHeader();
+        const uchar* frameData(int frame);
+        void show(int frame);
+        static void showFrame(QLedMatrix* matrix, const uchar* data,
+                              int rowCount, int columnCount,
+                              QLedMatrixStream::PixelFormat format,
+                              QVector<QRgb>& colors);
+        void unmap();
+
+        QFile file;
+        uchar* fileMap; // whole file, 0 if it could not be mapped
+        uchar* frameMap; // current frame when the file is not mapped whole
+        qint64 dataOffset;
+        qint64 frameSize;
+        int rowCount;
+        int columnCount;
+        QLedMatrixStream::PixelFormat format;
+        qreal frameRate;
+        int frameCount;
+        QVector<QRgb> colors; // converted frame
+        QPointer<QLedMatrix> matrix;
+        QTimer* timer;
+        QElapsedTimer clock;
+        int startFrame; // frame shown when the clock was started
+        int currentFrame;
+        bool looping;
+        bool running;
+};
+
+#endif // QLEDMATRIXSTREAM_P_H
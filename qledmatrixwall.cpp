@@ -0,0 +1,446 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include "qledmatrixwall.h"
+#include "qledmatrix_p.h"
+
+#include <qimage.h>
+#include <qvector.h>
+
+/**
+ * \internal
+ */
+class QLedMatrixWallPrivate: public QLedMatrixPrivate
+{
+    Q_DECLARE_PUBLIC(QLedMatrixWall)
+
+    public:
+        QPoint toWall(int row, int col) const;
+        void layout();
+
+        inline bool isTurned() const
+        { return (rotation % 180) != 0; }
+        inline int wallPanelRows() const
+        { return isTurned() ? panelColumnCount : panelRowCount; }
+        inline int wallPanelColumns() const
+        { return isTurned() ? panelRowCount : panelColumnCount; }
+
+        int panelRowCount; // of a panel in its own orientation
+        int panelColumnCount;
+        int gridRows;
+        int gridColumns;
+        qreal spacing;
+        int rotation; // clockwise, in degrees
+        bool serpentine;
+};
+
+/**
+ * \internal
+ * Maps a LED of a panel, in the panel orientation, to the position of the
+ * LED in the panel rectangle of the wall. The point holds the column in x
+ * and the row in y.
+ */
+QPoint QLedMatrixWallPrivate::toWall(int row, int col) const
+{
+    switch(rotation)
+    {
+        case 90:
+            return QPoint(panelRowCount - 1 - row, col);
+        case 180:
+            return QPoint(panelColumnCount - 1 - col, panelRowCount - 1 - row);
+        case 270:
+            return QPoint(row, panelColumnCount - 1 - col);
+        default:
+            return QPoint(col, row);
+    }
+}
+
+/**
+ * \internal
+ * Resizes the matrix to the grid of panels. The size of the wall is only
+ * set here, QLedMatrix::setMatrixSize() refuses to change it.
+ */
+void QLedMatrixWallPrivate::layout()
+{
+    Q_Q(QLedMatrixWall);
+    QLedMatrixUpdateGuard guard(q);
+    resize(gridRows * wallPanelRows(), gridColumns * wallPanelColumns(),
+           Qt::AlignTop | Qt::AlignLeft);
+    q->setPanelLayout(wallPanelRows(), wallPanelColumns(), spacing);
+}
+
+//////////////////////////////////
+
+/**
+ * \class QLedMatrixWall
+ *
+ * \brief The QLedMatrixWall widget shows a video wall made of LED matrix
+ * panels.
+ *
+ * The wall is a single QLedMatrix covering a grid of identical panels: its
+ * rows and columns address the LEDs of the whole wall, with the functions of
+ * QLedMatrix (setColorAt(), setFrame(), setPixels(), drawText(), ...), and
+ * it is drawn in a single paint pass with the LED sprites shared by all the
+ * displays. The panels are drawn apart by panelSpacing(). The numbers of
+ * rows and columns of the wall follow from the panel and grid sizes: they
+ * are only changed by setPanelSize(), setGridSize() and
+ * setPanelRotation(), and the rows and columns properties are read-only.
+ *
+ * The panels can also be addressed one at a time, as the controller of a
+ * real wall does, with panelFrame() and setPanelPixels(). Panels are
+ * numbered along the grid rows, from the top left one, or in a serpentine
+ * order (see setSerpentine()). A panel can be mounted rotated (see
+ * setPanelRotation()): its data stays in the panel orientation, and its
+ * rows become columns of the wall.
+ *
+ * \code
+ * QLedMatrixWall* wall = new QLedMatrixWall(this);
+ * wall->setPanelSize(32, 64);
+ * wall->setGridSize(3, 4);
+ * wall->setSerpentine(true);
+ * wall->setFrame(image); // 192 x 256 LEDs
+ * \endcode
+ */
+
+/**
+ * Constructs a wall of a single panel of 16 rows and 32 columns.
+ *
+ * \param parent parent QWidget
+ */
+QLedMatrixWall::QLedMatrixWall(QWidget* parent):
+    QLedMatrix(*new QLedMatrixWallPrivate, parent)
+{
+    Q_D(QLedMatrixWall);
+    d->fixedSize = true;
+    d->panelRowCount = 16;
+    d->panelColumnCount = 32;
+    d->gridRows = 1;
+    d->gridColumns = 1;
+    d->spacing = 1.0;
+    d->rotation = 0;
+    d->serpentine = false;
+    d->layout();
+}
+
+/**
+ * Destroys the wall.
+ */
+QLedMatrixWall::~QLedMatrixWall()
+{
+}
+
+/**
+ * \brief Returns the number of rows of a panel, in its own orientation.
+ *
+ * \return the number of rows of a panel
+ *
+ * \sa setPanelSize()
+ */
+int QLedMatrixWall::panelRowCount() const
+{
+    Q_D(const QLedMatrixWall);
+    return d->panelRowCount;
+}
+
+/**
+ * \brief Returns the number of columns of a panel, in its own orientation.
+ *
+ * \return the number of columns of a panel
+ *
+ * \sa setPanelSize()
+ */
+int QLedMatrixWall::panelColumnCount() const
+{
+    Q_D(const QLedMatrixWall);
+    return d->panelColumnCount;
+}
+
+/**
+ * \brief Sets the size of the panels.
+ *
+ * The wall is resized as with setMatrixSize(): the LEDs keep their color in
+ * wall coordinates.
+ *
+ * \param rows the number of rows of a panel, in its own orientation
+ * \param columns the number of columns of a panel, in its own orientation
+ *
+ * \sa setGridSize()
+ */
+void QLedMatrixWall::setPanelSize(int rows, int columns)
+{
+    Q_D(QLedMatrixWall);
+    if((rows <= 0) || (columns <= 0))
+    {
+        qWarning("QLedMatrixWall::setPanelSize: invalid size %dx%d", rows, columns);
+        return;
+    }
+
+    d->panelRowCount = rows;
+    d->panelColumnCount = columns;
+    d->layout();
+}
+
+/**
+ * \brief Returns the number of rows of panels.
+ *
+ * \return the number of rows of the grid
+ *
+ * \sa setGridSize()
+ */
+int QLedMatrixWall::gridRowCount() const
+{
+    Q_D(const QLedMatrixWall);
+    return d->gridRows;
+}
+
+/**
+ * \brief Returns the number of columns of panels.
+ *
+ * \return the number of columns of the grid
+ *
+ * \sa setGridSize()
+ */
+int QLedMatrixWall::gridColumnCount() const
+{
+    Q_D(const QLedMatrixWall);
+    return d->gridColumns;
+}
+
+/**
+ * \brief Sets the number of panels of the wall.
+ *
+ * \param rows the number of rows of panels
+ * \param columns the number of columns of panels
+ *
+ * \sa setPanelSize()
+ */
+void QLedMatrixWall::setGridSize(int rows, int columns)
+{
+    Q_D(QLedMatrixWall);
+    if((rows <= 0) || (columns <= 0))
+    {
+        qWarning("QLedMatrixWall::setGridSize: invalid size %dx%d", rows, columns);
+        return;
+    }
+
+    d->gridRows = rows;
+    d->gridColumns = columns;
+    d->layout();
+}
+
+/**
+ * \brief Returns the space drawn between the panels.
+ *
+ * \return the spacing, in LEDs
+ *
+ * \sa setPanelSpacing()
+ */
+qreal QLedMatrixWall::panelSpacing() const
+{
+    Q_D(const QLedMatrixWall);
+    return d->spacing;
+}
+
+/**
+ * \brief Sets the space drawn between the panels.
+ *
+ * \param leds the spacing, in LEDs (1 by default)
+ */
+void QLedMatrixWall::setPanelSpacing(qreal leds)
+{
+    Q_D(QLedMatrixWall);
+    d->spacing = qMax(qreal(0.0), leds);
+    d->layout();
+}
+
+/**
+ * \brief Returns the rotation of the panels.
+ *
+ * \return the clockwise rotation, in degrees
+ *
+ * \sa setPanelRotation()
+ */
+int QLedMatrixWall::panelRotation() const
+{
+    Q_D(const QLedMatrixWall);
+    return d->rotation;
+}
+
+/**
+ * \brief Sets how the panels are mounted on the wall.
+ *
+ * The data of a panel (see setPanelPixels()) is turned clockwise by the
+ * given angle on the wall. At 90 and 270 degrees, the panels are as wide on
+ * the wall as they have rows.
+ *
+ * \param degrees 0 (the default), 90, 180 or 270
+ */
+void QLedMatrixWall::setPanelRotation(int degrees)
+{
+    Q_D(QLedMatrixWall);
+    if((degrees % 90) != 0)
+    {
+        qWarning("QLedMatrixWall::setPanelRotation: invalid rotation %d", degrees);
+        return;
+    }
+
+    d->rotation = ((degrees % 360) + 360) % 360;
+    d->layout();
+}
+
+/**
+ * \brief Returns true if the panels are numbered in a serpentine order.
+ *
+ * \return true for a serpentine order
+ *
+ * \sa setSerpentine()
+ */
+bool QLedMatrixWall::isSerpentine() const
+{
+    Q_D(const QLedMatrixWall);
+    return d->serpentine;
+}
+
+/**
+ * \brief Sets the order of the panels.
+ *
+ * Panels are numbered from the top left one, along the rows of the grid.
+ * In a serpentine order, as panels are often chained, the odd rows of the
+ * grid (from 0) are numbered from right to left.
+ *
+ * \param serpentine true for a serpentine order, false (the default) to
+ *        number all the rows from left to right
+ */
+void QLedMatrixWall::setSerpentine(bool serpentine)
+{
+    Q_D(QLedMatrixWall);
+    d->serpentine = serpentine;
+}
+
+/**
+ * \brief Returns the number of panels of the wall.
+ *
+ * \return the number of panels
+ */
+int QLedMatrixWall::panelCount() const
+{
+    Q_D(const QLedMatrixWall);
+    return d->gridRows * d->gridColumns;
+}
+
+/**
+ * \brief Returns the LEDs of a panel, in wall coordinates.
+ *
+ * \param index the number of the panel, see setSerpentine()
+ *
+ * \return the rectangle of rows and columns covered by the panel, or an
+ *         empty rectangle if the panel does not exist
+ */
+QRect QLedMatrixWall::panelRect(int index) const
+{
+    Q_D(const QLedMatrixWall);
+    if((index < 0) || (index >= panelCount()))
+    {
+        return QRect();
+    }
+
+    const int gridRow = index / d->gridColumns;
+    int gridColumn = index % d->gridColumns;
+    if(d->serpentine && ((gridRow % 2) != 0))
+    {
+        gridColumn = d->gridColumns - 1 - gridColumn;
+    }
+
+    const int rows = d->wallPanelRows();
+    const int columns = d->wallPanelColumns();
+    return QRect(gridColumn * columns, gridRow * rows, columns, rows);
+}
+
+/**
+ * \brief Returns the colors of the LEDs of a panel, in the panel
+ * orientation.
+ *
+ * \param index the number of the panel
+ *
+ * \return an image of panelColumnCount() by panelRowCount() pixels, or a
+ *         null image if the panel does not exist
+ */
+QImage QLedMatrixWall::panelFrame(int index) const
+{
+    Q_D(const QLedMatrixWall);
+    const QRect rect = panelRect(index);
+    if(rect.isEmpty())
+    {
+        qWarning("QLedMatrixWall::panelFrame: panel %d out of range", index);
+        return QImage();
+    }
+
+    QImage image(d->panelColumnCount, d->panelRowCount, QImage::Format_ARGB32);
+    for(int row=0; row < d->panelRowCount; ++row)
+    {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(row));
+        for(int col=0; col < d->panelColumnCount; ++col)
+        {
+            const QPoint led = rect.topLeft() + d->toWall(row, col);
+            line[col] = colorAt(led.y(), led.x());
+        }
+    }
+    return image;
+}
+
+/**
+ * \brief Sets the colors of the LEDs of a panel.
+ *
+ * \param index the number of the panel
+ * \param data panelRowCount() rows of panelColumnCount() colors, in the
+ *        panel orientation
+ * \param stride the number of QRgb values between the start of two rows of
+ *        \a data
+ *
+ * \sa setPixels()
+ */
+void QLedMatrixWall::setPanelPixels(int index, const QRgb* data, int stride)
+{
+    Q_D(QLedMatrixWall);
+    const QRect rect = panelRect(index);
+    if(rect.isEmpty() || (data == 0) || (stride < d->panelColumnCount))
+    {
+        qWarning("QLedMatrixWall::setPanelPixels: invalid panel %d or data", index);
+        return;
+    }
+
+    if(d->rotation == 0)
+    {
+        setPixels(rect, data, stride);
+        return;
+    }
+
+    QVector<QRgb> turned(rect.width() * rect.height());
+    for(int row=0; row < d->panelRowCount; ++row)
+    {
+        const QRgb* line = data + row * stride;
+        for(int col=0; col < d->panelColumnCount; ++col)
+        {
+            const QPoint led = d->toWall(row, col);
+            turned[led.y() * rect.width() + led.x()] = line[col];
+        }
+    }
+    setPixels(rect, turned.constData(), rect.width());
+}
@@ -0,0 +1,72 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This library is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This library is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef QLEDMATRIXWALL_H
+#define QLEDMATRIXWALL_H
+
+#include "qledmatrix.h"
+
+class QLedMatrixWallPrivate;
+class QDESIGNER_WIDGET_EXPORT QLedMatrixWall: public QLedMatrix
+{
+    Q_OBJECT
+    Q_PROPERTY(qreal panelSpacing READ panelSpacing WRITE setPanelSpacing)
+    Q_PROPERTY(int panelRotation READ panelRotation WRITE setPanelRotation)
+    Q_PROPERTY(bool serpentine READ isSerpentine WRITE setSerpentine)
+    Q_PROPERTY(int rows READ rowCount)
+    Q_PROPERTY(int columns READ columnCount)
+
+    public:
+        QLedMatrixWall(QWidget* parent = 0);
+        virtual ~QLedMatrixWall();
+
+        int panelRowCount() const;
+        int panelColumnCount() const;
+        void setPanelSize(int rows, int columns);
+
+        int gridRowCount() const;
+        int gridColumnCount() const;
+        void setGridSize(int rows, int columns);
+
+        qreal panelSpacing() const;
+        void setPanelSpacing(qreal leds);
+
+        int panelRotation() const;
+        void setPanelRotation(int degrees);
+
+        bool isSerpentine() const;
+        void setSerpentine(bool serpentine);
+
+        int panelCount() const;
+        QRect panelRect(int index) const;
+        QImage panelFrame(int index) const;
+        void setPanelPixels(int index, const QRgb* data, int stride);
+
+    private:
+        // The size follows from the panels, see setPanelSize() and setGridSize()
+        using QLedMatrix::setRowCount;
+        using QLedMatrix::setColumnCount;
+        using QLedMatrix::setMatrixSize;
+
+        Q_DISABLE_COPY(QLedMatrixWall)
+        Q_DECLARE_PRIVATE(QLedMatrixWall)
+};
+
+#endif // QLEDMATRIXWALL_H
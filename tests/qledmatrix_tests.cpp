@@ -0,0 +1,442 @@
+/*******************************************************************************
+**
+**  Copyright (C) 2009 Pierre-Etienne Messier <pierre.etienne.messier@gmail.com>
+**                     http://pemessier.hexpresso.org/
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU Lesser General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU Lesser General Public License for more details.
+**
+**  You should have received a copy of the GNU Lesser General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include <QTemporaryFile>
+#include <QVector>
+#include <QtTest>
+
+#include <algorithm>
+
+#include <qledmatrixkernels_p.h>
+#include <qledmatrixrecorder.h>
+
+Q_DECLARE_METATYPE(QLedMatrixKernels::Implementation)
+
+// Every length up to MaxLength, so that each SIMD loop runs with every
+// possible tail
+static const int MaxLength = 67;
+
+// Values past the end of the destination, which no kernel may change
+static const int GuardLength = 16;
+static const QRgb GuardValue = 0xDEADBEEF;
+
+// Frames between two keyframes of the recordings
+static const int KeyframeInterval = 4;
+
+class QLedMatrixTests: public QObject
+{
+    Q_OBJECT
+
+    private:
+        void addImplementations();
+        static QVector<QRgb> randomColors(quint32& seed, int count, int variety = 0);
+        static QVector<uchar> randomBytes(quint32& seed, int count);
+        static QVector<QRgb> guarded(int count);
+        static QImage randomFrame(quint32& seed, int columns, int rows);
+        static void changeLeds(quint32& seed, QImage& frame, int count);
+        void recordFrames(const QString& fileName, QList<QImage>& frames);
+
+    private Q_SLOTS:
+        void fill_data();
+        void fill();
+        void replace_data();
+        void replace();
+        void threshold_data();
+        void threshold();
+        void expandGray_data();
+        void expandGray();
+        void expandRgb888_data();
+        void expandRgb888();
+        void blend_data();
+        void blend();
+        void recordingRoundTrip();
+        void recordingTruncated();
+        void recordingHeaderSize();
+};
+
+/**
+ * Adds the SIMD implementations to the test data. Each one is compared with
+ * the scalar kernels; on a CPU without AVX2, select() falls back to SSE2.
+ */
+void QLedMatrixTests::addImplementations()
+{
+    QTest::addColumn<QLedMatrixKernels::Implementation>("implementation");
+    QTest::newRow("SSE2") << QLedMatrixKernels::SSE2;
+    QTest::newRow("AVX2") << QLedMatrixKernels::AVX2;
+}
+
+/**
+ * Returns the next value of a linear congruential generator, the data is the
+ * same on every run.
+ */
+static inline quint32 nextRandom(quint32& seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed;
+}
+
+/**
+ * Returns \a count random colors. With a \a variety, the colors are picked
+ * among that many values, so that equal values are frequent.
+ */
+QVector<QRgb> QLedMatrixTests::randomColors(quint32& seed, int count, int variety)
+{
+    QVector<QRgb> colors(count);
+    for(int i=0; i < count; ++i)
+    {
+        const quint32 value = nextRandom(seed);
+        colors[i] = (variety > 0) ? 0xFF000000 | ((value >> 8) % variety) : value;
+    }
+    return colors;
+}
+
+/**
+ * Returns \a count random bytes.
+ */
+QVector<uchar> QLedMatrixTests::randomBytes(quint32& seed, int count)
+{
+    QVector<uchar> bytes(count);
+    for(int i=0; i < count; ++i)
+    {
+        bytes[i] = uchar(nextRandom(seed) >> 24);
+    }
+    return bytes;
+}
+
+/**
+ * Returns a destination of \a count values followed by the guard values.
+ */
+QVector<QRgb> QLedMatrixTests::guarded(int count)
+{
+    return QVector<QRgb>(count + GuardLength, GuardValue);
+}
+
+/**
+ * Returns a frame made of runs of up to 256 zeros, equal colors or random
+ * colors, so that its recording uses every kind of run.
+ */
+QImage QLedMatrixTests::randomFrame(quint32& seed, int columns, int rows)
+{
+    QImage frame(columns, rows, QImage::Format_ARGB32);
+    QRgb* values = reinterpret_cast<QRgb*>(frame.bits());
+    const int count = columns * rows;
+    int i = 0;
+    while(i < count)
+    {
+        const quint32 kind = nextRandom(seed) >> 30;
+        const int length = qMin(count - i, int(nextRandom(seed) >> 24) + 1);
+        const QRgb value = (kind == 0) ? 0 : nextRandom(seed);
+        for(int k=0; k < length; ++k, ++i)
+        {
+            values[i] = (kind < 2) ? value : nextRandom(seed);
+        }
+    }
+    return frame;
+}
+
+/**
+ * Sets \a count random LEDs of a frame to random colors.
+ */
+void QLedMatrixTests::changeLeds(quint32& seed, QImage& frame, int count)
+{
+    QRgb* values = reinterpret_cast<QRgb*>(frame.bits());
+    const int size = frame.width() * frame.height();
+    for(int i=0; i < count; ++i)
+    {
+        values[(nextRandom(seed) >> 8) % size] = nextRandom(seed);
+    }
+}
+
+/**
+ * Records frames with deltas, keyframes, a repeated frame and a size change
+ * to \a fileName. Returns the frames expected in the recording in \a frames.
+ */
+void QLedMatrixTests::recordFrames(const QString& fileName, QList<QImage>& frames)
+{
+    QLedMatrixRecorder recorder;
+    recorder.setKeyframeInterval(KeyframeInterval);
+    recorder.setQueueCapacity(64);
+    QVERIFY(recorder.open(fileName));
+
+    quint32 seed = 7;
+    QImage frame = randomFrame(seed, 40, 30);
+    for(int i=0; i < 3 * KeyframeInterval; ++i)
+    {
+        QVERIFY(recorder.recordFrame(frame));
+        frames.append(frame);
+        if(i == 1)
+        {
+            // Queued but not written, nothing changed
+            QVERIFY(recorder.recordFrame(frame));
+        }
+        changeLeds(seed, frame, 1 << (i % 8));
+    }
+
+    // A keyframe of a new size, then a delta; the zeros take several runs
+    frame = QImage(160, 120, QImage::Format_ARGB32);
+    frame.fill(0);
+    QVERIFY(recorder.recordFrame(frame));
+    frames.append(frame);
+    changeLeds(seed, frame, 50);
+    QVERIFY(recorder.recordFrame(frame));
+    frames.append(frame);
+
+    recorder.close();
+    QCOMPARE(recorder.droppedFrames(), 0);
+}
+
+void QLedMatrixTests::fill_data()
+{
+    addImplementations();
+}
+
+void QLedMatrixTests::fill()
+{
+    QFETCH(QLedMatrixKernels::Implementation, implementation);
+    const QLedMatrixKernels scalar = QLedMatrixKernels::select(QLedMatrixKernels::Scalar);
+    const QLedMatrixKernels kernels = QLedMatrixKernels::select(implementation);
+
+    for(int count=0; count <= MaxLength; ++count)
+    {
+        QVector<QRgb> expected = guarded(count);
+        QVector<QRgb> actual = guarded(count);
+        scalar.fill(expected.data(), count, 0xFF123456);
+        kernels.fill(actual.data(), count, 0xFF123456);
+        QCOMPARE(actual, expected);
+    }
+}
+
+void QLedMatrixTests::replace_data()
+{
+    addImplementations();
+}
+
+void QLedMatrixTests::replace()
+{
+    QFETCH(QLedMatrixKernels::Implementation, implementation);
+    const QLedMatrixKernels scalar = QLedMatrixKernels::select(QLedMatrixKernels::Scalar);
+    const QLedMatrixKernels kernels = QLedMatrixKernels::select(implementation);
+
+    quint32 seed = 1;
+    for(int count=0; count <= MaxLength; ++count)
+    {
+        const QVector<QRgb> colors = randomColors(seed, count, 3);
+        QVector<QRgb> expected = guarded(count);
+        std::copy(colors.constBegin(), colors.constEnd(), expected.begin());
+        QVector<QRgb> actual = expected;
+        scalar.replace(expected.data(), count, 0xFF000001, 0xFF00FF00);
+        kernels.replace(actual.data(), count, 0xFF000001, 0xFF00FF00);
+        QCOMPARE(actual, expected);
+    }
+}
+
+void QLedMatrixTests::threshold_data()
+{
+    addImplementations();
+}
+
+void QLedMatrixTests::threshold()
+{
+    QFETCH(QLedMatrixKernels::Implementation, implementation);
+    const QLedMatrixKernels scalar = QLedMatrixKernels::select(QLedMatrixKernels::Scalar);
+    const QLedMatrixKernels kernels = QLedMatrixKernels::select(implementation);
+
+    quint32 seed = 2;
+    for(int level=0; level <= 256; ++level)
+    {
+        for(int count=0; count <= MaxLength; ++count)
+        {
+            const QVector<QRgb> source = randomColors(seed, count);
+            QVector<QRgb> expected = guarded(count);
+            QVector<QRgb> actual = guarded(count);
+            scalar.threshold(expected.data(), source.constData(), count, level,
+                             0xFFFF0000, 0xFF222222);
+            kernels.threshold(actual.data(), source.constData(), count, level,
+                              0xFFFF0000, 0xFF222222);
+            QCOMPARE(actual, expected);
+        }
+    }
+}
+
+void QLedMatrixTests::expandGray_data()
+{
+    addImplementations();
+}
+
+void QLedMatrixTests::expandGray()
+{
+    QFETCH(QLedMatrixKernels::Implementation, implementation);
+    const QLedMatrixKernels scalar = QLedMatrixKernels::select(QLedMatrixKernels::Scalar);
+    const QLedMatrixKernels kernels = QLedMatrixKernels::select(implementation);
+
+    quint32 seed = 3;
+    for(int count=0; count <= MaxLength; ++count)
+    {
+        const QVector<uchar> source = randomBytes(seed, count);
+        QVector<QRgb> expected = guarded(count);
+        QVector<QRgb> actual = guarded(count);
+        scalar.expandGray(expected.data(), source.constData(), count);
+        kernels.expandGray(actual.data(), source.constData(), count);
+        QCOMPARE(actual, expected);
+    }
+}
+
+void QLedMatrixTests::expandRgb888_data()
+{
+    addImplementations();
+}
+
+void QLedMatrixTests::expandRgb888()
+{
+    QFETCH(QLedMatrixKernels::Implementation, implementation);
+    const QLedMatrixKernels scalar = QLedMatrixKernels::select(QLedMatrixKernels::Scalar);
+    const QLedMatrixKernels kernels = QLedMatrixKernels::select(implementation);
+
+    quint32 seed = 4;
+    for(int count=0; count <= MaxLength; ++count)
+    {
+        const QVector<uchar> source = randomBytes(seed, count * 3);
+        QVector<QRgb> expected = guarded(count);
+        QVector<QRgb> actual = guarded(count);
+        scalar.expandRgb888(expected.data(), source.constData(), count);
+        kernels.expandRgb888(actual.data(), source.constData(), count);
+        QCOMPARE(actual, expected);
+    }
+}
+
+void QLedMatrixTests::blend_data()
+{
+    addImplementations();
+}
+
+void QLedMatrixTests::blend()
+{
+    QFETCH(QLedMatrixKernels::Implementation, implementation);
+    const QLedMatrixKernels scalar = QLedMatrixKernels::select(QLedMatrixKernels::Scalar);
+    const QLedMatrixKernels kernels = QLedMatrixKernels::select(implementation);
+
+    quint32 seed = 5;
+    for(int level=0; level <= 256; ++level)
+    {
+        for(int count=0; count <= MaxLength; ++count)
+        {
+            const QVector<QRgb> from = randomColors(seed, count);
+            const QVector<QRgb> to = randomColors(seed, count);
+            QVector<QRgb> expected = guarded(count);
+            QVector<QRgb> actual = guarded(count);
+            scalar.blend(expected.data(), from.constData(), to.constData(), count, level);
+            kernels.blend(actual.data(), from.constData(), to.constData(), count, level);
+            QCOMPARE(actual, expected);
+
+            // The destination may also be the source
+            QVector<QRgb> inPlace = guarded(count);
+            std::copy(from.constBegin(), from.constEnd(), inPlace.begin());
+            kernels.blend(inPlace.data(), inPlace.constData(), to.constData(), count, level);
+            QCOMPARE(inPlace, expected);
+        }
+    }
+}
+
+void QLedMatrixTests::recordingRoundTrip()
+{
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.close();
+    QList<QImage> frames;
+    recordFrames(file.fileName(), frames);
+    if(QTest::currentTestFailed())
+    {
+        return;
+    }
+
+    QLedMatrixRecording recording(file.fileName());
+    QVERIFY(recording.isOpen());
+    QCOMPARE(recording.frameCount(), frames.size());
+    for(int i=0; i < frames.size(); ++i)
+    {
+        QCOMPARE(recording.frame(i), frames.at(i));
+        if(i > 0)
+        {
+            QVERIFY(recording.timestamp(i) >= recording.timestamp(i - 1));
+        }
+        QVERIFY(recording.frameAt(recording.timestamp(i)) >= i);
+    }
+
+    // Backwards, each frame is rebuilt from its keyframe
+    for(int i=frames.size() - 1; i >= 0; --i)
+    {
+        QCOMPARE(recording.frame(i), frames.at(i));
+    }
+}
+
+void QLedMatrixTests::recordingTruncated()
+{
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.close();
+    QList<QImage> frames;
+    recordFrames(file.fileName(), frames);
+    if(QTest::currentTestFailed())
+    {
+        return;
+    }
+
+    // A recording that was not closed may end in the middle of a record
+    QFile recorded(file.fileName());
+    QVERIFY(recorded.resize(recorded.size() - 3));
+
+    QLedMatrixRecording recording(file.fileName());
+    QVERIFY(recording.isOpen());
+    QCOMPARE(recording.frameCount(), frames.size() - 1);
+    for(int i=0; i < recording.frameCount(); ++i)
+    {
+        QCOMPARE(recording.frame(i), frames.at(i));
+    }
+}
+
+void QLedMatrixTests::recordingHeaderSize()
+{
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.close();
+    QList<QImage> frames;
+    recordFrames(file.fileName(), frames);
+    if(QTest::currentTestFailed())
+    {
+        return;
+    }
+
+    // The records would start inside the header
+    QFile recorded(file.fileName());
+    QVERIFY(recorded.open(QIODevice::ReadWrite));
+    const char headerSize[2] = { 4, 0 };
+    QVERIFY(recorded.seek(6));
+    QCOMPARE(recorded.write(headerSize, sizeof(headerSize)), qint64(sizeof(headerSize)));
+    recorded.close();
+
+    QTest::ignoreMessage(QtWarningMsg, "QLedMatrixRecording::open: invalid header size");
+    QLedMatrixRecording recording;
+    QVERIFY(!recording.open(file.fileName()));
+    QVERIFY(!recording.isOpen());
+}
+
+QTEST_APPLESS_MAIN(QLedMatrixTests)
+
+#include "qledmatrix_tests.moc"
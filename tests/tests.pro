@@ -0,0 +1,26 @@
+PROJECT                 = qledmatrix_tests
+TARGET                  = qledmatrix_tests
+TEMPLATE                = app
+
+CONFIG                 += qt
+CONFIG                 += warn_on
+CONFIG                 += testcase
+greaterThan(QT_MAJOR_VERSION, 4) {
+    QT                 += widgets testlib
+} else {
+    CONFIG             += qtestlib
+}
+
+OBJECTS_DIR             = obj
+MOC_DIR                 = moc
+
+DEPENDPATH             += .
+INCLUDEPATH            += ../
+QMAKE_LIBDIR           += ../build
+
+# The kernels are internal to the library and not exported, they are built
+# into the test
+HEADERS                += ../qledmatrixkernels_p.h
+SOURCES                += qledmatrix_tests.cpp \
+                          ../qledmatrixkernels.cpp
+LIBS                   += -lqledmatrix